@@ -0,0 +1,12 @@
+#pragma once
+
+#include <cstdint>
+
+namespace bench {
+
+/***
+ * Number of global operator new calls made so far by this process.
+ */
+uint64_t allocation_count();
+
+}
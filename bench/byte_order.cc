@@ -0,0 +1,86 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace {
+
+constexpr size_t FIELD_COUNT = 1024;
+
+/***
+ * Reading and writing the 16-bit fields of a frame: a raw host-order copy against the
+ * network-order primitives of BufferReader and SpanWriter.
+ */
+std::vector<uint8_t> make_fields() {
+    std::vector<uint8_t> fields(FIELD_COUNT * sizeof(uint16_t));
+    for (size_t i = 0; i < fields.size(); ++i) {
+        fields[i] = static_cast<uint8_t>(i * 7);
+    }
+    return fields;
+}
+
+void BM_ReadHostOrder(benchmark::State& state) {
+    const auto fields = make_fields();
+
+    for (auto _ : state) {
+        uint32_t sum = 0;
+        for (size_t i = 0; i < FIELD_COUNT; ++i) {
+            uint16_t value;
+            std::memcpy(&value, fields.data() + i * sizeof(uint16_t), sizeof(value));
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * FIELD_COUNT);
+}
+BENCHMARK(BM_ReadHostOrder);
+
+void BM_ReadNetworkOrder(benchmark::State& state) {
+    const auto fields = make_fields();
+
+    for (auto _ : state) {
+        auto reader = mqtt_sn::format::BufferReader(fields.data(), fields.size());
+        uint32_t sum = 0;
+        for (size_t i = 0; i < FIELD_COUNT; ++i) {
+            sum += reader.read_unchecked<uint16_t>();
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * FIELD_COUNT);
+}
+BENCHMARK(BM_ReadNetworkOrder);
+
+void BM_WriteHostOrder(benchmark::State& state) {
+    std::vector<uint8_t> fields(FIELD_COUNT * sizeof(uint16_t));
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < FIELD_COUNT; ++i) {
+            const auto value = static_cast<uint16_t>(i);
+            std::memcpy(fields.data() + i * sizeof(uint16_t), &value, sizeof(value));
+        }
+        benchmark::DoNotOptimize(fields.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * FIELD_COUNT);
+}
+BENCHMARK(BM_WriteHostOrder);
+
+void BM_WriteNetworkOrder(benchmark::State& state) {
+    std::vector<uint8_t> fields(FIELD_COUNT * sizeof(uint16_t));
+
+    for (auto _ : state) {
+        auto writer = mqtt_sn::format::SpanWriter(fields.data(), fields.size());
+        for (size_t i = 0; i < FIELD_COUNT; ++i) {
+            writer.write(static_cast<uint16_t>(i));
+        }
+        benchmark::DoNotOptimize(fields.data());
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * FIELD_COUNT);
+}
+BENCHMARK(BM_WriteNetworkOrder);
+
+}
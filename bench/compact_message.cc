@@ -0,0 +1,83 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include <mqtt-sn/compact_message.h>
+#include <mqtt-sn/format.h>
+
+namespace {
+
+/***
+ * An outbound queue of QoS 0 PUBLISHes with a 16-byte payload, the common case for sensor
+ * readings, held either as Message or as CompactMessage.
+ */
+constexpr size_t QUEUE_SIZE = 1 << 16;
+
+mqtt_sn::Message make_publish(size_t index) {
+    mqtt_sn::PublishMessage message {};
+    message.topic_id = static_cast<uint16_t>(index);
+    message.message_id = static_cast<uint16_t>(index);
+    message.payload.assign(16, static_cast<uint8_t>(index));
+    return message;
+}
+
+template<typename T>
+std::vector<T> make_queue() {
+    std::vector<T> queue;
+    queue.reserve(QUEUE_SIZE);
+    for (size_t i = 0; i < QUEUE_SIZE; ++i) {
+        queue.emplace_back(make_publish(i));
+    }
+    return queue;
+}
+
+/***
+ * Walks the queue as a sender would, producing each wire frame: Message is encoded, a
+ * CompactMessage already holds its frame.
+ */
+template<typename T>
+void BM_QueueDrain(benchmark::State& state) {
+    auto queue = make_queue<T>();
+    uint8_t frame[64];
+
+    for (auto _ : state) {
+        size_t bytes = 0;
+        for (const auto& message : queue) {
+            if constexpr (std::is_same<T, mqtt_sn::Message>::value) {
+                bytes += mqtt_sn::format::encode_into(message, frame, sizeof(frame)).value_or(0);
+            } else {
+                auto encoded = message.frame();
+                std::memcpy(frame, encoded.data(), encoded.size());
+                bytes += encoded.size();
+            }
+            benchmark::ClobberMemory();
+        }
+        benchmark::DoNotOptimize(bytes);
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_SIZE);
+    state.counters["bytes/message"] = sizeof(T);
+}
+BENCHMARK_TEMPLATE(BM_QueueDrain, mqtt_sn::Message);
+BENCHMARK_TEMPLATE(BM_QueueDrain, mqtt_sn::CompactMessage);
+
+/***
+ * Copies the whole queue, e.g. when it is handed to another session.
+ */
+template<typename T>
+void BM_QueueCopy(benchmark::State& state) {
+    auto queue = make_queue<T>();
+
+    for (auto _ : state) {
+        auto copy = queue;
+        benchmark::DoNotOptimize(copy.data());
+    }
+    state.SetItemsProcessed(state.iterations() * QUEUE_SIZE);
+    state.counters["bytes/message"] = sizeof(T);
+}
+BENCHMARK_TEMPLATE(BM_QueueCopy, mqtt_sn::Message);
+BENCHMARK_TEMPLATE(BM_QueueCopy, mqtt_sn::CompactMessage);
+
+}
@@ -0,0 +1,242 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+#include "alloc_counter.h"
+
+namespace {
+
+/***
+ * Names of the mqtt_sn::Message alternatives, in variant order.
+ */
+constexpr const char* MESSAGE_NAMES[] = {
+    "Advertise", "SearchGateway", "GatewayInfo", "Connect", "ConnectAck",
+    "WillTopicRequest", "WillTopicEmpty", "WillTopic", "WillMessageRequest", "WillMessage",
+    "WillTopicUpdate", "WillTopicResponse", "WillTopicUpdateEmpty", "WillMessageUpdate", "WillMessageResponse",
+    "RegisterTopic", "RegisterTopicAck", "PublishMessage", "PublishMessageAck", "PublishMessageComplete",
+    "PublishMessageReceived", "PublishMessageRelease", "Subscribe", "SubscribeAck", "Unsubscribe", "UnsubscribeAck",
+    "PingRequest", "PingResponse", "Disconnect", "Forward"
+};
+static_assert(std::size(MESSAGE_NAMES) == std::variant_size_v<mqtt_sn::Message>);
+
+/***
+ * Payload sizes: empty, typical sensor reading, just below and around the 3-byte length
+ * boundary, and a large frame.
+ */
+constexpr size_t PAYLOAD_SIZES[] = {0, 16, 250, 255, 256, 4096};
+
+mqtt_sn::MessageFlags topic_flags(mqtt_sn::TopicIdType type) {
+    mqtt_sn::MessageFlags flags {};
+    flags.topic_id_type = static_cast<uint8_t>(type);
+    return flags;
+}
+
+/***
+ * A representative message of the given alternative whose variable-length field, if it has
+ * one, is @p size bytes long. Returns nullopt for alternatives without such a field when
+ * @p size is not zero, so fixed-size messages are only benchmarked once.
+ */
+std::optional<mqtt_sn::Message> make_message(size_t index, size_t size) {
+    const auto bytes = std::vector<uint8_t>(size, 0x5A);
+    const auto string = std::string(size, 'x');
+
+    switch (index) {
+        case 2:
+            return mqtt_sn::GatewayInfo {1, size == 0 ? std::nullopt : std::optional(bytes)};
+        case 3:
+            return mqtt_sn::Connect {{}, 1, 60, string};
+        case 7:
+            return mqtt_sn::WillTopic {{}, string};
+        case 9:
+            return mqtt_sn::WillMessage {bytes};
+        case 10:
+            return mqtt_sn::WillTopicUpdate {{}, string};
+        case 13:
+            return mqtt_sn::WillMessageUpdate {bytes};
+        case 15:
+            return mqtt_sn::RegisterTopic {1, 2, string};
+        case 17:
+            return mqtt_sn::PublishMessage {{}, 1, 2, bytes};
+        case 22:
+            return mqtt_sn::Subscribe {topic_flags(mqtt_sn::TopicIdType::Normal), 1, string};
+        case 24:
+            return mqtt_sn::Unsubscribe {topic_flags(mqtt_sn::TopicIdType::Normal), 1, string};
+        case 26:
+            return mqtt_sn::PingRequest {size == 0 ? std::nullopt : std::optional(string)};
+        case 29: {
+            mqtt_sn::format::BufferWriter inner;
+            mqtt_sn::format::encode(mqtt_sn::PublishMessage {{}, 1, 2, bytes}, inner);
+            return mqtt_sn::Forward {1, {1, 2, 3, 4}, inner};
+        }
+    }
+
+    if (size != 0) {
+        return std::nullopt;
+    }
+
+    switch (index) {
+        case 0:  return mqtt_sn::Advertise {1, 900};
+        case 1:  return mqtt_sn::SearchGateway {1};
+        case 4:  return mqtt_sn::ConnectAck {mqtt_sn::MessageErrorCode::Accepted};
+        case 5:  return mqtt_sn::WillTopicRequest {};
+        case 6:  return mqtt_sn::WillTopicEmpty {};
+        case 8:  return mqtt_sn::WillMessageRequest {};
+        case 11: return mqtt_sn::WillTopicResponse {mqtt_sn::MessageErrorCode::Accepted};
+        case 12: return mqtt_sn::WillTopicUpdateEmpty {};
+        case 14: return mqtt_sn::WillMessageResponse {mqtt_sn::MessageErrorCode::Accepted};
+        case 16: return mqtt_sn::RegisterTopicAck {1, 2, mqtt_sn::MessageErrorCode::Accepted};
+        case 18: return mqtt_sn::PublishMessageAck {1, 2, mqtt_sn::MessageErrorCode::Accepted};
+        case 19: return mqtt_sn::PublishMessageComplete {1};
+        case 20: return mqtt_sn::PublishMessageReceived {1};
+        case 21: return mqtt_sn::PublishMessageRelease {1};
+        case 23: return mqtt_sn::SubscribeAck {{}, 1, 2, mqtt_sn::MessageErrorCode::Accepted};
+        case 25: return mqtt_sn::UnsubscribeAck {1};
+        case 27: return mqtt_sn::PingResponse {};
+        case 28: return mqtt_sn::Disconnect {60};
+    }
+    return std::nullopt;
+}
+
+/***
+ * Reports bytes/s over the encoded frame and the average number of heap allocations per message.
+ */
+void report(benchmark::State& state, size_t frame_size, uint64_t allocations_before) {
+    state.SetItemsProcessed(state.iterations());
+    state.SetBytesProcessed(state.iterations() * frame_size);
+    state.counters["allocs/op"] = benchmark::Counter(
+        static_cast<double>(bench::allocation_count() - allocations_before),
+        benchmark::Counter::kAvgIterations);
+}
+
+void BM_Parse(benchmark::State& state, const mqtt_sn::Message& message) {
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(message, frame);
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+        benchmark::DoNotOptimize(mqtt_sn::format::parse(reader));
+    }
+    report(state, frame.size(), allocations);
+}
+
+void BM_ParseView(benchmark::State& state, const mqtt_sn::Message& message) {
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(message, frame);
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+        benchmark::DoNotOptimize(mqtt_sn::format::parse_view(reader));
+    }
+    report(state, frame.size(), allocations);
+}
+
+void BM_Encode(benchmark::State& state, const mqtt_sn::Message& message) {
+    mqtt_sn::format::BufferWriter frame;
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        frame.clear();
+        mqtt_sn::format::encode(message, frame);
+        benchmark::DoNotOptimize(frame.data());
+    }
+    report(state, frame.size(), allocations);
+}
+
+void BM_EncodeInto(benchmark::State& state, const mqtt_sn::Message& message) {
+    std::vector<uint8_t> frame(mqtt_sn::format::encoded_size(message).value());
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt_sn::format::encode_into(message, frame.data(), frame.size()));
+        benchmark::ClobberMemory();
+    }
+    report(state, frame.size(), allocations);
+}
+
+/***
+ * Header only, as for a sendmsg with the payload in its own iovec; bytes/s counts the whole frame.
+ */
+void BM_EncodeHeader(benchmark::State& state, const mqtt_sn::Message& message) {
+    std::vector<uint8_t> header(mqtt_sn::format::header_size(message));
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt_sn::format::encode_header(message, header.data()));
+        benchmark::DoNotOptimize(mqtt_sn::format::encoded_payload(message));
+        benchmark::ClobberMemory();
+    }
+    report(state, mqtt_sn::format::encoded_size(message).value(), allocations);
+}
+
+/***
+ * Forwarder relay path: a Forward carrying a PUBLISH of state.range(0) payload bytes is stripped
+ * down to the inner frame. Compare with BM_Parse/Forward and BM_ParseView/Forward.
+ */
+void BM_ForwardUnwrap(benchmark::State& state) {
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(make_message(29, static_cast<size_t>(state.range(0))).value(), frame);
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt_sn::format::unwrap_forward(frame.data(), frame.size()));
+    }
+    report(state, frame.size(), allocations);
+}
+BENCHMARK(BM_ForwardUnwrap)->Arg(16)->Arg(256)->Arg(4096);
+
+/***
+ * The other direction: the inner frame is encapsulated in place, in headroom in front of it.
+ */
+void BM_ForwardWrap(benchmark::State& state) {
+    const uint8_t node_id[] = {1, 2, 3, 4};
+    mqtt_sn::format::BufferWriter inner;
+    mqtt_sn::format::encode(make_message(17, static_cast<size_t>(state.range(0))).value(), inner);
+
+    constexpr size_t HEADROOM = 16;
+    std::vector<uint8_t> buffer(HEADROOM + inner.size());
+    std::copy(inner.data(), inner.data() + inner.size(), buffer.begin() + HEADROOM);
+
+    auto allocations = bench::allocation_count();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt_sn::format::wrap_forward(buffer.data() + HEADROOM, inner.size(), HEADROOM, 1, mqtt_sn::ByteView(node_id, sizeof(node_id))));
+        benchmark::ClobberMemory();
+    }
+    report(state, mqtt_sn::format::forward_header_size(sizeof(node_id)) + inner.size(), allocations);
+}
+BENCHMARK(BM_ForwardWrap)->Arg(16)->Arg(256)->Arg(4096);
+
+int register_benchmarks() {
+    using Benchmark = void (*)(benchmark::State&, const mqtt_sn::Message&);
+    const std::pair<const char*, Benchmark> benchmarks[] = {
+        {"BM_Parse", BM_Parse},
+        {"BM_ParseView", BM_ParseView},
+        {"BM_Encode", BM_Encode},
+        {"BM_EncodeInto", BM_EncodeInto},
+        {"BM_EncodeHeader", BM_EncodeHeader},
+    };
+
+    for (const auto& [prefix, fn] : benchmarks) {
+        for (size_t index = 0; index < std::variant_size_v<mqtt_sn::Message>; ++index) {
+            for (auto size : PAYLOAD_SIZES) {
+                auto message = make_message(index, size);
+                if (!message) {
+                    continue;
+                }
+
+                auto name = std::string(prefix) + "/" + MESSAGE_NAMES[index] + "/" + std::to_string(size);
+                benchmark::RegisterBenchmark(name.c_str(), fn, message.value());
+            }
+        }
+    }
+    return 0;
+}
+
+const int registered = register_benchmarks();
+
+}
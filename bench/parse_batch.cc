@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace {
+
+constexpr size_t BATCH_SIZE = 64;
+
+/***
+ * A recvmmsg-sized batch: mostly small PUBLISHes with a few acks mixed in.
+ */
+std::vector<mqtt_sn::format::BufferWriter> make_frames() {
+    std::vector<mqtt_sn::format::BufferWriter> frames(BATCH_SIZE);
+    for (size_t i = 0; i < BATCH_SIZE; ++i) {
+        if (i % 8 == 7) {
+            mqtt_sn::format::encode(mqtt_sn::PublishMessageAck {static_cast<uint16_t>(i), static_cast<uint16_t>(i), mqtt_sn::MessageErrorCode::Accepted}, frames[i]);
+        } else {
+            mqtt_sn::PublishMessage publish_message {};
+            publish_message.topic_id = static_cast<uint16_t>(i % 4);
+            publish_message.message_id = static_cast<uint16_t>(i);
+            publish_message.payload.assign(16, static_cast<uint8_t>(i));
+            mqtt_sn::format::encode(publish_message, frames[i]);
+        }
+    }
+    return frames;
+}
+
+std::vector<mqtt_sn::format::Datagram> make_datagrams(const std::vector<mqtt_sn::format::BufferWriter>& frames) {
+    std::vector<mqtt_sn::format::Datagram> datagrams;
+    for (const auto& frame : frames) {
+        datagrams.push_back({frame.data(), frame.size()});
+    }
+    return datagrams;
+}
+
+void BM_ParseLoop(benchmark::State& state) {
+    const auto frames = make_frames();
+    const auto datagrams = make_datagrams(frames);
+
+    for (auto _ : state) {
+        for (const auto& datagram : datagrams) {
+            auto reader = mqtt_sn::format::BufferReader(datagram.data, datagram.size);
+            benchmark::DoNotOptimize(mqtt_sn::format::parse(reader));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+BENCHMARK(BM_ParseLoop);
+
+void BM_ParseViewLoop(benchmark::State& state) {
+    const auto frames = make_frames();
+    const auto datagrams = make_datagrams(frames);
+
+    for (auto _ : state) {
+        for (const auto& datagram : datagrams) {
+            auto reader = mqtt_sn::format::BufferReader(datagram.data, datagram.size);
+            benchmark::DoNotOptimize(mqtt_sn::format::parse_view(reader));
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+BENCHMARK(BM_ParseViewLoop);
+
+/***
+ * The routing decision alone: type, QoS and topic id of each frame, read through LazyFrame.
+ */
+void BM_ParseLazyLoop(benchmark::State& state) {
+    const auto frames = make_frames();
+    const auto datagrams = make_datagrams(frames);
+
+    for (auto _ : state) {
+        size_t matches = 0;
+        for (const auto& datagram : datagrams) {
+            auto reader = mqtt_sn::format::BufferReader(datagram.data, datagram.size);
+            auto frame = mqtt_sn::format::parse_lazy(reader);
+            if (frame && frame->type() == mqtt_sn::MessageType::Publish) {
+                matches += frame->flags()->qos == 0 && frame->topic_id() == 1;
+            }
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+BENCHMARK(BM_ParseLazyLoop);
+
+void BM_ParseBatch(benchmark::State& state) {
+    const auto frames = make_frames();
+    const auto datagrams = make_datagrams(frames);
+
+    mqtt_sn::format::ParsedBatch batch;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt_sn::format::parse_batch(datagrams.data(), datagrams.size(), batch));
+        benchmark::ClobberMemory();
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+BENCHMARK(BM_ParseBatch);
+
+/***
+ * The downstream stage the SoA layout is for: select PUBLISHes to one topic id.
+ */
+void BM_ParseBatchFilterTopic(benchmark::State& state) {
+    const auto frames = make_frames();
+    const auto datagrams = make_datagrams(frames);
+
+    mqtt_sn::format::ParsedBatch batch;
+    for (auto _ : state) {
+        mqtt_sn::format::parse_batch(datagrams.data(), datagrams.size(), batch);
+
+        size_t matches = 0;
+        for (size_t i = 0; i < batch.size(); ++i) {
+            matches += batch.types[i] == mqtt_sn::MessageType::Publish && batch.topic_ids[i] == 1;
+        }
+        benchmark::DoNotOptimize(matches);
+    }
+    state.SetItemsProcessed(state.iterations() * BATCH_SIZE);
+}
+BENCHMARK(BM_ParseBatchFilterTopic);
+
+}
@@ -0,0 +1,123 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace {
+
+constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+/***
+ * 64 KiB of back-to-back frames as read from a serial or TCP link: PUBLISHes of 8 to 64 bytes
+ * with acks and pings mixed in, and the occasional Forward. The last frame is cut short.
+ */
+mqtt_sn::format::BufferWriter make_stream() {
+    mqtt_sn::format::BufferWriter stream;
+    for (size_t i = 0; stream.size() < BUFFER_SIZE; ++i) {
+        switch (i % 8) {
+            case 3:
+                mqtt_sn::format::encode(mqtt_sn::PublishMessageAck {1, static_cast<uint16_t>(i), mqtt_sn::MessageErrorCode::Accepted}, stream);
+                break;
+            case 5:
+                mqtt_sn::format::encode(mqtt_sn::PingResponse {}, stream);
+                break;
+            case 7: {
+                mqtt_sn::format::BufferWriter inner;
+                mqtt_sn::format::encode(mqtt_sn::PublishMessageComplete {static_cast<uint16_t>(i)}, inner);
+                mqtt_sn::format::encode(mqtt_sn::Forward {1, {1, 2, 3, 4}, inner}, stream);
+                break;
+            }
+            default: {
+                mqtt_sn::PublishMessage publish_message {};
+                publish_message.topic_id = static_cast<uint16_t>(i % 4);
+                publish_message.message_id = static_cast<uint16_t>(i);
+                publish_message.payload.assign(8 + i % 57, static_cast<uint8_t>(i));
+                mqtt_sn::format::encode(publish_message, stream);
+            }
+        }
+    }
+    stream.resize(BUFFER_SIZE);
+    return stream;
+}
+
+/***
+ * What callers did before split_frames(): parse() frame after frame, the length prefix of each
+ * found only once the previous frame is fully decoded.
+ */
+void BM_SplitParseLoop(benchmark::State& state) {
+    const auto stream = make_stream();
+
+    for (auto _ : state) {
+        auto reader = mqtt_sn::format::BufferReader(stream.data(), stream.size());
+        size_t frames = 0;
+        while (mqtt_sn::format::parse(reader)) {
+            ++frames;
+        }
+        benchmark::DoNotOptimize(frames);
+    }
+    state.SetBytesProcessed(state.iterations() * BUFFER_SIZE);
+}
+BENCHMARK(BM_SplitParseLoop);
+
+/***
+ * A frame_extent() loop, i.e. splitting without the fast path for short frames.
+ */
+void BM_SplitExtentLoop(benchmark::State& state) {
+    const auto stream = make_stream();
+
+    mqtt_sn::format::FrameIndex index;
+    for (auto _ : state) {
+        index.clear();
+        size_t offset = 0;
+        for (;;) {
+            auto extent = mqtt_sn::format::frame_extent(stream.data() + offset, stream.size() - offset);
+            if (extent.status != mqtt_sn::format::FrameStatus::Complete) {
+                break;
+            }
+            auto type_offset = stream[offset] == 1 ? 3 : 1;
+            index.offsets.push_back(static_cast<uint32_t>(offset));
+            index.sizes.push_back(static_cast<uint32_t>(extent.size));
+            index.types.push_back(static_cast<mqtt_sn::MessageType>(stream[offset + type_offset]));
+            offset += extent.size;
+        }
+        benchmark::DoNotOptimize(index.types.data());
+    }
+    state.SetBytesProcessed(state.iterations() * BUFFER_SIZE);
+}
+BENCHMARK(BM_SplitExtentLoop);
+
+void BM_SplitFrames(benchmark::State& state) {
+    const auto stream = make_stream();
+
+    mqtt_sn::format::FrameIndex index;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mqtt_sn::format::split_frames(stream.data(), stream.size(), index));
+        benchmark::ClobberMemory();
+    }
+    state.SetBytesProcessed(state.iterations() * BUFFER_SIZE);
+    state.counters["frames"] = static_cast<double>(index.size());
+}
+BENCHMARK(BM_SplitFrames);
+
+/***
+ * Split, then decode every indexed frame in place.
+ */
+void BM_SplitFramesParseView(benchmark::State& state) {
+    const auto stream = make_stream();
+
+    mqtt_sn::format::FrameIndex index;
+    for (auto _ : state) {
+        mqtt_sn::format::split_frames(stream.data(), stream.size(), index);
+        for (size_t i = 0; i < index.size(); ++i) {
+            auto frame = index.frame(i);
+            auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+            benchmark::DoNotOptimize(mqtt_sn::format::parse_view(reader));
+        }
+    }
+    state.SetBytesProcessed(state.iterations() * BUFFER_SIZE);
+}
+BENCHMARK(BM_SplitFramesParseView);
+
+}
@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <mqtt-sn/subscription_index.h>
+
+namespace {
+
+constexpr size_t SUBSCRIPTION_COUNT = 50000;
+
+/***
+ * 50k subscriptions over building/floor/room/sensor topics: mostly exact filters, with
+ * one '+' filter in ten and one '#' filter in a hundred.
+ */
+std::string topic(size_t i) {
+    return "building-" + std::to_string(i % 10) + "/floor-" + std::to_string(i / 10 % 20)
+           + "/room-" + std::to_string(i / 200 % 50) + "/sensor-" + std::to_string(i / 10000);
+}
+
+const mqtt_sn::SubscriptionIndex& index() {
+    static const auto subscriptions = [] {
+        auto index = std::make_unique<mqtt_sn::SubscriptionIndex>();
+        for (size_t i = 0; i < SUBSCRIPTION_COUNT; ++i) {
+            auto filter = topic(i);
+            if (i % 100 == 99) {
+                filter = filter.substr(0, filter.find("/room-")) + "/#";
+            } else if (i % 10 == 9) {
+                filter.replace(filter.find("floor-"), filter.find("/room-") - filter.find("floor-"), "+");
+            }
+            index->subscribe(static_cast<mqtt_sn::SubscriberId>(i), filter);
+        }
+        return index;
+    }();
+    return *subscriptions;
+}
+
+void BM_SubscriptionMatch(benchmark::State& state) {
+    const auto& subscriptions = index();
+    std::vector<std::string> topics;
+    for (size_t i = 0; i < 64; ++i) {
+        topics.push_back(topic(i * 7919 % SUBSCRIPTION_COUNT));
+    }
+
+    std::vector<mqtt_sn::SubscriberId> subscribers;
+    size_t matched = 0;
+    for (auto _ : state) {
+        for (const auto& t : topics) {
+            subscribers.clear();
+            subscriptions.match(t, subscribers);
+            matched += subscribers.size();
+        }
+    }
+    benchmark::DoNotOptimize(matched);
+    state.SetItemsProcessed(state.iterations() * topics.size());
+    state.counters["subscribers/match"] = benchmark::Counter(double(matched) / double(state.iterations() * topics.size()));
+}
+BENCHMARK(BM_SubscriptionMatch);
+
+}
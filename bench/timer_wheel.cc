@@ -0,0 +1,70 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+#include <mqtt-sn/keep_alive.h>
+#include <mqtt-sn/timer_wheel.h>
+
+namespace {
+
+constexpr uint32_t TICKS_PER_SECOND = 1000;
+
+/***
+ * One iteration is one simulated second at 1 ms ticks: state.range(0) keep-alive timers of
+ * 30-90 s, of which state.range(1) percent are refreshed by incoming frames, and the wheel is
+ * advanced through the second. Expired timers are re-added, as reconnecting clients would be.
+ */
+void BM_TimerWheelChurn(benchmark::State& state) {
+    const auto timer_count = static_cast<size_t>(state.range(0));
+    const auto refreshes = timer_count * static_cast<size_t>(state.range(1)) / 100;
+
+    std::mt19937 random(42);
+    mqtt_sn::TimerWheel wheel;
+    std::vector<mqtt_sn::TimerWheel::TimerId> timers;
+    for (size_t i = 0; i < timer_count; ++i) {
+        timers.push_back(wheel.add(30 * TICKS_PER_SECOND + random() % (60 * TICKS_PER_SECOND), i));
+    }
+
+    uint32_t now = 0;
+    size_t fired = 0;
+    for (auto _ : state) {
+        for (size_t i = 0; i < refreshes; ++i) {
+            auto client = random() % timer_count;
+            auto at = now + static_cast<uint32_t>(i * TICKS_PER_SECOND / refreshes);
+            wheel.rearm(timers[client], at + 30 * TICKS_PER_SECOND + random() % (60 * TICKS_PER_SECOND));
+        }
+        now += TICKS_PER_SECOND;
+        fired += wheel.advance(now, [&](mqtt_sn::TimerWheel::TimerId timer, uint64_t client) {
+            wheel.rearm(timer, now + 30 * TICKS_PER_SECOND + static_cast<uint32_t>(client % (60 * TICKS_PER_SECOND)));
+        });
+    }
+    state.SetItemsProcessed(state.iterations() * refreshes);
+    state.counters["fired/s"] = benchmark::Counter(double(fired) / double(state.iterations()));
+}
+BENCHMARK(BM_TimerWheelChurn)->Args({1000000, 10})->Unit(benchmark::kMillisecond);
+
+/***
+ * Refreshing a client's keep-alive deadline on every received frame.
+ */
+void BM_KeepAliveOnMessage(benchmark::State& state) {
+    const auto client_count = static_cast<size_t>(state.range(0));
+    mqtt_sn::KeepAlive keep_alive({TICKS_PER_SECOND, 150});
+
+    mqtt_sn::Connect connect {};
+    connect.duration = 60;
+    for (size_t i = 0; i < client_count; ++i) {
+        keep_alive.on_connect(static_cast<mqtt_sn::ClientId>(i), connect, 0);
+    }
+
+    std::mt19937 random(42);
+    uint32_t now = 0;
+    for (auto _ : state) {
+        keep_alive.on_message(static_cast<mqtt_sn::ClientId>(random() % client_count), ++now);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_KeepAliveOnMessage)->Arg(1000000);
+
+}
@@ -0,0 +1,61 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+
+#include <netinet/in.h>
+
+#include <mqtt-sn/udp_engine.h>
+
+namespace {
+
+using mqtt_sn::net::Endpoint;
+using mqtt_sn::net::UdpEngine;
+
+/***
+ * One iteration sends a batch of state.range(1) 32-byte PUBLISHes over loopback and receives
+ * it on the other side, parsed with parse_batch(). state.range(0) selects the backend.
+ */
+void BM_UdpEngineLoopback(benchmark::State& state) {
+    UdpEngine::Config config;
+    config.backend = static_cast<UdpEngine::Backend>(state.range(0));
+    config.batch_size = static_cast<size_t>(state.range(1));
+    UdpEngine sender(config);
+    UdpEngine receiver(config);
+    if (!sender.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)) || !receiver.open(Endpoint::ipv4(INADDR_LOOPBACK, 0))) {
+        state.SkipWithError("cannot open loopback sockets");
+        return;
+    }
+    state.SetLabel(receiver.backend() == UdpEngine::Backend::IoUring ? "io_uring" : "mmsg");
+
+    mqtt_sn::PublishMessage message {};
+    message.topic_id = 1;
+    message.payload.assign(25, 0x55);
+    mqtt_sn::Message publish = message;
+    auto to = receiver.local_endpoint();
+    mqtt_sn::format::ParsedBatch batch;
+
+    for (auto _ : state) {
+        for (size_t i = 0; i < config.batch_size; ++i) {
+            sender.send(publish, to);
+        }
+        sender.flush();
+
+        size_t received = 0;
+        while (received < config.batch_size) {
+            if (receiver.receive() <= 0) {
+                state.SkipWithError("receive failed");
+                return;
+            }
+            received += mqtt_sn::format::parse_batch(receiver.datagrams(), receiver.received(), batch);
+        }
+        benchmark::DoNotOptimize(batch.message_ids.data());
+    }
+
+    auto messages = state.iterations() * state.range(1);
+    state.SetItemsProcessed(messages);
+    state.counters["syscalls/msg"] =
+        benchmark::Counter(double(sender.stats().syscalls + receiver.stats().syscalls) / double(messages));
+}
+BENCHMARK(BM_UdpEngineLoopback)->ArgsProduct({{0, 1}, {1, 64}});
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdlib>
+
+namespace fuzz {
+
+/***
+ * A broken invariant crashes the target, so that the fuzzer keeps the input that caused it.
+ */
+inline void require(bool condition) {
+    if (!condition) {
+        std::abort();
+    }
+}
+
+}
@@ -0,0 +1,134 @@
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+#include "check.h"
+
+/***
+ * Feeds the input to every decoding entry point and checks that they agree with parse() on
+ * where the frame ends, and that whatever they return lies within the input.
+ */
+namespace {
+
+using namespace mqtt_sn;
+using fuzz::require;
+
+const uint8_t* input_begin;
+const uint8_t* input_end;
+
+void require_within(ByteView view) {
+    require(view.empty() || (view.begin() >= input_begin && view.end() <= input_end));
+}
+
+void check_single_frame(const uint8_t* data, size_t size) {
+    auto reader = format::BufferReader(data, size);
+    auto message = format::parse(reader);
+
+    auto view_reader = format::BufferReader(data, size);
+    auto view = format::parse_view(view_reader);
+    require(message.has_value() == view.has_value());
+
+    format::Arena arena;
+    auto arena_reader = format::BufferReader(data, size);
+    auto pmr_message = format::parse(arena_reader, arena);
+    require(message.has_value() == pmr_message.has_value());
+
+    auto try_reader = format::BufferReader(data, size);
+    auto result = format::try_parse(try_reader);
+    require(message.has_value() == result.has_value());
+    require(result.has_value() || result.offset() <= size);
+
+    auto lazy_reader = format::BufferReader(data, size);
+    auto lazy = format::parse_lazy(lazy_reader);
+    if (lazy) {
+        lazy->flags();
+        lazy->topic_id();
+        lazy->message_id();
+        require_within(lazy->frame());
+        require_within(lazy->payload());
+    }
+
+    auto extent = format::frame_extent(data, size);
+    if (message) {
+        require(view_reader.read_offset() == reader.read_offset());
+        require(arena_reader.read_offset() == reader.read_offset());
+        require(try_reader.read_offset() == reader.read_offset());
+        require(view->index() == message->index());
+        require(pmr_message->index() == message->index());
+        require(extent.status == format::FrameStatus::Complete && extent.size == reader.read_offset());
+        require(lazy.has_value() && lazy_reader.read_offset() == reader.read_offset());
+    }
+
+    auto forward = format::unwrap_forward(data, size);
+    if (forward) {
+        require_within(forward->gateway_addr);
+        require_within(forward->payload);
+    }
+
+    format::ParsedBatch batch;
+    format::Datagram datagram {data, size};
+    if (format::parse_batch(&datagram, 1, batch) == 1) {
+        require_within(batch.payloads[0]);
+    }
+}
+
+/***
+ * The input as a byte stream: split_frames() and a StreamDecoder fed in two chunks must find the
+ * same frames and stop for the same reason.
+ */
+void check_stream(const uint8_t* data, size_t size) {
+    format::FrameIndex index;
+    auto split = format::split_frames(data, size, index);
+    require(split.consumed <= size);
+
+    size_t offset = 0;
+    for (size_t i = 0; i < index.size(); ++i) {
+        require(index.offsets[i] == offset);
+        offset += index.sizes[i];
+    }
+    require(offset == split.consumed);
+
+    format::StreamDecoder decoder;
+    std::vector<std::vector<uint8_t>> frames;
+    auto status = format::StreamDecoder::Status::NeedMore;
+    const auto drain = [&] {
+        for (;;) {
+            auto result = decoder.next();
+            status = result.status;
+            if (status != format::StreamDecoder::Status::Frame) {
+                return;
+            }
+            frames.emplace_back(result.frame.begin(), result.frame.end());
+        }
+    };
+    decoder.feed(data, size / 2);
+    drain();
+    if (status != format::StreamDecoder::Status::Error) {
+        decoder.feed(data + size / 2, size - size / 2);
+        drain();
+    }
+
+    require(frames.size() == index.size());
+    for (size_t i = 0; i < index.size(); ++i) {
+        require(ByteView(frames[i].data(), frames[i].size()) == index.frame(i));
+    }
+    if (split.status == format::FrameStatus::Malformed) {
+        require(status == format::StreamDecoder::Status::Error);
+    } else {
+        require(status == format::StreamDecoder::Status::NeedMore);
+        require(decoder.buffered_bytes() == size - split.consumed);
+    }
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    input_begin = data;
+    input_end = data + size;
+
+    check_single_frame(data, size);
+    check_stream(data, size);
+    return 0;
+}
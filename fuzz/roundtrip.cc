@@ -0,0 +1,74 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mqtt-sn/compact_message.h>
+#include <mqtt-sn/format.h>
+
+#include "check.h"
+
+/***
+ * Whatever parse() accepts must encode to a frame that parses back to the same alternative and
+ * encodes to the very same bytes again, through every encoder.
+ */
+namespace {
+
+using namespace mqtt_sn;
+using fuzz::require;
+
+bool same(const std::vector<uint8_t>& lhs, ByteView rhs) {
+    return ByteView(lhs.data(), lhs.size()) == rhs;
+}
+
+}
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    auto reader = format::BufferReader(data, size);
+    auto message = format::parse(reader);
+    if (!message) {
+        return 0;
+    }
+
+    format::BufferWriter encoded;
+    format::encode(*message, encoded);
+    require(encoded.size() == format::encoded_size(*message));
+
+    std::vector<uint8_t> into(encoded.size());
+    require(format::encode_into(*message, into.data(), into.size()) == encoded.size());
+    require(into == encoded);
+    require(!format::encode_into(*message, into.data(), into.size() - 1));
+
+    std::vector<uint8_t> gathered(format::header_size(*message));
+    require(format::encode_header(*message, gathered.data()) == gathered.size());
+    auto payload = format::encoded_payload(*message);
+    gathered.insert(gathered.end(), payload.begin(), payload.end());
+    require(gathered == encoded);
+
+    require(same(encoded, CompactMessage(*message).frame()));
+
+    auto encoded_reader = format::BufferReader(encoded.data(), encoded.size());
+    auto reparsed = format::parse(encoded_reader);
+    require(reparsed.has_value());
+    require(encoded_reader.readable_bytes() == 0);
+    require(reparsed->index() == message->index());
+
+    format::BufferWriter reencoded;
+    format::encode(*reparsed, reencoded);
+    require(reencoded == encoded);
+
+    // The arena-backed and view decoders encode to the same frame.
+    format::Arena arena;
+    auto arena_reader = format::BufferReader(data, size);
+    auto pmr_message = format::parse(arena_reader, arena);
+    require(pmr_message.has_value());
+    format::BufferWriter pmr_encoded;
+    format::encode(*pmr_message, pmr_encoded);
+    require(pmr_encoded == encoded);
+
+    auto view_reader = format::BufferReader(data, size);
+    auto view = format::parse_view(view_reader);
+    require(view.has_value());
+    require(same(encoded, CompactMessage(*view).frame()));
+    return 0;
+}
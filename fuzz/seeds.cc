@@ -0,0 +1,53 @@
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+#include "messages.h"
+
+/***
+ * Writes the seed corpus: the frames of the messages in test/messages.h, which the format tests
+ * round-trip, and a stream of them back to back.
+ *
+ * Usage: mqtt-sn-format-fuzz-seeds <directory>
+ */
+namespace {
+
+using namespace mqtt_sn;
+
+bool write(const std::filesystem::path& path, const std::vector<uint8_t>& frame) {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(frame.data()), static_cast<std::streamsize>(frame.size()));
+    return static_cast<bool>(file);
+}
+
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::fprintf(stderr, "usage: %s <directory>\n", argv[0]);
+        return 1;
+    }
+
+    std::filesystem::path directory(argv[1]);
+    std::filesystem::create_directories(directory);
+
+    format::BufferWriter stream;
+    for (const auto& [name, message] : fixtures::messages()) {
+        format::BufferWriter frame;
+        format::encode(message, frame);
+        format::encode(message, stream);
+        if (!write(directory / name, frame)) {
+            std::fprintf(stderr, "cannot write %s\n", (directory / name).c_str());
+            return 1;
+        }
+    }
+
+    if (!write(directory / "stream", stream)) {
+        std::fprintf(stderr, "cannot write %s\n", (directory / "stream").c_str());
+        return 1;
+    }
+    return 0;
+}
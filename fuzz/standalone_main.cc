@@ -0,0 +1,48 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+
+/***
+ * Replay driver for compilers without libFuzzer: runs the target once on every file given on the
+ * command line, or in a directory given there. Options (-runs=0, ...) are ignored.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size);
+
+namespace {
+
+void run(const std::filesystem::path& path) {
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> input((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    LLVMFuzzerTestOneInput(input.data(), input.size());
+}
+
+}
+
+int main(int argc, char** argv) {
+    size_t runs = 0;
+    for (int i = 1; i < argc; ++i) {
+        if (argv[i][0] == '-') {
+            continue;
+        }
+
+        std::filesystem::path path(argv[i]);
+        if (std::filesystem::is_directory(path)) {
+            for (const auto& entry : std::filesystem::directory_iterator(path)) {
+                if (entry.is_regular_file()) {
+                    run(entry.path());
+                    ++runs;
+                }
+            }
+        } else {
+            run(path);
+            ++runs;
+        }
+    }
+
+    std::printf("Executed %zu inputs\n", runs);
+    return 0;
+}
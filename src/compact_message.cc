@@ -0,0 +1,114 @@
+#include <mqtt-sn/compact_message.h>
+
+#include <algorithm>
+#include <cstring>
+
+namespace mqtt_sn {
+
+CompactMessage::CompactMessage(const Message& message) {
+    auto size = format::encoded_size(message);
+    if (size) {
+        format::encode_into(message, allocate(*size), *size);
+    }
+}
+
+CompactMessage::CompactMessage(const MessageView& message) {
+    auto header = format::header_size(message);
+    auto payload = format::encoded_payload(message);
+    auto data = allocate(header + payload.size());
+    if (format::encode_header(message, data) == 0) {
+        release();
+        return;
+    }
+    std::copy(payload.begin(), payload.end(), data + header);
+}
+
+CompactMessage::CompactMessage(ByteView frame) {
+    std::copy(frame.begin(), frame.end(), allocate(frame.size()));
+}
+
+CompactMessage::CompactMessage(const CompactMessage& other) {
+    auto frame = other.frame();
+    std::copy(frame.begin(), frame.end(), allocate(frame.size()));
+}
+
+CompactMessage::CompactMessage(CompactMessage&& other) noexcept {
+    std::memcpy(_storage, other._storage, sizeof(_storage));
+    _size = other._size;
+    other._size = 0;
+}
+
+CompactMessage& CompactMessage::operator=(const CompactMessage& other) {
+    if (this != &other) {
+        *this = CompactMessage(other);
+    }
+    return *this;
+}
+
+CompactMessage& CompactMessage::operator=(CompactMessage&& other) noexcept {
+    if (this != &other) {
+        release();
+        std::memcpy(_storage, other._storage, sizeof(_storage));
+        _size = other._size;
+        other._size = 0;
+    }
+    return *this;
+}
+
+CompactMessage::~CompactMessage() {
+    release();
+}
+
+ByteView CompactMessage::frame() const {
+    if (is_inline()) {
+        return ByteView(_storage, _size);
+    }
+    auto block = heap();
+    return ByteView(block.data, block.size);
+}
+
+MessageType CompactMessage::type() const {
+    assert(!empty());
+    auto frame = this->frame();
+    // The 3-byte length form starts with 0x01.
+    return static_cast<MessageType>(frame[0] == 0x01 ? frame[3] : frame[1]);
+}
+
+optional<MessageView> CompactMessage::view() const {
+    auto frame = this->frame();
+    auto reader = format::BufferReader(frame.data(), frame.size());
+    return format::parse_view(reader);
+}
+
+optional<Message> CompactMessage::message() const {
+    auto frame = this->frame();
+    auto reader = format::BufferReader(frame.data(), frame.size());
+    return format::parse(reader);
+}
+
+uint8_t* CompactMessage::allocate(size_t size) {
+    if (size <= INLINE_CAPACITY) {
+        _size = static_cast<uint8_t>(size);
+        return _storage;
+    }
+
+    Heap block {new uint8_t[size], static_cast<uint32_t>(size)};
+    std::memcpy(_storage, &block, sizeof(block));
+    _size = HEAP;
+    return block.data;
+}
+
+void CompactMessage::release() {
+    if (!is_inline()) {
+        delete[] heap().data;
+    }
+    _size = 0;
+}
+
+CompactMessage::Heap CompactMessage::heap() const {
+    Heap block;
+    std::memcpy(&block, _storage, sizeof(block));
+    return block;
+}
+
+}
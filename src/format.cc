@@ -1,538 +1,1225 @@
 #include <cstdint>
 #include <mqtt-sn/format.h>
 
+#include <array>
 #include <cassert>
+#include <new>
+#include <tuple>
+#include <utility>
 
-#define assertm(exp, msg) assert((void(msg), exp))
+#include "stats_counters.h"
 
-template<class... Ts>
-struct overloads : Ts... { using Ts::operator()...; };
-// explicit deduction guide (not needed as of C++20)
-template<class... Ts>
-overloads(Ts...) -> overloads<Ts...>;
+#define assertm(exp, msg) assert((void(msg), exp))
 
 namespace mqtt_sn::format {
 
-optional<Message> parse(BufferReader& buffer) {
-    if (buffer.readable_bytes() < 2) {
+namespace {
+
+template<typename T>
+struct is_optional : std::false_type {};
+
+template<typename T>
+struct is_optional<optional<T>> : std::true_type {};
+
+/***
+ * Variable-length field types: owning strings and byte vectors, and their views.
+ */
+template<typename T>
+struct is_variable : std::bool_constant<is_string<T>::value || is_vector<T>::value
+                                        || std::is_same<T, std::string_view>::value
+                                        || std::is_same<T, ByteView>::value> {};
+
+template<typename T>
+struct unwrap_optional {
+    using type = T;
+};
+
+template<typename T>
+struct unwrap_optional<optional<T>> {
+    using type = T;
+};
+
+template<typename T>
+using unwrap_optional_t = typename unwrap_optional<T>::type;
+
+template<auto Member>
+struct member_traits;
+
+template<typename Class, typename T, T Class::*Member>
+struct member_traits<Member> {
+    using type = T;
+};
+
+template<auto Member>
+using member_t = typename member_traits<Member>::type;
+
+template<typename Layout>
+struct layout_traits;
+
+template<MessageType Type, typename... Fields>
+struct layout_traits<layout::Frame<Type, Fields...>> {
+    static constexpr size_t field_count = sizeof...(Fields);
+};
+
+/***
+ * Bytes a field always occupies. Topic ids are only present for some topic id types,
+ * so they are checked when read.
+ */
+template<typename Field>
+struct fixed_size : std::integral_constant<size_t, 0> {};
+
+template<auto Member>
+struct fixed_size<layout::Field<Member>> : std::integral_constant<size_t, sizeof(member_t<Member>)> {};
+
+template<typename Field>
+struct is_fixed : std::false_type {};
+
+template<auto Member>
+struct is_fixed<layout::Field<Member>> : std::true_type {};
+
+/***
+ * Whether no fixed field follows a variable one, so that the fixed fields sit at known offsets.
+ */
+template<typename... Fields>
+constexpr bool fixed_fields_lead() {
+    bool variable_seen = false;
+    bool ordered = true;
+    ((is_fixed<Fields>::value ? void(ordered = ordered && !variable_seen) : void(variable_seen = true)), ...);
+    return ordered;
+}
+
+template<typename Layout>
+struct min_body_size_of;
+
+template<MessageType Type, typename... Fields>
+struct min_body_size_of<layout::Frame<Type, Fields...>> : std::integral_constant<size_t, (fixed_size<Fields>::value + ... + 0)> {
+    static_assert(fixed_fields_lead<Fields...>(), "Fixed fields must precede variable-length ones");
+};
+
+template<typename Variant, size_t I>
+using alternative_layout = typename std::variant_alternative_t<I, Variant>::Layout;
+
+/***
+ * Smallest body (bytes after the type field) of each message type, or -1 for types this codec
+ * does not know. Where two alternatives share a type (WillTopic, WillTopicEmpty) the smaller wins.
+ */
+template<typename Variant, size_t... I>
+constexpr std::array<int, 256> make_min_body_sizes(std::index_sequence<I...>) {
+    std::array<int, 256> sizes {};
+    for (auto& size : sizes) {
+        size = -1;
+    }
+    const auto update = [&](size_t type, int size) {
+        if (sizes[type] < 0 || size < sizes[type]) {
+            sizes[type] = size;
+        }
+    };
+    (update(static_cast<size_t>(alternative_layout<Variant, I>::type), int(min_body_size_of<alternative_layout<Variant, I>>::value)), ...);
+    return sizes;
+}
+
+constexpr auto MIN_BODY_SIZES = make_min_body_sizes<Message>(std::make_index_sequence<std::variant_size_v<Message>>());
+
+constexpr optional<size_t> min_body_size(MessageType type) {
+    auto size = MIN_BODY_SIZES[static_cast<size_t>(type)];
+    if (size < 0) {
         return nullopt;
     }
+    return static_cast<size_t>(size);
+}
+
+/***
+ * LazyFrame offset tables. The routing fields are recognised by name: flags by their type, topic
+ * and message ids by comparing the layout's member pointer with T::topic_id and T::message_id.
+ */
+template<typename T, typename = void>
+struct topic_id_member {
+    static constexpr std::nullptr_t value = nullptr;
+};
+
+template<typename T>
+struct topic_id_member<T, std::void_t<decltype(&T::topic_id)>> {
+    static constexpr auto value = &T::topic_id;
+};
+
+template<typename T, typename = void>
+struct message_id_member {
+    static constexpr std::nullptr_t value = nullptr;
+};
+
+template<typename T>
+struct message_id_member<T, std::void_t<decltype(&T::message_id)>> {
+    static constexpr auto value = &T::message_id;
+};
+
+template<auto Member, auto Other>
+constexpr bool is_member() {
+    if constexpr (std::is_same<decltype(Member), decltype(Other)>::value) {
+        return Member == Other;
+    } else {
+        return false;
+    }
+}
 
+template<typename T, auto Member>
+constexpr void add_offset(layout::Field<Member>, LazyFrame::Offsets& offsets, size_t& at) {
+    if constexpr (std::is_same<member_t<Member>, MessageFlags>::value) {
+        offsets.flags = static_cast<int8_t>(at);
+    } else if constexpr (is_member<Member, topic_id_member<T>::value>()) {
+        offsets.topic_id = static_cast<int8_t>(at);
+    } else if constexpr (is_member<Member, message_id_member<T>::value>()) {
+        offsets.message_id = static_cast<int8_t>(at);
+    }
+    at += sizeof(member_t<Member>);
+}
+
+template<typename T, auto Member>
+constexpr void add_offset(layout::Tail<Member>, LazyFrame::Offsets& offsets, size_t& at) {
+    if constexpr (is_variable<unwrap_optional_t<member_t<Member>>>::value) {
+        offsets.tail = static_cast<int8_t>(at);
+    }
+}
+
+template<typename T, auto Flags, auto Member>
+constexpr void add_offset(layout::Topic<Flags, Member>, LazyFrame::Offsets& offsets, size_t& at) {
+    offsets.topic = true;
+    offsets.topic_id = static_cast<int8_t>(at);
+    offsets.tail = static_cast<int8_t>(at);
+}
+
+template<typename T, auto Member>
+constexpr void add_offset(layout::Encapsulated<Member>, LazyFrame::Offsets& offsets, size_t&) {
+    offsets.encapsulated = true;
+}
+
+template<typename T, MessageType Type, typename... Fields>
+constexpr LazyFrame::Offsets make_offsets(layout::Frame<Type, Fields...>) {
+    LazyFrame::Offsets offsets {};
+    [[maybe_unused]] size_t at = 0;
+    (add_offset<T>(Fields {}, offsets, at), ...);
+    return offsets;
+}
+
+/***
+ * Offsets per type byte. Field-less alternatives are skipped, as the alternative sharing their
+ * type (e.g. WillTopic for WillTopicEmpty) describes the fields when there are any.
+ */
+template<typename Variant, size_t... I>
+constexpr std::array<LazyFrame::Offsets, 256> make_offset_table(std::index_sequence<I...>) {
+    std::array<LazyFrame::Offsets, 256> table {};
+    ((layout_traits<alternative_layout<Variant, I>>::field_count > 0
+          ? void(table[static_cast<size_t>(alternative_layout<Variant, I>::type)] =
+                     make_offsets<std::variant_alternative_t<I, Variant>>(alternative_layout<Variant, I> {}))
+          : void()), ...);
+    return table;
+}
+
+constexpr auto FIELD_OFFSETS = make_offset_table<MessageView>(std::make_index_sequence<std::variant_size_v<MessageView>>());
+
+static_assert(FIELD_OFFSETS[static_cast<size_t>(MessageType::Publish)].topic_id == 1);
+static_assert(FIELD_OFFSETS[static_cast<size_t>(MessageType::Publish)].message_id == 3);
+static_assert(FIELD_OFFSETS[static_cast<size_t>(MessageType::Publish)].tail == 5);
+
+template<typename T>
+T load(const uint8_t* src) {
+    static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+
+    T value;
+    std::copy(src, src + sizeof(T), reinterpret_cast<uint8_t*>(&value));
+    return network_order(value);
+}
+
+/***
+ * frame_extent(), for a frame that may or may not be encapsulated. An encapsulated frame must not
+ * be a Forward: the spec wraps exactly one frame, and nesting would let a peer chain Forward
+ * headers so that a stream never completes and the recursion has no bound.
+ */
+FrameExtent extent_of(const uint8_t* data, size_t size, bool encapsulated) {
+    if (size < 1) {
+        return {FrameStatus::NeedMore, 2};
+    }
+
+    size_t len = data[0];
+    size_t header_len = sizeof(uint8_t) + sizeof(uint8_t);
+    if (len == 1) {
+        header_len += sizeof(uint16_t);
+        if (size < 1 + sizeof(uint16_t)) {
+            return {FrameStatus::NeedMore, header_len};
+        }
+        len = load<uint16_t>(data + 1);
+    }
+
+    if (len < header_len) {
+        return {FrameStatus::Malformed, 0};
+    }
+    if (size < header_len) {
+        return {FrameStatus::NeedMore, header_len};
+    }
+
+    if (static_cast<MessageType>(data[header_len - 1]) != MessageType::Forward) {
+        if (size < len) {
+            return {FrameStatus::NeedMore, len};
+        }
+        return {FrameStatus::Complete, len};
+    }
+
+    if (encapsulated || len < header_len + sizeof(uint8_t)) {
+        return {FrameStatus::Malformed, 0};
+    }
+
+    auto inner = extent_of(data + std::min(len, size), size - std::min(len, size), true);
+    switch (inner.status) {
+        case FrameStatus::Complete:
+            return {FrameStatus::Complete, len + inner.size};
+        case FrameStatus::NeedMore:
+            return {FrameStatus::NeedMore, len + inner.size};
+        default:
+            return inner;
+    }
+}
+
+FrameExtent encapsulated_extent(const uint8_t* data, size_t size) {
+    return extent_of(data, size, true);
+}
+
+struct FrameHeader {
+    MessageType type;
+    size_t len;         // whole frame, including the length and type fields
+    size_t body_len;    // bytes following the type field
+};
+
+/***
+ * Why and where a frame was rejected, for try_parse().
+ */
+struct Failure {
+    ParseError error;
+    size_t offset;
+};
+
+/***
+ * Counts a rejected frame and, when the caller asked for it, records why and where.
+ */
+void reject(Failure* failure, ParseError error, size_t offset) {
+    stats::on_malformed(error);
+    if (failure != nullptr) {
+        *failure = {error, offset};
+    }
+}
+
+/***
+ * Reads and validates the length and type fields of the frame at the current offset:
+ * the frame must fit in the buffer, be of a known type and be long enough for that type.
+ */
+optional<FrameHeader> read_header(BufferReader& buffer, Failure* failure = nullptr) {
     auto base_offset = buffer.read_offset();
-    uint16_t len = buffer.read<uint8_t>().value();
+    if (buffer.readable_bytes() < 2) {
+        reject(failure, ParseError::Truncated, base_offset);
+        return nullopt;
+    }
+
+    size_t len = buffer.read_unchecked<uint8_t>();
     if (len == 1) {
-        if (buffer.readable_bytes() < sizeof(uint8_t) + sizeof(uint16_t)) {
+        if (buffer.readable_bytes() < sizeof(uint16_t) + sizeof(uint8_t)) {
+            reject(failure, ParseError::Truncated, base_offset);
             return nullopt;
         }
 
-        len = buffer.read<uint16_t>().value();   
+        len = buffer.read_unchecked<uint16_t>();
     }
-    
-    if (buffer.size() - base_offset < len) {
+
+    auto type = buffer.read_unchecked<uint8_t>();
+    auto header_len = buffer.read_offset() - base_offset;
+    if (len < header_len) {
+        reject(failure, ParseError::BadLength, base_offset);
+        return nullopt;
+    }
+    if (len - header_len > buffer.readable_bytes()) {
+        reject(failure, ParseError::Truncated, base_offset);
         return nullopt;
     }
 
-    auto type = buffer.read<uint8_t>();
-    if (!type) {
+    MessageType msg_type = static_cast<MessageType>(type);
+    auto min_len = min_body_size(msg_type);
+    if (!min_len) {
+        reject(failure, ParseError::UnknownType, buffer.read_offset() - 1);
         return nullopt;
     }
+    if (len - header_len < *min_len) {
+        reject(failure, ParseError::TooShort, base_offset);
+        return nullopt;
+    }
+
+    return FrameHeader {msg_type, len, len - header_len};
+}
+
+/***
+ * Builds a variable-length field of type V over the given bytes: views reference them,
+ * owning types copy them, using @p resource when their allocator is polymorphic.
+ */
+template<typename V>
+V make_variable(const uint8_t* data, size_t size, std::pmr::memory_resource* resource) {
+    if constexpr (std::is_same<V, std::string_view>::value) {
+        return V(reinterpret_cast<const char*>(data), size);
+    } else if constexpr (std::is_same<V, ByteView>::value) {
+        return V(data, size);
+    } else if constexpr (std::is_constructible<typename V::allocator_type, std::pmr::memory_resource*>::value) {
+        return V(data, data + size, typename V::allocator_type(resource));
+    } else {
+        return V(data, data + size);
+    }
+}
+
+/***
+ * Replaces a variable-length member by move construction. Assignment would copy the bytes into
+ * the member's existing allocator, as pmr containers do not propagate theirs.
+ */
+template<typename V>
+void emplace_variable(V& target, V&& value) {
+    target.~V();
+    new (&target) V(std::move(value));
+}
+
+/***
+ * Reads a Tail value from everything left in @p body.
+ */
+template<typename V>
+bool decode_tail(BufferReader& body, V& value, std::pmr::memory_resource* resource) {
+    if constexpr (is_variable<V>::value) {
+        emplace_variable(value, make_variable<V>(body.data() + body.read_offset(), body.readable_bytes(), resource));
+        body.skip(body.readable_bytes());
+        return true;
+    } else {
+        if (!body.readable<V>()) {
+            return false;
+        }
+        value = body.read_unchecked<V>();
+        return true;
+    }
+}
+
+/***
+ * Field decoders. @p body is bounded to the frame body; @p buffer is positioned right after it.
+ * Fixed fields lead every layout and read_header() has checked the body against their total
+ * size, so they are read without further checks.
+ */
+template<typename T, auto Member>
+bool decode_field(layout::Field<Member>, T& message, BufferReader& body, BufferReader&, std::pmr::memory_resource*) {
+    message.*Member = body.read_unchecked<member_t<Member>>();
+    return true;
+}
+
+template<typename T, auto Member>
+bool decode_field(layout::Tail<Member>, T& message, BufferReader& body, BufferReader&, std::pmr::memory_resource* resource) {
+    using V = member_t<Member>;
+    if constexpr (is_optional<V>::value) {
+        if (body.readable_bytes() == 0) {
+            return true;
+        }
+
+        typename V::value_type value {};
+        if (!decode_tail(body, value, resource)) {
+            return false;
+        }
+        message.*Member = std::move(value);
+        return true;
+    } else {
+        return decode_tail(body, message.*Member, resource);
+    }
+}
+
+template<typename T, auto Flags, auto Member>
+bool decode_field(layout::Topic<Flags, Member>, T& message, BufferReader& body, BufferReader&, std::pmr::memory_resource* resource) {
+    using Name = std::variant_alternative_t<1, member_t<Member>>;
+    if (static_cast<TopicIdType>((message.*Flags).topic_id_type) == TopicIdType::Normal) {
+        message.*Member = make_variable<Name>(body.data() + body.read_offset(), body.readable_bytes(), resource);
+        body.skip(body.readable_bytes());
+        return true;
+    }
+
+    if (!body.readable<uint16_t>()) {
+        return false;
+    }
+    message.*Member = body.read_unchecked<uint16_t>();
+    return true;
+}
+
+template<typename T, auto Member>
+bool decode_field(layout::Encapsulated<Member>, T& message, BufferReader&, BufferReader& buffer, std::pmr::memory_resource* resource) {
+    auto data = buffer.data() + buffer.read_offset();
+    auto inner = encapsulated_extent(data, buffer.readable_bytes());
+    if (inner.status != FrameStatus::Complete) {
+        return false;
+    }
+    emplace_variable(message.*Member, make_variable<member_t<Member>>(data, inner.size, resource));
+    buffer.skip(inner.size);
+    return true;
+}
+
+template<typename T, MessageType Type, typename... Fields>
+bool decode_fields(layout::Frame<Type, Fields...>, T& message, BufferReader& body, BufferReader& buffer, [[maybe_unused]] std::pmr::memory_resource* resource) {
+    return (decode_field(Fields {}, message, body, buffer, resource) && ...);
+}
+
+/***
+ * Index of the field-less alternative sharing alternative I's type (e.g. WillTopicEmpty for
+ * WillTopic), which is what an empty body decodes to, or variant_npos.
+ */
+template<typename Variant, size_t I, size_t... J>
+constexpr size_t empty_alternative(std::index_sequence<J...>) {
+    size_t found = std::variant_npos;
+    ((J != I && alternative_layout<Variant, J>::type == alternative_layout<Variant, I>::type
+             && layout_traits<alternative_layout<Variant, J>>::field_count == 0 ? void(found = J) : void()), ...);
+    return found;
+}
+
+template<typename Variant>
+using Decoder = optional<Variant> (*)(BufferReader& body, BufferReader& buffer, std::pmr::memory_resource* resource);
+
+template<typename Variant, size_t I>
+optional<Variant> decode_alternative(BufferReader& body, BufferReader& buffer, std::pmr::memory_resource* resource) {
+    constexpr size_t empty = empty_alternative<Variant, I>(std::make_index_sequence<std::variant_size_v<Variant>>());
+    if constexpr (empty != std::variant_npos) {
+        if (body.readable_bytes() == 0) {
+            return Variant(std::in_place_index<empty>);
+        }
+    }
 
-    if (len - (buffer.read_offset() - base_offset) > buffer.readable_bytes()) {
+    std::variant_alternative_t<I, Variant> message {};
+    if (!decode_fields(alternative_layout<Variant, I> {}, message, body, buffer, resource)) {
         return nullopt;
     }
+    return Variant(std::in_place_index<I>, std::move(message));
+}
+
+/***
+ * Decoder per type byte. A field-less alternative only takes the slot when no other
+ * alternative has the same type, as the other one handles empty bodies itself.
+ */
+template<typename Variant, size_t... I>
+constexpr std::array<Decoder<Variant>, 256> make_decoders(std::index_sequence<I...>) {
+    std::array<Decoder<Variant>, 256> decoders {};
+    // Field-less alternatives go first so that the others overwrite them. Function pointers are
+    // not compared, as GCC's UBSan instrumentation rejects that in constant expressions.
+    const auto update = [&](bool with_fields) {
+        (((layout_traits<alternative_layout<Variant, I>>::field_count > 0) == with_fields
+              ? void(decoders[static_cast<size_t>(alternative_layout<Variant, I>::type)] = &decode_alternative<Variant, I>)
+              : void()), ...);
+    };
+    update(false);
+    update(true);
+    return decoders;
+}
 
-    MessageType msg_type = static_cast<MessageType>(type.value());
-    switch (msg_type) {
-        case MessageType::Advertise:
-            return Advertise {buffer.read<uint8_t>().value(), buffer.read<uint16_t>().value()};
-        case MessageType::SearchGateway:
-            return SearchGateway {buffer.read<uint8_t>().value()};
-        case MessageType::GatewayInfo: 
-            if (sizeof(uint8_t) == len - (buffer.read_offset() - base_offset)) {
-                return GatewayInfo {buffer.read<uint8_t>().value(), nullopt};
+template<typename Variant>
+optional<Variant> decode(BufferReader& buffer, std::pmr::memory_resource* resource, Failure* failure = nullptr) {
+    static constexpr auto decoders = make_decoders<Variant>(std::make_index_sequence<std::variant_size_v<Variant>>());
+
+    [[maybe_unused]] stats::DecodeCycles cycles;
+    auto header = read_header(buffer, failure);
+    if (!header) {
+        return nullopt;
+    }
+
+    auto body_offset = buffer.read_offset();
+    auto body = BufferReader(buffer.data() + body_offset, header->body_len);
+    buffer.skip(header->body_len);
+    auto message = decoders[static_cast<size_t>(header->type)](body, buffer, resource);
+    if (message) {
+        stats::on_decoded(header->type, header->len, header->len - header->body_len > 2);
+    } else {
+        // Fields are decoded in order, so the body reader stops at the one that failed; an
+        // encapsulated frame is only decoded once the whole body has been.
+        auto encapsulated = FIELD_OFFSETS[static_cast<size_t>(header->type)].encapsulated && body.readable_bytes() == 0;
+        reject(failure, ParseError::BadField, encapsulated ? buffer.read_offset() : body_offset + body.read_offset());
+    }
+    return message;
+}
+
+template<typename Variant>
+ParseResult<Variant> try_decode(BufferReader& buffer, std::pmr::memory_resource* resource) {
+    Failure failure {};
+    auto message = decode<Variant>(buffer, resource, &failure);
+    if (!message) {
+        return ParseResult<Variant>(failure.error, failure.offset);
+    }
+    return ParseResult<Variant>(std::move(*message));
+}
+
+}
+
+FrameExtent frame_extent(const uint8_t* data, size_t size) {
+    return extent_of(data, size, false);
+}
+
+SplitResult split_frames(const uint8_t* data, size_t size, FrameIndex& index) {
+    index.clear();
+    index.data = data;
+
+    size_t offset = 0;
+    while (offset < size) {
+        auto frame = data + offset;
+        auto remaining = size - offset;
+
+        // Short frames that are not Forwards are the common case and need nothing but their
+        // first byte: a length of 2 or more is the 1-byte form, and the type follows it.
+        size_t len = frame[0];
+        MessageType type;
+        if (len >= 2 && len <= remaining && static_cast<MessageType>(frame[1]) != MessageType::Forward) {
+            type = static_cast<MessageType>(frame[1]);
+        } else {
+            auto extent = frame_extent(frame, remaining);
+            if (extent.status != FrameStatus::Complete) {
+                return {extent.status, offset};
             }
+            len = extent.size;
+            type = static_cast<MessageType>(frame[frame[0] == 1 ? 3 : 1]);
+        }
 
-            return GatewayInfo {buffer.read<uint8_t>().value(),
-                    buffer.read<vector<uint8_t>>(len - (buffer.read_offset() - base_offset))};
-        
+        index.offsets.push_back(static_cast<uint32_t>(offset));
+        index.sizes.push_back(static_cast<uint32_t>(len));
+        index.types.push_back(type);
+        offset += len;
+    }
+    return {FrameStatus::Complete, offset};
+}
 
+optional<ForwardView> unwrap_forward(const uint8_t* data, size_t size) {
+    if (size < 2) {
+        return nullopt;
+    }
 
-        case MessageType::Connect: {
-            return Connect {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<uint8_t>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value()
-            };
+    size_t len = data[0];
+    size_t header_len = sizeof(uint8_t) + sizeof(uint8_t);
+    if (len == 1) {
+        header_len += sizeof(uint16_t);
+        if (size < header_len) {
+            return nullopt;
         }
-        case MessageType::ConnectAck:
-            return ConnectAck {
-                static_cast<MessageErrorCode>(buffer.read<uint8_t>().value())
-            };
-        
-        
-        
-        case MessageType::WillTopicRequest:
-            return WillTopicRequest {};
-        case MessageType::WillTopic: 
-            if (len - (buffer.read_offset() - base_offset) < 1) {
-                return WillTopicEmpty {};
-            }
-            return WillTopic {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value()
-            };
-        case MessageType::WillMessageRequest:
-            return WillMessageRequest {};
-        case MessageType::WillMessage:
-            return WillMessage {
-                buffer.read<vector<uint8_t>>(len - (buffer.read_offset() - base_offset)).value()
-            };
-        case MessageType::WillTopicUpdate:
-            if (len - (buffer.read_offset() - base_offset) < 1) {
-                return WillTopicUpdateEmpty {};
-            }
+        len = load<uint16_t>(data + 1);
+    }
+
+    if (static_cast<MessageType>(data[header_len - 1]) != MessageType::Forward || len < header_len + sizeof(uint8_t) || len > size) {
+        return nullopt;
+    }
+
+    auto inner = encapsulated_extent(data + len, size - len);
+    if (inner.status != FrameStatus::Complete) {
+        return nullopt;
+    }
+    return ForwardView {data[header_len], ByteView(data + header_len + 1, len - header_len - 1), ByteView(data + len, inner.size)};
+}
+
+optional<ByteView> wrap_forward(uint8_t* frame, size_t frame_size, size_t headroom, uint8_t ctrl, ByteView node_id) {
+    auto len = forward_header_size(node_id.size());
+    if (len > headroom || len > UINT16_MAX) {
+        return nullopt;
+    }
+
+    // Forwards do not nest; parse() and unwrap_forward() would refuse the result.
+    auto type_offset = frame_size != 0 && frame[0] == 0x01 ? 3 : 1;
+    if (frame_size > size_t(type_offset) && static_cast<MessageType>(frame[type_offset]) == MessageType::Forward) {
+        return nullopt;
+    }
+
+    auto header = frame - len;
+    auto out = header;
+    if (len <= UINT8_MAX) {
+        *out++ = static_cast<uint8_t>(len);
+    } else {
+        *out++ = 1;
+        *out++ = static_cast<uint8_t>(len >> 8);
+        *out++ = static_cast<uint8_t>(len & 0xFF);
+    }
+    *out++ = static_cast<uint8_t>(MessageType::Forward);
+    *out++ = ctrl;
+    std::copy(node_id.begin(), node_id.end(), out);
+    return ByteView(header, len + frame_size);
+}
+
+void StreamDecoder::feed(const uint8_t* data, size_t size) {
+    assert(_chunk_offset == _chunk_size);
 
-            return WillTopicUpdate {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value()
-            };
-        case MessageType::WillTopicResponse:
-            return WillTopicResponse {
-                buffer.read<MessageErrorCode>().value()
-            };
-        case MessageType::WillMessageUpdate: {
-            return WillMessageUpdate {
-                buffer.read<vector<uint8_t>>(len - (buffer.read_offset() - base_offset)).value()
-            };
+    _chunk = data;
+    _chunk_size = size;
+    _chunk_offset = 0;
+}
+
+StreamDecoder::Result StreamDecoder::next() {
+    if (_error) {
+        return {Status::Error, {}};
+    }
+
+    if (_pending_emitted) {
+        _pending.clear();
+        _pending_emitted = false;
+    }
+
+    // A frame straddling chunks is completed from the buffered prefix. frame_extent() only ever
+    // looks at the length fields, so re-running it as bytes arrive never rescans the payload.
+    while (!_pending.empty()) {
+        auto extent = frame_extent(_pending.data(), _pending.size());
+        if (extent.status == FrameStatus::Malformed) {
+            _error = true;
+            return {Status::Error, {}};
         }
-        case MessageType::WillMessageResponse:
-            return WillMessageResponse {
-                buffer.read<MessageErrorCode>().value()
-            };
-        
-
-        
-        case MessageType::Register:
-            return RegisterTopic {
-                buffer.read<uint16_t>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value()
-            };
-        case MessageType::RegisterAck:
-            return RegisterTopicAck {
-                buffer.read<uint16_t>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<MessageErrorCode>().value()
-            };
-        
-
-        
-        case MessageType::Publish:
-            return PublishMessage {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<vector<uint8_t>>(len - (buffer.read_offset() - base_offset)).value()
-            };
-        case MessageType::PublishAck:
-            return PublishMessageAck {
-                buffer.read<uint16_t>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<MessageErrorCode>().value()
-            };
-        case MessageType::PublishComplete:
-            return PublishMessageComplete {
-                buffer.read<uint16_t>().value()
-            };
-        case MessageType::PublishReceived:
-            return PublishMessageReceived {
-                buffer.read<uint16_t>().value()
-            };
-        case MessageType::PublishRelease:
-            return PublishMessageRelease {
-                buffer.read<uint16_t>().value()
-            };
-        
-
-        
-        case MessageType::Subscribe: {
-            auto sub = Subscribe {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<uint16_t>().value(),
-                uint16_t(0)
-            };
-            auto topic_type = static_cast<TopicIdType>(sub.flags.topic_id_type);
-            if (topic_type == TopicIdType::Normal) {
-                sub.topic = buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value();
-            } else {
-                sub.topic = buffer.read<uint16_t>().value();
-            }
-            return sub;
+        if (extent.status == FrameStatus::Complete) {
+            _pending_emitted = true;
+            return {Status::Frame, ByteView(_pending.data(), extent.size)};
         }
-        case MessageType::SubscribeAck:
-            return SubscribeAck {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<uint16_t>().value(),
-                buffer.read<MessageErrorCode>().value()
-            };
-        case MessageType::Unsubscribe: {
-            auto sub = Unsubscribe {
-                buffer.read<MessageFlags>().value(),
-                buffer.read<uint16_t>().value(),
-                uint16_t(0)
-            };
-            auto topic_type = static_cast<TopicIdType>(sub.flags.topic_id_type);
-            if (topic_type == TopicIdType::Normal) {
-                sub.topic = buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value();
-            } else {
-                sub.topic = buffer.read<uint16_t>().value();
-            }
-            return sub;
+
+        auto take = std::min(extent.size - _pending.size(), _chunk_size - _chunk_offset);
+        if (take == 0) {
+            return {Status::NeedMore, {}};
         }
-        case MessageType::UnsubscribeAck:
-            return UnsubscribeAck {
-                buffer.read<uint16_t>().value()
-            };
-        
-        
-
-        case MessageType::PingRequest:
-            if (len - (buffer.read_offset() - base_offset) == 0) {
-                return PingRequest {};
-            }
-            return PingRequest {
-                buffer.read<std::string>(len - (buffer.read_offset() - base_offset)).value()
-            };
-        case MessageType::PingResponse:
-            return PingResponse {};
-        case MessageType::Disconnect:
-            if (len - (buffer.read_offset() - base_offset) == 0) {
-                return Disconnect {};
-            }
-            return Disconnect {
-                buffer.read<uint16_t>().value()
-            };
-        case MessageType::Forward:
-            return Forward {
-                buffer.read<uint8_t>().value(),
-                buffer.read<vector<uint8_t>>(len - (buffer.read_offset() - base_offset)).value(),
-                buffer.read<vector<uint8_t>>(buffer.readable_bytes()).value()
-            };
+        _pending.insert(_pending.end(), _chunk + _chunk_offset, _chunk + _chunk_offset + take);
+        _chunk_offset += take;
+    }
+
+    if (_chunk_offset == _chunk_size) {
+        return {Status::NeedMore, {}};
+    }
+
+    auto data = _chunk + _chunk_offset;
+    auto extent = frame_extent(data, _chunk_size - _chunk_offset);
+    switch (extent.status) {
+        case FrameStatus::Complete:
+            _chunk_offset += extent.size;
+            return {Status::Frame, ByteView(data, extent.size)};
+        case FrameStatus::NeedMore:
+            _pending.assign(data, _chunk + _chunk_size);
+            _chunk_offset = _chunk_size;
+            return {Status::NeedMore, {}};
+        default:
+            _error = true;
+            return {Status::Error, {}};
+    }
+}
+
+void StreamDecoder::reset() {
+    _pending.clear();
+    _pending_emitted = false;
+    _error = false;
+    _chunk = nullptr;
+    _chunk_size = 0;
+    _chunk_offset = 0;
+}
+
+optional<Message> parse(BufferReader& buffer) {
+    return decode<Message>(buffer, nullptr);
+}
+
+optional<MessageView> parse_view(BufferReader& buffer) {
+    return decode<MessageView>(buffer, nullptr);
+}
+
+ParseResult<Message> try_parse(BufferReader& buffer) {
+    return try_decode<Message>(buffer, nullptr);
+}
+
+ParseResult<MessageView> try_parse_view(BufferReader& buffer) {
+    return try_decode<MessageView>(buffer, nullptr);
+}
+
+std::string_view name(ParseError error) {
+    switch (error) {
+        case ParseError::Truncated:
+            return "truncated";
+        case ParseError::BadLength:
+            return "bad_length";
+        case ParseError::UnknownType:
+            return "unknown_type";
+        case ParseError::TooShort:
+            return "too_short";
+        case ParseError::BadField:
+            return "bad_field";
         default:
+            return "unknown";
+    }
+}
+
+optional<LazyFrame> parse_lazy(BufferReader& buffer) {
+    auto start = buffer.read_offset();
+    auto header = read_header(buffer);
+    if (!header) {
+        return nullopt;
+    }
+
+    auto data = buffer.data() + start;
+    auto size = header->len;
+    buffer.skip(header->body_len);
+    const auto& offsets = FIELD_OFFSETS[static_cast<size_t>(header->type)];
+    if (offsets.encapsulated) {
+        auto inner = encapsulated_extent(data + size, buffer.readable_bytes());
+        if (inner.status != FrameStatus::Complete) {
+            stats::on_malformed(ParseError::BadField);
             return nullopt;
+        }
+        size += inner.size;
+        buffer.skip(inner.size);
     }
+
+    stats::on_decoded(header->type, header->len, header->len - header->body_len > 2);
+    return LazyFrame(data, header->len, size, header->len - header->body_len, offsets);
 }
 
-void encode(const Message& message, BufferWriter& buffer) {
-    auto base_offset = buffer.size();
-    const auto visitor = overloads {
-        [&](const Advertise& n){
-            buffer.write(static_cast<uint8_t>(5));
-            buffer.write(MessageType::Advertise);
-            buffer.write(n.gateway_id);
-            buffer.write(n.duration);
-
-            assertm(buffer.size() - base_offset == 5, "Advertise must be 5 bytes long");
-        },
-        [&](const SearchGateway& n){
-            buffer.write(static_cast<uint8_t>(3));
-            buffer.write(MessageType::SearchGateway);
-            buffer.write(n.radius);
-
-            assertm(buffer.size() - base_offset == 3, "SearchGateway must be 3 bytes long");
-        },
-        [&](const GatewayInfo& n){
-            auto len = static_cast<uint8_t>(3) + (n.gateway_addr ? n.gateway_addr->size() : 0);
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::GatewayInfo);
-            buffer.write(n.gateway_id);
-            if (n.gateway_addr) {
-                buffer.write(n.gateway_addr.value());
-            }
+optional<MessageView> LazyFrame::view() const {
+    auto reader = BufferReader(_data, _size);
+    return parse_view(reader);
+}
 
-            assertm(len < 256, "GatewayInfo must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "GatewayInfo must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const Connect& n){
-            auto len = static_cast<uint8_t>(6) + n.client_id.size();
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::Connect);
-            buffer.write(n.flags);
-            buffer.write(n.protocol_version);
-            buffer.write(n.duration);
-            buffer.write(n.client_id);
-
-            assertm(len < 256, "Connect must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "Connect must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const ConnectAck& n){
-            buffer.write(static_cast<uint8_t>(3));
-            buffer.write(MessageType::ConnectAck);
-            buffer.write(n.code);
-
-            assertm(buffer.size() - base_offset == 3, "ConnectAck must be 3 bytes long");
-        },
-        [&](const WillTopicRequest& n){
-            buffer.write(static_cast<uint8_t>(2));
-            buffer.write(MessageType::WillTopicRequest);
-
-            assertm(buffer.size() - base_offset == 2, "WillTopicRequest must be 2 bytes long");
-        },
-        [&](const WillTopicEmpty&){
-            buffer.write(static_cast<uint8_t>(2));
-            buffer.write(MessageType::WillTopic);
-
-            assertm(buffer.size() - base_offset == 2, "WillTopicEmpty must be 2 bytes long");
-        },
-        [&](const WillTopic& n){
-            auto len = static_cast<uint8_t>(3) + n.topic.size();
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::WillTopic);
-            buffer.write(n.flags);
-            buffer.write(n.topic);
-
-            assertm(len < 256, "WillTopic must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "WillTopic must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const WillMessageRequest&){
-            buffer.write(static_cast<uint8_t>(2));
-            buffer.write(MessageType::WillMessageRequest);
-
-            assertm(buffer.size() - base_offset == 2, "WillMessageRequest must be 2 bytes long");
-        },
-        [&](const WillMessage& n){
-            auto len = static_cast<uint8_t>(2) + n.payload.size();
-            if (len < 256) {
-                buffer.write(static_cast<uint8_t>(len));
-            } else {
-                buffer.write(static_cast<uint8_t>(1));
-                len += + sizeof(uint16_t);
-                buffer.write(static_cast<uint16_t>(len));
-            }
-            buffer.write(MessageType::WillMessage);
-            buffer.write(n.payload);
-
-            assertm(len <= 65535, "WillMessage must be less than 65535 bytes long");
-            assertm(buffer.size() - base_offset == len, "WillMessage must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const WillTopicUpdate& n){
-            auto len = static_cast<uint8_t>(3) + n.topic.size();
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::WillTopicUpdate);
-            buffer.write(n.flags);
-            buffer.write(n.topic);
-
-            assertm(len < 256, "WillTopicUpdate must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "WillTopicUpdate must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const WillTopicUpdateEmpty&){
-            buffer.write(static_cast<uint8_t>(2));
-            buffer.write(MessageType::WillTopicUpdate);
-
-            assertm(buffer.size() - base_offset == 2, "WillTopicUpdateEmpty must be 2 bytes long");
-        },
-        [&](const WillTopicResponse& n){
-            buffer.write(static_cast<uint8_t>(3));
-            buffer.write(MessageType::WillTopicResponse);
-            buffer.write(n.code);
-
-            assertm(buffer.size() - base_offset == 3, "WillTopicResponse must be 3 bytes long");
-        },
-        [&](const WillMessageUpdate& n){
-            auto len = static_cast<uint8_t>(2) + n.payload.size();
-            if (len < 256) {
-                buffer.write(static_cast<uint8_t>(len));
-            } else {
-                buffer.write(static_cast<uint8_t>(1));
-                len += + sizeof(uint16_t);
-                buffer.write(static_cast<uint16_t>(len));
-            }
-            buffer.write(MessageType::WillMessageUpdate);
-            buffer.write(n.payload);
-
-            assertm(len <= 65535, "WillMessageUpdate must be less than or equal to 65535 bytes long");
-            assertm(buffer.size() - base_offset == len, "WillMessageUpdate must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const WillMessageResponse& n){
-            buffer.write(static_cast<uint8_t>(3));
-            buffer.write(MessageType::WillMessageResponse);
-            buffer.write(n.code);
-
-            assertm(buffer.size() - base_offset == 3, "WillMessageResponse must be 3 bytes long");
-        },
-        [&](const RegisterTopic& n){
-            auto len = static_cast<uint8_t>(6) + n.topic.size();
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::Register);
-            buffer.write(n.topic_id);
-            buffer.write(n.message_id);
-            buffer.write(n.topic);
-
-            assertm(len < 256, "RegisterTopic must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "RegisterTopic must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const RegisterTopicAck& n){
-            buffer.write(static_cast<uint8_t>(7));
-            buffer.write(MessageType::RegisterAck);
-            buffer.write(n.topic_id);
-            buffer.write(n.message_id);
-            buffer.write(n.code);
-
-            assertm(buffer.size() - base_offset == 7, "RegisterTopicAck must be 7 bytes long");
-        },
-        [&](const PublishMessage& n){
-            auto len = static_cast<uint8_t>(7) + n.payload.size();
-            if (len < 256) {
-                buffer.write(static_cast<uint8_t>(len));
-            } else {
-                buffer.write(static_cast<uint8_t>(1));
-                len += + sizeof(uint16_t);
-                buffer.write(static_cast<uint16_t>(len));
+optional<Message> LazyFrame::message() const {
+    auto reader = BufferReader(_data, _size);
+    return parse(reader);
+}
+
+optional<pmr::Message> parse(BufferReader& buffer, Arena& arena) {
+    return decode<pmr::Message>(buffer, arena.resource());
+}
+
+ParseResult<pmr::Message> try_parse(BufferReader& buffer, Arena& arena) {
+    return try_decode<pmr::Message>(buffer, arena.resource());
+}
+
+size_t parse_batch(const Datagram* datagrams, size_t count, ParsedBatch& batch) {
+    batch.resize(count);
+
+    size_t parsed = 0;
+    for (size_t i = 0; i < count; ++i) {
+        auto buffer = BufferReader(datagrams[i].data, datagrams[i].size);
+        auto header = read_header(buffer);
+        if (!header) {
+            batch.errors[i / 64] |= uint64_t(1) << (i % 64);
+            continue;
+        }
+
+        const auto body = buffer.data() + buffer.read_offset();
+        const auto body_len = header->body_len;
+        const auto tail = [&](size_t at) {
+            return ByteView(body + at, body_len - at);
+        };
+
+        uint16_t topic_id = 0;
+        uint16_t message_id = 0;
+        ByteView payload;
+        bool valid = true;
+        switch (header->type) {
+            case MessageType::Publish:
+                topic_id = load<uint16_t>(body + 1);
+                message_id = load<uint16_t>(body + 3);
+                payload = tail(5);
+                break;
+            case MessageType::PublishAck:
+            case MessageType::Register:
+            case MessageType::RegisterAck:
+                topic_id = load<uint16_t>(body);
+                message_id = load<uint16_t>(body + 2);
+                if (header->type == MessageType::Register) {
+                    payload = tail(4);
+                }
+                break;
+            case MessageType::SubscribeAck:
+                topic_id = load<uint16_t>(body + 1);
+                message_id = load<uint16_t>(body + 3);
+                break;
+            case MessageType::Subscribe:
+            case MessageType::Unsubscribe: {
+                message_id = load<uint16_t>(body + 1);
+                MessageFlags flags = load<MessageFlags>(body);
+                if (static_cast<TopicIdType>(flags.topic_id_type) == TopicIdType::Normal) {
+                    payload = tail(3);
+                } else if (body_len < 3 + sizeof(uint16_t)) {
+                    valid = false;
+                } else {
+                    topic_id = load<uint16_t>(body + 3);
+                }
+                break;
             }
-            buffer.write(MessageType::Publish);
-            buffer.write(n.flags);
-            buffer.write(n.topic_id);
-            buffer.write(n.message_id);
-            buffer.write(n.payload);
-
-            assertm(len <= 65535, "PublishMessage must be less than or equal to 65535 bytes long");
-            assertm(buffer.size() - base_offset == len, "PublishMessage must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const PublishMessageAck& n){
-            buffer.write(static_cast<uint8_t>(7));
-            buffer.write(MessageType::PublishAck);
-            buffer.write(n.topic_id);
-            buffer.write(n.message_id);
-            buffer.write(n.code);
-
-            assertm(buffer.size() - base_offset == 7, "PublishMessageAck must be 7 bytes long");
-        },
-        [&](const PublishMessageComplete& n){
-            buffer.write(static_cast<uint8_t>(4));
-            buffer.write(MessageType::PublishComplete);
-            buffer.write(n.message_id);
-
-            assertm(buffer.size() - base_offset == 4, "PublishMessageComplete must be 4 bytes long");
-        },
-        [&](const PublishMessageReceived& n){
-            buffer.write(static_cast<uint8_t>(4));
-            buffer.write(MessageType::PublishReceived);
-            buffer.write(n.message_id);
-
-            assertm(buffer.size() - base_offset == 4, "PublishMessageReceived must be 4 bytes long");
-        },
-        [&](const PublishMessageRelease& n){
-            buffer.write(static_cast<uint8_t>(4));
-            buffer.write(MessageType::PublishRelease);
-            buffer.write(n.message_id);
-
-            assertm(buffer.size() - base_offset == 4, "PublishMessageRelease must be 4 bytes long");
-        },
-        [&](const Subscribe& n){
-            auto is_topic_id = std::holds_alternative<uint16_t>(n.topic);
-            auto len = static_cast<uint8_t>(5)
-                    + (is_topic_id ? sizeof(uint16_t) : std::get<std::string>(n.topic).size());
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::Subscribe);
-            buffer.write(n.flags);
-            buffer.write(n.message_id);
-            if (is_topic_id) {
-                buffer.write(std::get<uint16_t>(n.topic));
-            } else {
-                buffer.write(std::get<std::string>(n.topic));
+            case MessageType::PublishComplete:
+            case MessageType::PublishReceived:
+            case MessageType::PublishRelease:
+            case MessageType::UnsubscribeAck:
+                message_id = load<uint16_t>(body);
+                break;
+            case MessageType::Connect:
+                payload = tail(4);
+                break;
+            case MessageType::GatewayInfo:
+                payload = tail(1);
+                break;
+            case MessageType::Forward: {
+                auto inner = encapsulated_extent(body + body_len, buffer.readable_bytes() - body_len);
+                if (inner.status == FrameStatus::Complete) {
+                    payload = ByteView(body + body_len, inner.size);
+                } else {
+                    valid = false;
+                }
+                break;
             }
+            case MessageType::WillTopic:
+            case MessageType::WillTopicUpdate:
+                payload = body_len == 0 ? ByteView() : tail(1);
+                break;
+            case MessageType::WillMessage:
+            case MessageType::WillMessageUpdate:
+            case MessageType::PingRequest:
+                payload = tail(0);
+                break;
+            case MessageType::Disconnect:
+                valid = body_len == 0 || body_len >= sizeof(uint16_t);
+                break;
+            default:
+                break;
+        }
 
-            assertm(len < 256, "Subscribe must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "Subscribe must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const SubscribeAck& n){
-            buffer.write(static_cast<uint8_t>(8));
-            buffer.write(MessageType::SubscribeAck);
-            buffer.write(n.flags);
-            buffer.write(n.topic_id);
-            buffer.write(n.message_id);
-            buffer.write(n.code);
-
-            assertm(buffer.size() - base_offset == 8, "SubscribeAck must be 8 bytes long");
-        },
-        [&](const Unsubscribe& n){
-            auto is_topic_id = std::holds_alternative<uint16_t>(n.topic);
-            auto len = static_cast<uint8_t>(5)
-                    + (is_topic_id ? sizeof(uint16_t) : std::get<std::string>(n.topic).size());
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::Unsubscribe);
-            buffer.write(n.flags);
-            buffer.write(n.message_id);
-            if (is_topic_id) {
-                buffer.write(std::get<uint16_t>(n.topic));
-            } else {
-                buffer.write(std::get<std::string>(n.topic));
-            }
+        if (!valid) {
+            stats::on_malformed(ParseError::BadField);
+            batch.errors[i / 64] |= uint64_t(1) << (i % 64);
+            continue;
+        }
+        stats::on_decoded(header->type, header->len, header->len - body_len > 2);
 
-            assertm(len < 256, "Unsubscribe must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "Unsubscribe must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const UnsubscribeAck& n){
-            buffer.write(static_cast<uint8_t>(4));
-            buffer.write(MessageType::UnsubscribeAck);
-            buffer.write(n.message_id);
-
-            assertm(buffer.size() - base_offset == 4, "UnsubscribeAck must be 4 bytes long");
-        },
-        [&](const PingRequest& n){
-            auto len = static_cast<uint8_t>(2)
-                    + (n.client_id ? n.client_id->size() : 0);
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::PingRequest);
-            if (n.client_id) {
-                buffer.write(n.client_id.value());
-            }
+        batch.types[i] = header->type;
+        batch.offsets[i] = static_cast<uint32_t>(buffer.read_offset());
+        batch.topic_ids[i] = topic_id;
+        batch.message_ids[i] = message_id;
+        batch.payloads[i] = payload;
+        ++parsed;
+    }
 
-            assertm(len < 256, "PingRequest must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "PingRequest must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const PingResponse& n){
-            buffer.write(static_cast<uint8_t>(2));
-            buffer.write(MessageType::PingResponse);
-
-            assertm(buffer.size() - base_offset == 2, "PingResponse must be 2 bytes long");
-        },
-        [&](const Disconnect& n){
-            auto len = static_cast<uint8_t>(2) + (n.duration ? sizeof(uint16_t) : 0);
-            buffer.write(static_cast<uint8_t>(len));
-            buffer.write(MessageType::Disconnect);
-            if (n.duration) {
-                buffer.write(n.duration.value());
-            }
+    return parsed;
+}
 
-            assertm(len < 256, "Disconnect must be less than 256 bytes long");
-            assertm(buffer.size() - base_offset == len, "Disconnect must be " + std::to_string(len) + " bytes long");
-        },
-        [&](const Forward& n){
-            auto len = static_cast<uint8_t>(3)
-                    + n.gateway_addr.size();
-            
-            if (len < 256) {
-                buffer.write(static_cast<uint8_t>(len));
-            } else {
-                buffer.write(static_cast<uint8_t>(1));
-                len += + sizeof(uint16_t);
-                buffer.write(static_cast<uint16_t>(len));
-            }
-            
-            buffer.write(MessageType::Forward);
-            buffer.write(n.ctrl);
-            buffer.write(n.gateway_addr);
-            buffer.write(n.payload);
-
-            assertm(len < 65535, "Forward must be less than 65535 bytes long");
-            assertm(buffer.size() - n.payload.size() - base_offset == len, "Forward must be " + std::to_string(len) + " bytes long");
+namespace {
+
+/***
+ * Writes the length field, switching to the 3-byte form when needed, and returns the full frame length.
+ */
+template<typename Writer>
+size_t write_length(Writer& buffer, size_t len) {
+    assertm(frame_length(len) <= MAX_FRAME_LENGTH, "Message must be less than or equal to 65535 bytes long");
+    if (len < 256) {
+        buffer.write(static_cast<uint8_t>(len));
+        return len;
+    }
+
+    len = frame_length(len);
+    buffer.write(static_cast<uint8_t>(1));
+    buffer.write(static_cast<uint16_t>(len));
+    return len;
+}
+
+template<typename V>
+size_t value_size(const V& value) {
+    if constexpr (is_optional<V>::value) {
+        return value ? value_size(*value) : 0;
+    } else if constexpr (is_variable<V>::value) {
+        return value.size();
+    } else {
+        return sizeof(V);
+    }
+}
+
+template<typename Writer, typename V>
+void write_value(Writer& buffer, const V& value) {
+    if constexpr (is_optional<V>::value) {
+        if (value) {
+            buffer.write(*value);
         }
-    };
+    } else {
+        buffer.write(value);
+    }
+}
+
+/***
+ * Field encoders. Encapsulated frames follow the message and are not counted in its length.
+ */
+template<typename T, auto Member>
+size_t field_size(layout::Field<Member>, const T&) {
+    return sizeof(member_t<Member>);
+}
+
+template<typename T, auto Member>
+size_t field_size(layout::Tail<Member>, const T& message) {
+    return value_size(message.*Member);
+}
+
+template<typename T, auto Flags, auto Member>
+size_t field_size(layout::Topic<Flags, Member>, const T& message) {
+    return std::visit([](const auto& topic) { return value_size(topic); }, message.*Member);
+}
+
+template<typename T, auto Member>
+size_t field_size(layout::Encapsulated<Member>, const T&) {
+    return 0;
+}
+
+template<typename T, auto Member>
+size_t encapsulated_size(layout::Encapsulated<Member>, const T& message) {
+    return value_size(message.*Member);
+}
+
+template<typename Field, typename T>
+size_t encapsulated_size(Field, const T&) {
+    return 0;
+}
+
+template<typename Writer, typename T, auto Member>
+void encode_field(layout::Field<Member>, const T& message, Writer& buffer) {
+    buffer.write(message.*Member);
+}
+
+template<typename Writer, typename T, auto Member>
+void encode_field(layout::Tail<Member>, const T& message, Writer& buffer) {
+    write_value(buffer, message.*Member);
+}
+
+template<typename Writer, typename T, auto Flags, auto Member>
+void encode_field(layout::Topic<Flags, Member>, const T& message, Writer& buffer) {
+    std::visit([&](const auto& topic) { buffer.write(topic); }, message.*Member);
+}
+
+template<typename Writer, typename T, auto Member>
+void encode_field(layout::Encapsulated<Member>, const T& message, Writer& buffer) {
+    buffer.write(message.*Member);
+}
+
+/***
+ * Value of the length field in its 1-byte form, i.e. length and type fields plus the body.
+ */
+template<typename T, MessageType Type, typename... Fields>
+size_t short_length(layout::Frame<Type, Fields...>, const T& message) {
+    return sizeof(uint8_t) + sizeof(MessageType) + (field_size(Fields {}, message) + ... + 0);
+}
+
+template<typename T, MessageType Type, typename... Fields>
+size_t message_size(layout::Frame<Type, Fields...> layout, const T& message) {
+    return frame_length(short_length(layout, message)) + (encapsulated_size(Fields {}, message) + ... + 0);
+}
+
+template<typename Writer, typename T, MessageType Type, typename... Fields>
+void encode_message(layout::Frame<Type, Fields...> layout, const T& message, Writer& buffer) {
+    [[maybe_unused]] stats::EncodeCycles cycles;
+    auto len = write_length(buffer, short_length(layout, message));
+    buffer.write(Type);
+    (encode_field(Fields {}, message, buffer), ...);
+    if constexpr (stats::enabled) {
+        stats::on_encoded(Type, len + (encapsulated_size(Fields {}, message) + ... + 0), len > UINT8_MAX);
+    }
+}
+
+/***
+ * Whether the length field of @p message fits in MAX_FRAME_LENGTH; write_length() must not be
+ * called otherwise.
+ */
+template<typename T, MessageType Type, typename... Fields>
+bool length_fits(layout::Frame<Type, Fields...> layout, const T& message) {
+    return frame_length(short_length(layout, message)) <= MAX_FRAME_LENGTH;
+}
+
+template<typename Field>
+struct is_payload : std::false_type {};
+
+template<auto Member>
+struct is_payload<layout::Tail<Member>> : is_variable<unwrap_optional_t<member_t<Member>>> {};
+
+template<auto Member>
+struct is_payload<layout::Encapsulated<Member>> : std::true_type {};
+
+/***
+ * The last field of a layout when it is a string or byte field, which encode_header() leaves
+ * out; void otherwise.
+ */
+template<typename Layout>
+struct payload_field {
+    using type = void;
+};
+
+template<MessageType Type, typename First, typename... Fields>
+struct payload_field<layout::Frame<Type, First, Fields...>> {
+    using last = std::tuple_element_t<sizeof...(Fields), std::tuple<First, Fields...>>;
+    using type = std::conditional_t<is_payload<last>::value, last, void>;
+};
+
+template<typename Layout>
+using payload_field_t = typename payload_field<Layout>::type;
+
+template<typename T, typename Payload>
+size_t payload_size(const T& message) {
+    if constexpr (std::is_void<Payload>::value) {
+        return 0;
+    } else {
+        return field_size(Payload {}, message) + encapsulated_size(Payload {}, message);
+    }
+}
+
+template<typename T, MessageType Type, typename... Fields>
+size_t header_size_of(layout::Frame<Type, Fields...> layout, const T& message) {
+    return message_size(layout, message) - payload_size<T, payload_field_t<decltype(layout)>>(message);
+}
+
+template<typename T, MessageType Type, typename... Fields>
+size_t encode_header_of(layout::Frame<Type, Fields...> layout, const T& message, uint8_t* hdr) {
+    using Payload = payload_field_t<decltype(layout)>;
+
+    if (!length_fits(layout, message)) {
+        return 0;
+    }
+
+    [[maybe_unused]] stats::EncodeCycles cycles;
+    SpanWriter buffer(hdr, header_size_of(layout, message));
+    [[maybe_unused]] auto len = write_length(buffer, short_length(layout, message));
+    buffer.write(Type);
+    ((std::is_same<Fields, Payload>::value ? void() : encode_field(Fields {}, message, buffer)), ...);
+    if constexpr (stats::enabled) {
+        stats::on_encoded(Type, len + (encapsulated_size(Fields {}, message) + ... + 0), len > UINT8_MAX);
+    }
+    return buffer.size();
+}
+
+template<typename V>
+ByteView bytes_of(const V& value) {
+    if constexpr (is_optional<V>::value) {
+        return value ? bytes_of(*value) : ByteView();
+    } else {
+        return ByteView(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+    }
+}
+
+template<typename T, auto Member>
+ByteView payload_of(layout::Tail<Member>, const T& message) {
+    return bytes_of(message.*Member);
+}
+
+template<typename T, auto Member>
+ByteView payload_of(layout::Encapsulated<Member>, const T& message) {
+    return bytes_of(message.*Member);
+}
+
+template<typename Variant>
+size_t header_size_to(const Variant& message) {
+    return std::visit([](const auto& n) {
+        return header_size_of(typename std::decay_t<decltype(n)>::Layout {}, n);
+    }, message);
+}
+
+template<typename Variant>
+size_t encode_header_to(const Variant& message, uint8_t* hdr) {
+    return std::visit([&](const auto& n) {
+        return encode_header_of(typename std::decay_t<decltype(n)>::Layout {}, n, hdr);
+    }, message);
+}
+
+template<typename Variant>
+ByteView encoded_payload_of(const Variant& message) {
+    return std::visit([](const auto& n) {
+        using Payload = payload_field_t<typename std::decay_t<decltype(n)>::Layout>;
+        if constexpr (std::is_void<Payload>::value) {
+            return ByteView();
+        } else {
+            return payload_of(Payload {}, n);
+        }
+    }, message);
+}
+
+template<template<typename> class Allocator, typename Writer>
+void encode_to(const BasicMessage<Allocator>& message, Writer& buffer) {
+    std::visit([&](const auto& n) {
+        encode_message(typename std::decay_t<decltype(n)>::Layout {}, n, buffer);
+    }, message);
+}
+
+}
+
+template<template<typename> class Allocator>
+void encode(const BasicMessage<Allocator>& message, BufferWriter& buffer) {
+    auto size = encoded_size(message);
+    if (!size) {
+        return;
+    }
+
+    buffer.reserve(buffer.size() + *size);
+    encode_to(message, buffer);
+}
+
+template<template<typename> class Allocator>
+optional<size_t> encoded_size(const BasicMessage<Allocator>& message) {
+    return std::visit([](const auto& n) -> optional<size_t> {
+        using Layout = typename std::decay_t<decltype(n)>::Layout;
+        if (!length_fits(Layout {}, n)) {
+            return nullopt;
+        }
+        return message_size(Layout {}, n);
+    }, message);
+}
+
+template<template<typename> class Allocator>
+optional<size_t> encode_into(const BasicMessage<Allocator>& message, uint8_t* dst, size_t capacity) {
+    auto size = encoded_size(message);
+    if (!size || *size > capacity) {
+        return nullopt;
+    }
+
+    SpanWriter writer(dst, capacity);
+    encode_to(message, writer);
+    return writer.size();
+}
+
+template<template<typename> class Allocator>
+size_t header_size(const BasicMessage<Allocator>& message) {
+    return header_size_to(message);
+}
+
+template<template<typename> class Allocator>
+size_t encode_header(const BasicMessage<Allocator>& message, uint8_t* hdr) {
+    return encode_header_to(message, hdr);
+}
+
+template<template<typename> class Allocator>
+ByteView encoded_payload(const BasicMessage<Allocator>& message) {
+    return encoded_payload_of(message);
+}
+
+template void encode(const pmr::Message& message, BufferWriter& buffer);
+template optional<size_t> encoded_size(const pmr::Message& message);
+template optional<size_t> encode_into(const pmr::Message& message, uint8_t* dst, size_t capacity);
+template size_t header_size(const pmr::Message& message);
+template size_t encode_header(const pmr::Message& message, uint8_t* hdr);
+template ByteView encoded_payload(const pmr::Message& message);
+
+void encode(const Message& message, BufferWriter& buffer) {
+    encode<std::allocator>(message, buffer);
+}
+
+optional<size_t> encoded_size(const Message& message) {
+    return encoded_size<std::allocator>(message);
+}
+
+optional<size_t> encode_into(const Message& message, uint8_t* dst, size_t capacity) {
+    return encode_into<std::allocator>(message, dst, capacity);
+}
+
+size_t header_size(const Message& message) {
+    return header_size<std::allocator>(message);
+}
+
+size_t header_size(const MessageView& message) {
+    return header_size_to(message);
+}
+
+size_t encode_header(const Message& message, uint8_t* hdr) {
+    return encode_header<std::allocator>(message, hdr);
+}
+
+size_t encode_header(const MessageView& message, uint8_t* hdr) {
+    return encode_header_to(message, hdr);
+}
+
+ByteView encoded_payload(const Message& message) {
+    return encoded_payload<std::allocator>(message);
+}
 
-    std::visit(visitor, message);
+ByteView encoded_payload(const MessageView& message) {
+    return encoded_payload_of(message);
 }
 
 }
\ No newline at end of file
@@ -0,0 +1,90 @@
+#include <mqtt-sn/gateway.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace mqtt_sn::gateway {
+
+Gateway::Gateway(const Config& config) : _config(config) {
+    auto count = config.shards;
+    if (count == 0) {
+        count = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        _shards.push_back(std::make_unique<Shard>(i, config, now()));
+    }
+    for (auto& from : _shards) {
+        for (auto& to : _shards) {
+            if (from != to) {
+                from->link(*to, config.ring_capacity);
+            }
+        }
+    }
+}
+
+Gateway::~Gateway() {
+    stop();
+}
+
+bool Gateway::open() {
+    // With port 0 the first shard picks the port and the others join it.
+    auto address = _config.address;
+    for (auto& shard : _shards) {
+        if (!shard->open(address)) {
+            return false;
+        }
+        address = shard->engine().local_endpoint();
+    }
+    return true;
+}
+
+void Gateway::start() {
+    if (_running.exchange(true)) {
+        return;
+    }
+
+    for (auto& shard : _shards) {
+        _threads.emplace_back([this, shard = shard.get()] {
+            // Stay on a non-blocking poll while there is traffic; only an idle shard blocks.
+            uint32_t idle = 0;
+            while (_running.load(std::memory_order_relaxed)) {
+                auto handled = shard->poll(now(), idle >= _config.idle_polls);
+                if (handled < 0) {
+                    if (errno != EINTR) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(_config.poll_interval_ms));
+                    }
+                    continue;
+                }
+                idle = handled > 0 ? 0 : idle + 1;
+            }
+        });
+
+        if (_config.pin_threads) {
+            auto cpus = std::max(1u, std::thread::hardware_concurrency());
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(shard->index() % cpus, &set);
+            pthread_setaffinity_np(_threads.back().native_handle(), sizeof(set), &set);
+        }
+    }
+}
+
+void Gateway::stop() {
+    _running = false;
+    for (auto& thread : _threads) {
+        thread.join();
+    }
+    _threads.clear();
+}
+
+uint32_t Gateway::now() {
+    auto elapsed = std::chrono::steady_clock::now().time_since_epoch();
+    return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count());
+}
+
+}
@@ -0,0 +1,547 @@
+#include <mqtt-sn/gateway.h>
+
+#include <algorithm>
+#include <array>
+
+#include <netinet/in.h>
+
+namespace mqtt_sn::gateway {
+
+namespace {
+
+/***
+ * Appends the parts of @p endpoint that identify a peer, leaving out padding the kernel may not
+ * have cleared.
+ */
+void append_address(std::string& key, const Endpoint& endpoint) {
+    const auto append = [&](const void* data, size_t size) {
+        key.append(static_cast<const char*>(data), size);
+    };
+
+    switch (endpoint.address.ss_family) {
+    case AF_INET: {
+        auto& address = reinterpret_cast<const sockaddr_in&>(endpoint.address);
+        append(&address.sin_port, sizeof(address.sin_port));
+        append(&address.sin_addr, sizeof(address.sin_addr));
+        break;
+    }
+    case AF_INET6: {
+        auto& address = reinterpret_cast<const sockaddr_in6&>(endpoint.address);
+        append(&address.sin6_port, sizeof(address.sin6_port));
+        append(&address.sin6_addr, sizeof(address.sin6_addr));
+        append(&address.sin6_scope_id, sizeof(address.sin6_scope_id));
+        break;
+    }
+    default:
+        append(&endpoint.address, endpoint.length);
+        break;
+    }
+}
+
+bool has_wildcard(std::string_view filter) {
+    return filter.find_first_of("+#") != std::string_view::npos;
+}
+
+/***
+ * A publication in a ring between shards: its flags, the length of its topic name in two bytes,
+ * the topic name and the payload, which takes the rest of the record.
+ */
+constexpr size_t PUBLICATION_HEADER = 3;
+
+}
+
+Shard::Shard(size_t index, const Config& config, uint32_t now)
+    : _index(index),
+      _config(config),
+      _engine([&] {
+          auto engine = config.engine;
+          engine.reuse_port = true;
+          engine.receive_timeout_ms = config.poll_interval_ms;
+          return engine;
+      }()),
+      _now(now),
+      _keep_alive(config.keep_alive, now) {}
+
+Shard::~Shard() = default;
+
+bool Shard::open(const Endpoint& address) {
+    return _engine.open(address);
+}
+
+void Shard::link(Shard& peer, size_t capacity) {
+    // A topic name and a payload, each taken from a datagram of at most buffer_size.
+    auto largest = PUBLICATION_HEADER + 2 * _config.engine.buffer_size;
+    auto ring = std::make_unique<SpscByteRing>(std::max(capacity, SpscByteRing::capacity_for(largest)));
+    peer._inbound.push_back(ring.get());
+    _outbound.push_back(std::move(ring));
+}
+
+int Shard::poll(uint32_t now, bool wait) {
+    _now = now;
+
+    // Publications already waiting must not sit behind a blocking receive.
+    for (auto ring : _inbound) {
+        if (ring->size() != 0) {
+            wait = false;
+            break;
+        }
+    }
+
+    auto count = _engine.receive(wait);
+    if (count < 0) {
+        ++_stats.receive_errors;
+        return -1;
+    }
+    for (int i = 0; i < count; ++i) {
+        auto& datagram = _engine.datagrams()[i];
+        handle(ByteView(datagram.data, datagram.size), _engine.source(i), ByteView());
+    }
+
+    for (auto ring : _inbound) {
+        size_t size;
+        while (auto record = ring->front(size)) {
+            MessageFlags flags;
+            flags.value = record[0];
+            size_t topic_size = record[1] << 8 | record[2];
+            auto topic = std::string_view(reinterpret_cast<const char*>(record) + PUBLICATION_HEADER, topic_size);
+            auto payload = record + PUBLICATION_HEADER + topic_size;
+            deliver(topic, flags, ByteView(payload, size - PUBLICATION_HEADER - topic_size));
+            ring->pop();
+            ++count;
+        }
+    }
+
+    _keep_alive.advance(now, [&](ClientId client, KeepAlive::Expiry) {
+        remove(client);
+    });
+
+    _engine.flush();
+    return count;
+}
+
+/***
+ * @p node is the wireless node id of a frame unwrapped from a Forward, empty otherwise.
+ */
+void Shard::handle(ByteView frame, const Endpoint& from, ByteView node) {
+    auto reader = format::BufferReader(frame.data(), frame.size());
+    auto message = format::parse_view(reader);
+    if (!message || reader.readable_bytes() != 0) {
+        ++_stats.malformed;
+        return;
+    }
+
+    if (auto forward = std::get_if<ForwardView>(&message.value())) {
+        if (!node.empty()) {
+            ++_stats.malformed;     // forwarders do not nest
+            return;
+        }
+        handle(forward->payload, from, forward->gateway_addr);
+        return;
+    }
+    if (auto connect = std::get_if<ConnectView>(&message.value())) {
+        handle(*connect, from, node);
+        return;
+    }
+
+    ClientId client;
+    auto session = find(from, node, client);
+    if (session == nullptr || !session->active) {
+        return;
+    }
+    _keep_alive.on_message(client, _now);
+
+    std::visit([&](const auto& message) {
+        using T = std::decay_t<decltype(message)>;
+        if constexpr (std::is_same_v<T, RegisterTopicView>) {
+            handle(message, *session);
+        } else if constexpr (std::is_same_v<T, PublishMessageView> || std::is_same_v<T, SubscribeView>
+                             || std::is_same_v<T, UnsubscribeView> || std::is_same_v<T, Disconnect>) {
+            handle(message, client);
+        } else if constexpr (std::is_same_v<T, PublishMessageRelease>) {
+            send(*session, PublishMessageComplete {message.message_id});
+        } else if constexpr (std::is_same_v<T, PingRequestView>) {
+            // A PINGREQ naming a client is that client checking in from its sleep. One naming
+            // another client is dropped, rather than sending that client's deliveries anywhere.
+            if (message.client_id) {
+                if (message.client_id.value() != session->client_id) {
+                    return;
+                }
+                if (_keep_alive.on_ping(client, message, _now) == client) {
+                    wake(*session);
+                }
+            }
+            send(*session, PingResponse {});
+        }
+    }, message.value());
+}
+
+void Shard::handle(const ConnectView& message, const Endpoint& from, ByteView node) {
+    ClientId client;
+    auto session = find(from, node, client);
+    if (message.flags.will) {
+        // Refused before a session is set up for it; one the client already has is kept.
+        send(from, node, ConnectAck {MessageErrorCode::NotSupported});
+        return;
+    }
+
+    if (session == nullptr) {
+        if (!_free_sessions.empty()) {
+            client = _free_sessions.back();
+            _free_sessions.pop_back();
+        } else {
+            client = static_cast<ClientId>(_sessions.size());
+            _sessions.emplace_back();
+        }
+        session = &_sessions[client];
+        session->endpoint = from;
+        session->key = _key;
+        session->node.assign(node.begin(), node.end());
+        session->sleep_buffer = SleepBuffer(_config.sleep_buffer);
+        _by_address.emplace(session->key, client);
+    }
+
+    if (message.flags.clean_session) {
+        for (const auto& filter : session->filters) {
+            _subscriptions.unsubscribe(client, filter);
+        }
+        session->filters.clear();
+        release_topics(*session);
+        session->sleep_buffer.reset();
+    }
+    session->client_id = message.client_id;
+    session->active = true;
+    auto keep_alive = message;
+    if (keep_alive.duration == 0) {
+        keep_alive.duration = _config.idle_duration;
+    }
+    _keep_alive.on_connect(client, keep_alive, _now);
+    send(*session, ConnectAck {MessageErrorCode::Accepted});
+    wake(*session);
+}
+
+void Shard::handle(const RegisterTopicView& message, Session& session) {
+    auto topic_id = acquire_topic(session, message.topic);
+    if (!topic_id) {
+        send(session, RegisterTopicAck {0, message.message_id, MessageErrorCode::Congestion});
+        return;
+    }
+    send(session, RegisterTopicAck {topic_id.value(), message.message_id, MessageErrorCode::Accepted});
+}
+
+void Shard::handle(const PublishMessageView& message, ClientId client) {
+    std::array<char, 2> short_name;
+    optional<std::string_view> topic;
+    switch (static_cast<TopicIdType>(message.flags.topic_id_type)) {
+    case TopicIdType::Normal:
+        topic = _topics.name(message.topic_id);
+        break;
+    case TopicIdType::Short:
+        short_name = {static_cast<char>(message.topic_id >> 8), static_cast<char>(message.topic_id & 0xFF)};
+        topic = std::string_view(short_name.data(), short_name.size());
+        break;
+    default:
+        break;      // no predefined topics
+    }
+
+    auto& session = _sessions[client];
+    if (!topic) {
+        send(session, PublishMessageAck {message.topic_id, message.message_id, MessageErrorCode::InvalidTopicId});
+        return;
+    }
+
+    ++_stats.published;
+    deliver(topic.value(), message.flags, message.payload);
+    auto size = PUBLICATION_HEADER + topic->size() + message.payload.size();
+    for (auto& ring : _outbound) {
+        auto record = ring->try_reserve(size);
+        if (record == nullptr) {
+            ++_stats.dropped;
+            continue;
+        }
+        record[0] = message.flags.value;
+        record[1] = static_cast<uint8_t>(topic->size() >> 8);
+        record[2] = static_cast<uint8_t>(topic->size() & 0xFF);
+        std::copy(topic->begin(), topic->end(), record + PUBLICATION_HEADER);
+        std::copy(message.payload.begin(), message.payload.end(), record + PUBLICATION_HEADER + topic->size());
+        ring->commit();
+        ++_stats.forwarded;
+    }
+
+    if (message.flags.qos == 1) {
+        send(session, PublishMessageAck {message.topic_id, message.message_id, MessageErrorCode::Accepted});
+    } else if (message.flags.qos == 2) {
+        send(session, PublishMessageReceived {message.message_id});
+    }
+}
+
+void Shard::handle(const SubscribeView& message, ClientId client) {
+    SubscribeAck ack {};
+    ack.message_id = message.message_id;
+
+    std::array<char, 2> short_name;
+    optional<std::string_view> filter;
+    if (auto name = std::get_if<std::string_view>(&message.topic)) {
+        filter = *name;
+    } else if (static_cast<TopicIdType>(message.flags.topic_id_type) == TopicIdType::Short) {
+        auto topic_id = std::get<uint16_t>(message.topic);
+        short_name = {static_cast<char>(topic_id >> 8), static_cast<char>(topic_id & 0xFF)};
+        filter = std::string_view(short_name.data(), short_name.size());
+    } else if (static_cast<TopicIdType>(message.flags.topic_id_type) == TopicIdType::Normal) {
+        filter = _topics.name(std::get<uint16_t>(message.topic));
+    }
+
+    auto& session = _sessions[client];
+    if (!filter) {
+        ack.code = MessageErrorCode::InvalidTopicId;
+    } else if (!_subscriptions.subscribe(client, filter.value())) {
+        ack.code = MessageErrorCode::NotSupported;
+    } else {
+        if (std::find(session.filters.begin(), session.filters.end(), filter.value()) == session.filters.end()) {
+            session.filters.emplace_back(filter.value());
+        }
+
+        // A topic name without wildcards is registered right away; others as PUBLISHes match them.
+        if (std::holds_alternative<std::string_view>(message.topic) && filter->size() != 2 && !has_wildcard(filter.value())) {
+            if (auto topic_id = acquire_topic(session, filter.value())) {
+                ack.topic_id = topic_id.value();
+            }
+        }
+    }
+    send(session, ack);
+}
+
+void Shard::handle(const UnsubscribeView& message, ClientId client) {
+    std::array<char, 2> short_name;
+    optional<std::string_view> filter;
+    if (auto name = std::get_if<std::string_view>(&message.topic)) {
+        filter = *name;
+    } else if (static_cast<TopicIdType>(message.flags.topic_id_type) == TopicIdType::Short) {
+        auto topic_id = std::get<uint16_t>(message.topic);
+        short_name = {static_cast<char>(topic_id >> 8), static_cast<char>(topic_id & 0xFF)};
+        filter = std::string_view(short_name.data(), short_name.size());
+    } else if (static_cast<TopicIdType>(message.flags.topic_id_type) == TopicIdType::Normal) {
+        filter = _topics.name(std::get<uint16_t>(message.topic));
+    }
+
+    auto& session = _sessions[client];
+    if (filter && _subscriptions.unsubscribe(client, filter.value())) {
+        auto it = std::find(session.filters.begin(), session.filters.end(), filter.value());
+        if (it != session.filters.end()) {
+            session.filters.erase(it);
+        }
+    }
+    send(session, UnsubscribeAck {message.message_id});
+}
+
+void Shard::handle(const Disconnect& message, ClientId client) {
+    send(_sessions[client], Disconnect {});
+    if (message.duration && message.duration.value() > 0) {
+        _keep_alive.on_disconnect(client, message, _now);
+        return;
+    }
+    remove(client);
+}
+
+/***
+ * Looks up the session of @p from and @p node, leaving their key in _key.
+ */
+Shard::Session* Shard::find(const Endpoint& from, ByteView node, ClientId& client) {
+    _key.clear();
+    append_address(_key, from);
+    _key.append(reinterpret_cast<const char*>(node.data()), node.size());
+
+    auto it = _by_address.find(_key);
+    if (it == _by_address.end()) {
+        return nullptr;
+    }
+    client = it->second;
+    return &_sessions[client];
+}
+
+void Shard::remove(ClientId client) {
+    auto& session = _sessions[client];
+    for (const auto& filter : session.filters) {
+        _subscriptions.unsubscribe(client, filter);
+    }
+    _keep_alive.remove(client);
+    _by_address.erase(session.key);
+    release_topics(session);
+    session = Session {};
+    _free_sessions.push_back(client);
+}
+
+/***
+ * Registers @p name on behalf of @p session, which may hold at most max_session_topics ids.
+ */
+optional<uint16_t> Shard::acquire_topic(Session& session, std::string_view name) {
+    if (auto topic_id = _topics.find(name); topic_id && session.topics.count(topic_id.value())) {
+        return topic_id;
+    }
+    if (session.topics.size() >= _config.max_session_topics) {
+        return nullopt;
+    }
+
+    auto topic_id = _topics.register_topic(name);
+    if (topic_id) {
+        hold_topic(session, topic_id.value());
+    }
+    return topic_id;
+}
+
+/***
+ * Adds @p session to the holders of @p topic_id, unless it is one already.
+ */
+bool Shard::hold_topic(Session& session, uint16_t topic_id) {
+    if (!session.topics.insert(topic_id).second) {
+        return false;
+    }
+    if (_topic_holders.size() <= topic_id) {
+        _topic_holders.resize(topic_id + 1u);
+    }
+    ++_topic_holders[topic_id];
+    return true;
+}
+
+/***
+ * Drops the topic ids of @p session, releasing those no other session holds. Names released
+ * this way are freed once they make up most of the registry; no view into it is live here.
+ */
+void Shard::release_topics(Session& session) {
+    for (auto topic_id : session.topics) {
+        if (--_topic_holders[topic_id] == 0) {
+            _topics.unregister(topic_id);
+        }
+    }
+    session.topics.clear();
+
+    if (_topics.interned() > 2 * _topics.size() + 1024) {
+        _topics.compact();
+    }
+}
+
+/***
+ * Sends a PUBLISH of @p topic to every local subscriber. The frame is the same for all of them,
+ * as topic ids are per shard, so it is encoded once; clients that do not know the topic id yet
+ * get a REGISTER first.
+ */
+void Shard::deliver(std::string_view topic, MessageFlags flags, ByteView payload) {
+    _matched.clear();
+    _subscriptions.match(topic, _matched);
+    if (_matched.empty()) {
+        return;
+    }
+
+    PublishMessageView publish {};
+    publish.flags.retain = flags.retain;
+    publish.payload = payload;
+    if (topic.size() == 2) {
+        publish.flags.topic_id_type = static_cast<uint8_t>(TopicIdType::Short);
+        publish.topic_id = static_cast<uint16_t>(uint8_t(topic[0]) << 8 | uint8_t(topic[1]));
+    } else if (auto topic_id = _topics.register_topic(topic)) {
+        publish.topic_id = topic_id.value();
+    } else {
+        return;
+    }
+
+    MessageView view = publish;
+    _frame.resize(format::header_size(view) + payload.size());
+    auto header_size = format::encode_header(view, _frame.data());
+    std::copy(payload.begin(), payload.end(), _frame.begin() + header_size);
+    auto frame = ByteView(_frame.data(), _frame.size());
+
+    for (auto client : _matched) {
+        auto& session = _sessions[client];
+        if (!session.active) {
+            continue;
+        }
+
+        auto asleep = _keep_alive.asleep(client);
+        if (topic.size() != 2 && hold_topic(session, publish.topic_id)) {
+            RegisterTopic register_topic {publish.topic_id, session.next_message_id++, std::string(topic)};
+            if (asleep) {
+                session.sleep_buffer.push(register_topic);
+            } else {
+                send(session, register_topic);
+            }
+        }
+        if (asleep) {
+            if (session.sleep_buffer.push(frame)) {
+                ++_stats.buffered;
+            }
+            continue;
+        }
+        send(session, frame);
+        ++_stats.delivered;
+    }
+
+    // An id registered for this delivery alone, that no subscriber took, is not kept.
+    if (topic.size() != 2 && (_topic_holders.size() <= publish.topic_id || _topic_holders[publish.topic_id] == 0)) {
+        _topics.unregister(publish.topic_id);
+    }
+}
+
+/***
+ * Sends what was held for @p session while it slept, oldest first.
+ */
+void Shard::wake(Session& session) {
+    session.sleep_buffer.drain([&](ByteView frame) {
+        send(session, frame);
+        // The 3-byte length form starts with 0x01.
+        if (static_cast<MessageType>(frame[0] == 0x01 ? frame[3] : frame[1]) == MessageType::Publish) {
+            ++_stats.delivered;
+        }
+    });
+}
+
+void Shard::send(Session& session, const Message& message) {
+    send(session.endpoint, ByteView(session.node.data(), session.node.size()), message);
+}
+
+void Shard::send(Session& session, ByteView frame) {
+    send(session.endpoint, ByteView(session.node.data(), session.node.size()), frame);
+}
+
+/***
+ * Frames for clients behind a forwarder (@p node not empty) go back to it inside a Forward.
+ */
+void Shard::send(const Endpoint& to, ByteView node, const Message& message) {
+    if (node.empty()) {
+        _engine.send(message, to);
+        return;
+    }
+
+    auto size = format::encoded_size(message);
+    if (!size) {
+        return;
+    }
+    format::encode_into(message, wrap_buffer(node, *size), *size);
+    send_wrapped(to, node, *size);
+}
+
+void Shard::send(const Endpoint& to, ByteView node, ByteView frame) {
+    if (node.empty()) {
+        _engine.send(frame, to);
+        return;
+    }
+
+    std::copy(frame.begin(), frame.end(), wrap_buffer(node, frame.size()));
+    send_wrapped(to, node, frame.size());
+}
+
+/***
+ * Room in _wrapped for a @p size byte frame, behind the Forward header for @p node.
+ */
+uint8_t* Shard::wrap_buffer(ByteView node, size_t size) {
+    auto headroom = format::forward_header_size(node.size());
+    _wrapped.resize(headroom + size);
+    return _wrapped.data() + headroom;
+}
+
+void Shard::send_wrapped(const Endpoint& to, ByteView node, size_t size) {
+    auto headroom = format::forward_header_size(node.size());
+    if (auto forward = format::wrap_forward(_wrapped.data() + headroom, size, headroom, 0, node)) {
+        _engine.send(forward.value(), to);
+    }
+}
+
+}
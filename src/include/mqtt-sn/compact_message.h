@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn {
+
+/**
+ * @brief Owning message in 32 bytes, for queues that hold many of them.
+ *
+ * A Message is as large as its largest alternative (Forward, with two vectors), whatever it
+ * holds. A CompactMessage stores the message encoded instead: the length and type fields, the
+ * fixed fields and the variable-length field back to back. Frames of up to INLINE_CAPACITY bytes,
+ * which is every message whose string or payload is 23 bytes or shorter (Forward aside), are kept
+ * inline; longer ones are kept in a single heap block.
+ *
+ * The frame can be sent as is; view() decodes it in place when its fields are needed.
+ */
+class CompactMessage {
+public:
+    static constexpr size_t INLINE_CAPACITY = 31;
+
+    /**
+     * @brief An empty message, which holds no frame. Moved-from messages are empty as well.
+     */
+    CompactMessage() = default;
+
+    /**
+     * @brief Encodes @p message; the result is empty if it is longer than MAX_FRAME_LENGTH.
+     */
+    explicit CompactMessage(const Message& message);
+    explicit CompactMessage(const MessageView& message);
+
+    /**
+     * @brief Copies an already encoded frame.
+     */
+    explicit CompactMessage(ByteView frame);
+
+    CompactMessage(const CompactMessage& other);
+    CompactMessage(CompactMessage&& other) noexcept;
+    CompactMessage& operator=(const CompactMessage& other);
+    CompactMessage& operator=(CompactMessage&& other) noexcept;
+    ~CompactMessage();
+
+    bool empty() const {
+        return _size == 0;
+    }
+
+    /**
+     * @brief Whether the frame is stored within the object.
+     */
+    bool is_inline() const {
+        return _size != HEAP;
+    }
+
+    /**
+     * @brief The encoded frame, valid until this message is modified or destroyed.
+     */
+    ByteView frame() const;
+
+    /**
+     * @brief The type field of the frame. Must not be called on an empty message.
+     */
+    MessageType type() const;
+
+    /**
+     * @brief Decodes the frame without copying; the view references this message.
+     *
+     * @return nullopt if the message is empty or the frame does not decode.
+     */
+    optional<MessageView> view() const;
+
+    /**
+     * @brief Decodes the frame into an owning Message.
+     */
+    optional<Message> message() const;
+
+private:
+    static constexpr uint8_t HEAP = 0xFF;
+
+    /***
+     * Out-of-line frames keep their pointer and size at the start of _storage.
+     */
+    struct Heap {
+        uint8_t* data;
+        uint32_t size;
+    };
+
+    uint8_t* allocate(size_t size);
+    void release();
+    Heap heap() const;
+
+    alignas(Heap) uint8_t _storage[INLINE_CAPACITY];
+    uint8_t _size = 0;      // inline frame size, or HEAP
+};
+
+static_assert(sizeof(CompactMessage) == 32, "CompactMessage must stay within half a cache line");
+
+}
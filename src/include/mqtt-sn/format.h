@@ -1,9 +1,15 @@
 #pragma once
 
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <memory_resource>
 #include <optional>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <type_traits>
 #include <variant>
 
 namespace mqtt_sn {
@@ -77,6 +83,54 @@ enum class MessageType : uint8_t {
     Forward           = 0xFE
 };
 
+/**
+ * @brief Non-owning view over a contiguous range of bytes.
+ *
+ * Used by the *View message structs to reference variable-length fields
+ * in place, without copying them out of the parsed buffer.
+ */
+class ByteView {
+public:
+    constexpr ByteView() = default;
+    constexpr ByteView(const uint8_t* data, size_t size) : _data(data), _size(size) {}
+
+    constexpr const uint8_t* data() const {
+        return _data;
+    }
+
+    constexpr size_t size() const {
+        return _size;
+    }
+
+    constexpr bool empty() const {
+        return _size == 0;
+    }
+
+    constexpr const uint8_t* begin() const {
+        return _data;
+    }
+
+    constexpr const uint8_t* end() const {
+        return _data + _size;
+    }
+
+    constexpr uint8_t operator[](size_t index) const {
+        return _data[index];
+    }
+
+    friend bool operator==(const ByteView& lhs, const ByteView& rhs) {
+        return std::equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end());
+    }
+
+    friend bool operator!=(const ByteView& lhs, const ByteView& rhs) {
+        return !(lhs == rhs);
+    }
+
+private:
+    const uint8_t* _data = nullptr;
+    size_t _size = 0;
+};
+
 union MessageFlags {
     struct {
         uint8_t dup : 1;
@@ -89,155 +143,471 @@ union MessageFlags {
     uint8_t value;
 };
 
+/***
+ * Wire layout descriptors. Every message struct lists its fields in wire order through a nested
+ * Layout type, from which parsing, encoding and size computation are generated.
+ *
+ * Field is a fixed-size, trivially copyable member. Tail takes the rest of the frame as a string
+ * or byte field; an optional Tail is absent when nothing is left. Topic is a topic name or a
+ * topic id, depending on the topic_id_type of the flags member. Encapsulated is the frame that
+ * follows a Forward header, outside of its length.
+ */
+namespace layout {
+template<auto Member>
+struct Field {};
+
+template<auto Member>
+struct Tail {};
+
+template<auto Flags, auto Member>
+struct Topic {};
+
+template<auto Member>
+struct Encapsulated {};
+
+template<MessageType Type, typename... Fields>
+struct Frame {
+    static constexpr MessageType type = Type;
+};
+}
+
+/***
+ * Messages with variable-length fields are templates over the allocator of those fields, so that
+ * decoded messages can live in an Arena (see pmr::Message). The plain names use std::allocator.
+ */
+template<template<typename> class Allocator>
+using Bytes = vector<uint8_t, Allocator<uint8_t>>;
+
+template<template<typename> class Allocator>
+using String = std::basic_string<char, std::char_traits<char>, Allocator<char>>;
+
 struct Advertise {
     uint8_t gateway_id;
     uint16_t duration;
+
+    using Layout = layout::Frame<MessageType::Advertise,
+        layout::Field<&Advertise::gateway_id>,
+        layout::Field<&Advertise::duration>>;
 };
 
 struct SearchGateway {
     uint8_t radius;
+
+    using Layout = layout::Frame<MessageType::SearchGateway, layout::Field<&SearchGateway::radius>>;
 };
 
-struct GatewayInfo {
+template<template<typename> class Allocator = std::allocator>
+struct BasicGatewayInfo {
     uint8_t gateway_id;
-    optional<vector<uint8_t>> gateway_addr;
+    optional<Bytes<Allocator>> gateway_addr;
+
+    using Layout = layout::Frame<MessageType::GatewayInfo,
+        layout::Field<&BasicGatewayInfo::gateway_id>,
+        layout::Tail<&BasicGatewayInfo::gateway_addr>>;
 };
+using GatewayInfo = BasicGatewayInfo<>;
 
 
-struct Connect {
+template<template<typename> class Allocator = std::allocator>
+struct BasicConnect {
     MessageFlags flags;
     uint8_t protocol_version;
     uint16_t duration;
-    std::string client_id;
+    String<Allocator> client_id;
+
+    using Layout = layout::Frame<MessageType::Connect,
+        layout::Field<&BasicConnect::flags>,
+        layout::Field<&BasicConnect::protocol_version>,
+        layout::Field<&BasicConnect::duration>,
+        layout::Tail<&BasicConnect::client_id>>;
 };
+using Connect = BasicConnect<>;
 
 struct ConnectAck {
     MessageErrorCode code;
+
+    using Layout = layout::Frame<MessageType::ConnectAck, layout::Field<&ConnectAck::code>>;
 };
 
-struct WillTopicRequest {};
+struct WillTopicRequest {
+    using Layout = layout::Frame<MessageType::WillTopicRequest>;
+};
 
 /***
  * An empty WILLTOPIC message is a WILLTOPIC message without Flags and WillTopic field (i.e. it is exactly
  * 2 octets long). It is used by a client to delete the Will topic and the Will message stored in the server, see Section 6.4.
  */
-struct WillTopicEmpty {};
-struct WillTopic {
+struct WillTopicEmpty {
+    using Layout = layout::Frame<MessageType::WillTopic>;
+};
+template<template<typename> class Allocator = std::allocator>
+struct BasicWillTopic {
     MessageFlags flags;
-    std::string topic;
+    String<Allocator> topic;
+
+    using Layout = layout::Frame<MessageType::WillTopic,
+        layout::Field<&BasicWillTopic::flags>,
+        layout::Tail<&BasicWillTopic::topic>>;
+};
+using WillTopic = BasicWillTopic<>;
+
+struct WillMessageRequest {
+    using Layout = layout::Frame<MessageType::WillMessageRequest>;
 };
 
-struct WillMessageRequest {};
+template<template<typename> class Allocator = std::allocator>
+struct BasicWillMessage {
+    Bytes<Allocator> payload;
 
-struct WillMessage {
-    vector<uint8_t> payload;
+    using Layout = layout::Frame<MessageType::WillMessage, layout::Tail<&BasicWillMessage::payload>>;
 };
+using WillMessage = BasicWillMessage<>;
 
 /***
  * An empty WILLTOPICUPD message is a WILLTOPICUPD message without Flags and WillTopic field (i.e.
  * it is exactly 2 octets long). It is used by a client to delete its Will topic and Will message stored in the GW/server
  */
-struct WillTopicUpdateEmpty {};
-struct WillTopicUpdate {
+struct WillTopicUpdateEmpty {
+    using Layout = layout::Frame<MessageType::WillTopicUpdate>;
+};
+template<template<typename> class Allocator = std::allocator>
+struct BasicWillTopicUpdate {
     MessageFlags flags;
-    std::string topic;
+    String<Allocator> topic;
+
+    using Layout = layout::Frame<MessageType::WillTopicUpdate,
+        layout::Field<&BasicWillTopicUpdate::flags>,
+        layout::Tail<&BasicWillTopicUpdate::topic>>;
 };
+using WillTopicUpdate = BasicWillTopicUpdate<>;
 
 struct WillTopicResponse {
     MessageErrorCode code;
+
+    using Layout = layout::Frame<MessageType::WillTopicResponse, layout::Field<&WillTopicResponse::code>>;
 };
 
-struct WillMessageUpdate {
-    vector<uint8_t> payload;
+template<template<typename> class Allocator = std::allocator>
+struct BasicWillMessageUpdate {
+    Bytes<Allocator> payload;
+
+    using Layout = layout::Frame<MessageType::WillMessageUpdate,
+        layout::Tail<&BasicWillMessageUpdate::payload>>;
 };
+using WillMessageUpdate = BasicWillMessageUpdate<>;
 
 struct WillMessageResponse {
     MessageErrorCode code;
+
+    using Layout = layout::Frame<MessageType::WillMessageResponse, layout::Field<&WillMessageResponse::code>>;
 };
 
-struct RegisterTopic {
+template<template<typename> class Allocator = std::allocator>
+struct BasicRegisterTopic {
     uint16_t topic_id;
     uint16_t message_id;
-    std::string topic;
+    String<Allocator> topic;
+
+    using Layout = layout::Frame<MessageType::Register,
+        layout::Field<&BasicRegisterTopic::topic_id>,
+        layout::Field<&BasicRegisterTopic::message_id>,
+        layout::Tail<&BasicRegisterTopic::topic>>;
 };
+using RegisterTopic = BasicRegisterTopic<>;
 
 struct RegisterTopicAck {
     uint16_t topic_id;
     uint16_t message_id;
     MessageErrorCode code;
+
+    using Layout = layout::Frame<MessageType::RegisterAck,
+        layout::Field<&RegisterTopicAck::topic_id>,
+        layout::Field<&RegisterTopicAck::message_id>,
+        layout::Field<&RegisterTopicAck::code>>;
 };
 
-struct PublishMessage {
+template<template<typename> class Allocator = std::allocator>
+struct BasicPublishMessage {
     MessageFlags flags;
     uint16_t topic_id; //contains the topic id value or the short topic name for which the data is published
     uint16_t message_id;
-    vector<uint8_t> payload;
+    Bytes<Allocator> payload;
+
+    using Layout = layout::Frame<MessageType::Publish,
+        layout::Field<&BasicPublishMessage::flags>,
+        layout::Field<&BasicPublishMessage::topic_id>,
+        layout::Field<&BasicPublishMessage::message_id>,
+        layout::Tail<&BasicPublishMessage::payload>>;
 };
+using PublishMessage = BasicPublishMessage<>;
 
 struct PublishMessageAck {
     uint16_t topic_id;
     uint16_t message_id;
     MessageErrorCode code;
+
+    using Layout = layout::Frame<MessageType::PublishAck,
+        layout::Field<&PublishMessageAck::topic_id>,
+        layout::Field<&PublishMessageAck::message_id>,
+        layout::Field<&PublishMessageAck::code>>;
 };
 
 struct PublishMessageComplete {
     uint16_t message_id;
+
+    using Layout = layout::Frame<MessageType::PublishComplete,
+        layout::Field<&PublishMessageComplete::message_id>>;
 };
 
 struct PublishMessageReceived {
     uint16_t message_id;
+
+    using Layout = layout::Frame<MessageType::PublishReceived,
+        layout::Field<&PublishMessageReceived::message_id>>;
 };
 
 struct PublishMessageRelease {
     uint16_t message_id;
+
+    using Layout = layout::Frame<MessageType::PublishRelease,
+        layout::Field<&PublishMessageRelease::message_id>>;
 };
 
-struct Subscribe {
+template<template<typename> class Allocator = std::allocator>
+struct BasicSubscribe {
     MessageFlags flags;
     uint16_t message_id;
-    std::variant<uint16_t, std::string> topic;
+    std::variant<uint16_t, String<Allocator>> topic;
+
+    using Layout = layout::Frame<MessageType::Subscribe,
+        layout::Field<&BasicSubscribe::flags>,
+        layout::Field<&BasicSubscribe::message_id>,
+        layout::Topic<&BasicSubscribe::flags, &BasicSubscribe::topic>>;
 };
+using Subscribe = BasicSubscribe<>;
 
 struct SubscribeAck {
     MessageFlags flags;
     uint16_t topic_id;
     uint16_t message_id;
     MessageErrorCode code;
+
+    using Layout = layout::Frame<MessageType::SubscribeAck,
+        layout::Field<&SubscribeAck::flags>,
+        layout::Field<&SubscribeAck::topic_id>,
+        layout::Field<&SubscribeAck::message_id>,
+        layout::Field<&SubscribeAck::code>>;
 };
 
-struct Unsubscribe {
+template<template<typename> class Allocator = std::allocator>
+struct BasicUnsubscribe {
     MessageFlags flags;
     uint16_t message_id;
-    std::variant<uint16_t, std::string> topic;
+    std::variant<uint16_t, String<Allocator>> topic;
+
+    using Layout = layout::Frame<MessageType::Unsubscribe,
+        layout::Field<&BasicUnsubscribe::flags>,
+        layout::Field<&BasicUnsubscribe::message_id>,
+        layout::Topic<&BasicUnsubscribe::flags, &BasicUnsubscribe::topic>>;
 };
+using Unsubscribe = BasicUnsubscribe<>;
 
 struct UnsubscribeAck {
     uint16_t message_id;
+
+    using Layout = layout::Frame<MessageType::UnsubscribeAck, layout::Field<&UnsubscribeAck::message_id>>;
 };
 
-struct PingRequest {
-    optional<std::string> client_id;
+template<template<typename> class Allocator = std::allocator>
+struct BasicPingRequest {
+    optional<String<Allocator>> client_id;
+
+    using Layout = layout::Frame<MessageType::PingRequest, layout::Tail<&BasicPingRequest::client_id>>;
 };
+using PingRequest = BasicPingRequest<>;
 
-struct PingResponse {};
+struct PingResponse {
+    using Layout = layout::Frame<MessageType::PingResponse>;
+};
 
 struct Disconnect {
     optional<uint16_t> duration;
+
+    using Layout = layout::Frame<MessageType::Disconnect, layout::Tail<&Disconnect::duration>>;
 };
 
 static constexpr uint8_t FORWARD_CTRL_RADIUS_MASK = 0b11;
-struct Forward {
+template<template<typename> class Allocator = std::allocator>
+struct BasicForward {
     uint8_t ctrl;
-    vector<uint8_t> gateway_addr;
-    vector<uint8_t> payload;
+    Bytes<Allocator> gateway_addr;
+    Bytes<Allocator> payload;
+
+    using Layout = layout::Frame<MessageType::Forward,
+        layout::Field<&BasicForward::ctrl>,
+        layout::Tail<&BasicForward::gateway_addr>,
+        layout::Encapsulated<&BasicForward::payload>>;
+};
+using Forward = BasicForward<>;
+
+template<template<typename> class Allocator>
+using BasicMessage = std::variant<Advertise, SearchGateway, BasicGatewayInfo<Allocator>, BasicConnect<Allocator>, ConnectAck,
+                                  WillTopicRequest, WillTopicEmpty, BasicWillTopic<Allocator>, WillMessageRequest, BasicWillMessage<Allocator>,
+                                  BasicWillTopicUpdate<Allocator>, WillTopicResponse, WillTopicUpdateEmpty, BasicWillMessageUpdate<Allocator>, WillMessageResponse,
+                                  BasicRegisterTopic<Allocator>, RegisterTopicAck, BasicPublishMessage<Allocator>, PublishMessageAck, PublishMessageComplete,
+                                  PublishMessageReceived, PublishMessageRelease, BasicSubscribe<Allocator>, SubscribeAck, BasicUnsubscribe<Allocator>, UnsubscribeAck,
+                                  BasicPingRequest<Allocator>, PingResponse, Disconnect, BasicForward<Allocator>>;
+
+using Message = BasicMessage<std::allocator>;
+
+namespace pmr {
+using GatewayInfo = BasicGatewayInfo<std::pmr::polymorphic_allocator>;
+using Connect = BasicConnect<std::pmr::polymorphic_allocator>;
+using WillTopic = BasicWillTopic<std::pmr::polymorphic_allocator>;
+using WillMessage = BasicWillMessage<std::pmr::polymorphic_allocator>;
+using WillTopicUpdate = BasicWillTopicUpdate<std::pmr::polymorphic_allocator>;
+using WillMessageUpdate = BasicWillMessageUpdate<std::pmr::polymorphic_allocator>;
+using RegisterTopic = BasicRegisterTopic<std::pmr::polymorphic_allocator>;
+using PublishMessage = BasicPublishMessage<std::pmr::polymorphic_allocator>;
+using Subscribe = BasicSubscribe<std::pmr::polymorphic_allocator>;
+using Unsubscribe = BasicUnsubscribe<std::pmr::polymorphic_allocator>;
+using PingRequest = BasicPingRequest<std::pmr::polymorphic_allocator>;
+using Forward = BasicForward<std::pmr::polymorphic_allocator>;
+
+using Message = BasicMessage<std::pmr::polymorphic_allocator>;
+}
+
+/***
+ * Non-owning counterparts of the messages with variable-length fields. Their string and byte
+ * fields reference the buffer they were parsed from, which must outlive them.
+ */
+struct GatewayInfoView {
+    uint8_t gateway_id;
+    optional<ByteView> gateway_addr;
+
+    using Layout = layout::Frame<MessageType::GatewayInfo,
+        layout::Field<&GatewayInfoView::gateway_id>,
+        layout::Tail<&GatewayInfoView::gateway_addr>>;
+};
+
+struct ConnectView {
+    MessageFlags flags;
+    uint8_t protocol_version;
+    uint16_t duration;
+    std::string_view client_id;
+
+    using Layout = layout::Frame<MessageType::Connect,
+        layout::Field<&ConnectView::flags>,
+        layout::Field<&ConnectView::protocol_version>,
+        layout::Field<&ConnectView::duration>,
+        layout::Tail<&ConnectView::client_id>>;
+};
+
+struct WillTopicView {
+    MessageFlags flags;
+    std::string_view topic;
+
+    using Layout = layout::Frame<MessageType::WillTopic,
+        layout::Field<&WillTopicView::flags>,
+        layout::Tail<&WillTopicView::topic>>;
 };
 
-using Message = std::variant<Advertise, SearchGateway, GatewayInfo, Connect, ConnectAck,
-                             WillTopicRequest, WillTopicEmpty, WillTopic, WillMessageRequest, WillMessage,
-                             WillTopicUpdate, WillTopicResponse, WillTopicUpdateEmpty, WillMessageUpdate, WillMessageResponse,
-                             RegisterTopic, RegisterTopicAck, PublishMessage, PublishMessageAck, PublishMessageComplete,
-                             PublishMessageReceived, PublishMessageRelease, Subscribe, SubscribeAck, Unsubscribe, UnsubscribeAck,
-                             PingRequest, PingResponse, Disconnect, Forward>;
+struct WillMessageView {
+    ByteView payload;
+
+    using Layout = layout::Frame<MessageType::WillMessage, layout::Tail<&WillMessageView::payload>>;
+};
+
+struct WillTopicUpdateView {
+    MessageFlags flags;
+    std::string_view topic;
+
+    using Layout = layout::Frame<MessageType::WillTopicUpdate,
+        layout::Field<&WillTopicUpdateView::flags>,
+        layout::Tail<&WillTopicUpdateView::topic>>;
+};
+
+struct WillMessageUpdateView {
+    ByteView payload;
+
+    using Layout = layout::Frame<MessageType::WillMessageUpdate,
+        layout::Tail<&WillMessageUpdateView::payload>>;
+};
+
+struct RegisterTopicView {
+    uint16_t topic_id;
+    uint16_t message_id;
+    std::string_view topic;
+
+    using Layout = layout::Frame<MessageType::Register,
+        layout::Field<&RegisterTopicView::topic_id>,
+        layout::Field<&RegisterTopicView::message_id>,
+        layout::Tail<&RegisterTopicView::topic>>;
+};
+
+struct PublishMessageView {
+    MessageFlags flags;
+    uint16_t topic_id;
+    uint16_t message_id;
+    ByteView payload;
+
+    using Layout = layout::Frame<MessageType::Publish,
+        layout::Field<&PublishMessageView::flags>,
+        layout::Field<&PublishMessageView::topic_id>,
+        layout::Field<&PublishMessageView::message_id>,
+        layout::Tail<&PublishMessageView::payload>>;
+};
+
+struct SubscribeView {
+    MessageFlags flags;
+    uint16_t message_id;
+    std::variant<uint16_t, std::string_view> topic;
+
+    using Layout = layout::Frame<MessageType::Subscribe,
+        layout::Field<&SubscribeView::flags>,
+        layout::Field<&SubscribeView::message_id>,
+        layout::Topic<&SubscribeView::flags, &SubscribeView::topic>>;
+};
+
+struct UnsubscribeView {
+    MessageFlags flags;
+    uint16_t message_id;
+    std::variant<uint16_t, std::string_view> topic;
+
+    using Layout = layout::Frame<MessageType::Unsubscribe,
+        layout::Field<&UnsubscribeView::flags>,
+        layout::Field<&UnsubscribeView::message_id>,
+        layout::Topic<&UnsubscribeView::flags, &UnsubscribeView::topic>>;
+};
+
+struct PingRequestView {
+    optional<std::string_view> client_id;
+
+    using Layout = layout::Frame<MessageType::PingRequest, layout::Tail<&PingRequestView::client_id>>;
+};
+
+struct ForwardView {
+    uint8_t ctrl;
+    ByteView gateway_addr;
+    ByteView payload;
+
+    using Layout = layout::Frame<MessageType::Forward,
+        layout::Field<&ForwardView::ctrl>,
+        layout::Tail<&ForwardView::gateway_addr>,
+        layout::Encapsulated<&ForwardView::payload>>;
+};
+
+/***
+ * Same alternatives in the same order as Message, so index() is interchangeable between the two.
+ */
+using MessageView = std::variant<Advertise, SearchGateway, GatewayInfoView, ConnectView, ConnectAck,
+                                 WillTopicRequest, WillTopicEmpty, WillTopicView, WillMessageRequest, WillMessageView,
+                                 WillTopicUpdateView, WillTopicResponse, WillTopicUpdateEmpty, WillMessageUpdateView, WillMessageResponse,
+                                 RegisterTopicView, RegisterTopicAck, PublishMessageView, PublishMessageAck, PublishMessageComplete,
+                                 PublishMessageReceived, PublishMessageRelease, SubscribeView, SubscribeAck, UnsubscribeView, UnsubscribeAck,
+                                 PingRequestView, PingResponse, Disconnect, ForwardView>;
+
+static_assert(std::variant_size_v<MessageView> == std::variant_size_v<Message>);
 
 
 
@@ -245,9 +615,54 @@ namespace format {
 template<typename T>
 struct is_vector : std::false_type {};
 
+template<typename T, typename Allocator>
+struct is_vector<std::vector<T, Allocator>> : std::true_type {};
+
+template<typename T>
+struct is_string : std::false_type {};
+
+template<typename Allocator>
+struct is_string<std::basic_string<char, std::char_traits<char>, Allocator>> : std::true_type {};
+
+template<typename T>
+struct dependent_false : std::false_type {};
+
+/**
+ * @brief Converts between host and network (big-endian) byte order. The conversion is its
+ * own inverse, so it serves both reads and writes. Non-integral and single-byte types are
+ * returned unchanged.
+ */
 template<typename T>
-struct is_vector<std::vector<T>> : std::true_type {};
+constexpr T network_order(T value) {
+    if constexpr (!std::is_integral<T>::value || sizeof(T) == 1) {
+        return value;
+    } else {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        return value;
+#elif defined(__GNUC__) || defined(__clang__)
+        if constexpr (sizeof(T) == 2) {
+            return static_cast<T>(__builtin_bswap16(static_cast<uint16_t>(value)));
+        } else if constexpr (sizeof(T) == 4) {
+            return static_cast<T>(__builtin_bswap32(static_cast<uint32_t>(value)));
+        } else {
+            static_assert(sizeof(T) == 8, "Unsupported integer size");
+            return static_cast<T>(__builtin_bswap64(static_cast<uint64_t>(value)));
+        }
+#else
+        using U = std::make_unsigned_t<T>;
+        U from = static_cast<U>(value);
+        U to = 0;
+        for (size_t i = 0; i < sizeof(T); ++i) {
+            to = static_cast<U>((to << 8) | ((from >> (8 * i)) & 0xFF));
+        }
+        return static_cast<T>(to);
+#endif
+    }
+}
 
+/***
+ * Integers are read and written in network byte order; everything else is copied as is.
+ */
 class BufferReader {
 public:
     BufferReader(const uint8_t* data, size_t size) : _data(data), _size(size) {}
@@ -288,7 +703,22 @@ public:
         T value;
         std::copy(this->begin() + _read_offset, this->begin() + _read_offset + sizeof(T), reinterpret_cast<uint8_t*>(&value));
         _read_offset += sizeof(T);
-        return value;
+        return network_order(value);
+    }
+
+    /**
+     * @brief Reads a T without checking the remaining size. The caller must have checked
+     * readable<T>() (or a larger bound) beforehand.
+     */
+    template<typename T>
+    T read_unchecked() {
+        static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+        assert(readable<T>());
+
+        T value;
+        std::copy(this->begin() + _read_offset, this->begin() + _read_offset + sizeof(T), reinterpret_cast<uint8_t*>(&value));
+        _read_offset += sizeof(T);
+        return network_order(value);
     }
 
     template<typename T>
@@ -320,8 +750,24 @@ public:
             std::copy(this->begin() + _read_offset, this->begin() + _read_offset + count * sizeof(ValueType), reinterpret_cast<uint8_t*>(value.data()));
             _read_offset += count * sizeof(ValueType);
             return value;
+        } else if constexpr (std::is_same<T, std::string_view>::value) {
+            if (readable_bytes() < count) {
+                return nullopt;
+            }
+
+            std::string_view value(reinterpret_cast<const char*>(this->begin() + _read_offset), count);
+            _read_offset += count;
+            return value;
+        } else if constexpr (std::is_same<T, ByteView>::value) {
+            if (readable_bytes() < count) {
+                return nullopt;
+            }
+
+            ByteView value(this->begin() + _read_offset, count);
+            _read_offset += count;
+            return value;
         } else {
-            static_assert(false, "Unsupported type");
+            static_assert(dependent_false<T>::value, "Unsupported type");
         }
     }
 
@@ -347,22 +793,618 @@ class BufferWriter : public vector<uint8_t> {
 public:
     template<typename T>
     void write(const T& value) {
-        if constexpr (std::is_same<T, std::string>::value) {
+        if constexpr (is_string<T>::value) {
             this->insert(this->end(), value.begin(), value.end());
         } else if constexpr (is_vector<T>::value) {
             using ValueType = typename T::value_type;
             static_assert(std::is_trivially_copyable<ValueType>::value, "T must be trivially copyable");
 
             this->insert(this->end(), reinterpret_cast<const uint8_t*>(value.data()), reinterpret_cast<const uint8_t*>(value.data()) + value.size() * sizeof(ValueType));
+        } else if constexpr (std::is_same<T, std::string_view>::value || std::is_same<T, ByteView>::value) {
+            this->insert(this->end(), reinterpret_cast<const uint8_t*>(value.data()), reinterpret_cast<const uint8_t*>(value.data()) + value.size());
         } else {
             static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
-            this->insert(this->end(), reinterpret_cast<const uint8_t*>(&value), reinterpret_cast<const uint8_t*>(&value) + sizeof(T));
+            const T wire = network_order(value);
+            this->insert(this->end(), reinterpret_cast<const uint8_t*>(&wire), reinterpret_cast<const uint8_t*>(&wire) + sizeof(T));
         }
     }
 };
 
+/**
+ * @brief Writes into caller-provided memory of fixed capacity.
+ *
+ * Has the same write interface as BufferWriter, but never allocates. Writes are not
+ * bounds-checked in release builds; callers size the destination with encoded_size() first.
+ */
+class SpanWriter {
+public:
+    SpanWriter(uint8_t* data, size_t capacity) : _data(data), _capacity(capacity) {}
+
+    uint8_t* data() const {
+        return _data;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t capacity() const {
+        return _capacity;
+    }
+
+    template<typename T>
+    void write(const T& value) {
+        if constexpr (is_string<T>::value) {
+            append(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+        } else if constexpr (is_vector<T>::value) {
+            using ValueType = typename T::value_type;
+            static_assert(std::is_trivially_copyable<ValueType>::value, "T must be trivially copyable");
+
+            append(reinterpret_cast<const uint8_t*>(value.data()), value.size() * sizeof(ValueType));
+        } else if constexpr (std::is_same<T, std::string_view>::value || std::is_same<T, ByteView>::value) {
+            append(reinterpret_cast<const uint8_t*>(value.data()), value.size());
+        } else {
+            static_assert(std::is_trivially_copyable<T>::value, "T must be trivially copyable");
+            const T wire = network_order(value);
+            append(reinterpret_cast<const uint8_t*>(&wire), sizeof(T));
+        }
+    }
+
+private:
+    void append(const uint8_t* src, size_t count) {
+        assert(count <= _capacity - _size);
+        std::copy(src, src + count, _data + _size);
+        _size += count;
+    }
+
+    uint8_t* _data;
+    size_t _capacity;
+    size_t _size = 0;
+};
+
+/**
+ * @brief Wire length of a frame whose length field, in its 1-byte form, would be @p len.
+ *
+ * Frames of 256 bytes or more use the 3-byte length form, which adds two bytes.
+ */
+constexpr size_t frame_length(size_t len) {
+    return len < 256 ? len : len + sizeof(uint16_t);
+}
+
+/**
+ * @brief Largest value the length field can hold. A Forward's encapsulated frame is not counted
+ * in its length, so only the frame it wraps is bound by this.
+ */
+constexpr size_t MAX_FRAME_LENGTH = UINT16_MAX;
+
 optional<Message> parse(BufferReader& buffer);
+
+/**
+ * @brief Why a frame was rejected by the decoder.
+ */
+enum class ParseError : uint8_t {
+    Truncated,      // the buffer ends before the frame does
+    BadLength,      // the length field is smaller than the header
+    UnknownType,
+    TooShort,       // the body is shorter than its type requires
+    BadField        // a field within the body does not decode
+};
+
+constexpr size_t PARSE_ERROR_COUNT = static_cast<size_t>(ParseError::BadField) + 1;
+
+/**
+ * @brief Lower-case name of @p error, e.g. "too_short", for logs and metric labels.
+ */
+std::string_view name(ParseError error);
+
+/**
+ * @brief Either a decoded value or the reason it could not be decoded, along with the offset
+ * (within the buffer being read) of the field at fault: the length field, the type field, the
+ * first field that does not decode, or the frame a Forward encapsulates.
+ *
+ * Nothing throws: like operator* on an optional, value() must only be called on success.
+ */
+template<typename T>
+class ParseResult {
+public:
+    ParseResult(T&& value) : _value(std::move(value)) {}
+    ParseResult(ParseError error, size_t offset) : _error(error), _offset(offset) {}
+
+    bool has_value() const {
+        return _value.has_value();
+    }
+
+    explicit operator bool() const {
+        return has_value();
+    }
+
+    T& value() & {
+        assert(has_value());
+        return *_value;
+    }
+
+    const T& value() const& {
+        assert(has_value());
+        return *_value;
+    }
+
+    T&& value() && {
+        assert(has_value());
+        return std::move(*_value);
+    }
+
+    T& operator*() & {
+        return value();
+    }
+
+    const T& operator*() const& {
+        return value();
+    }
+
+    T* operator->() {
+        return &value();
+    }
+
+    const T* operator->() const {
+        return &value();
+    }
+
+    /**
+     * @brief Only meaningful when there is no value.
+     */
+    ParseError error() const {
+        return _error;
+    }
+
+    size_t offset() const {
+        return _offset;
+    }
+
+private:
+    optional<T> _value;
+    ParseError _error = ParseError::Truncated;
+    size_t _offset = 0;
+};
+
+/**
+ * @brief Parses one message as parse() does, but tells why a frame is rejected.
+ *
+ * After an error the read offset of @p buffer is unspecified.
+ */
+ParseResult<Message> try_parse(BufferReader& buffer);
+
+/**
+ * @brief Bump allocator for decoded messages.
+ *
+ * Every pmr message parsed into an arena is released at once by reset(); the messages must not
+ * be used afterwards. Once the initial block is large enough for a batch, steady-state
+ * parse/reset cycles do not touch the global heap.
+ */
+class Arena {
+public:
+    explicit Arena(size_t initial_size = 4096)
+        : _initial(initial_size), _resource(_initial.data(), _initial.size()) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    std::pmr::memory_resource* resource() {
+        return &_resource;
+    }
+
+    void reset() {
+        _resource.release();
+    }
+
+private:
+    vector<std::byte> _initial;
+    std::pmr::monotonic_buffer_resource _resource;
+};
+
+/**
+ * @brief Parses one message whose variable-length fields are allocated from @p arena.
+ */
+optional<pmr::Message> parse(BufferReader& buffer, Arena& arena);
+ParseResult<pmr::Message> try_parse(BufferReader& buffer, Arena& arena);
+
+/**
+ * @brief Parses one message without copying its variable-length fields.
+ *
+ * The returned view references the memory behind @p buffer. No allocation is performed;
+ * frames that are truncated or shorter than their type requires yield nullopt.
+ */
+optional<MessageView> parse_view(BufferReader& buffer);
+ParseResult<MessageView> try_parse_view(BufferReader& buffer);
+
+/**
+ * @brief A frame whose header has been validated and whose fields are read on demand.
+ *
+ * The getters load straight from the frame, at offsets looked up per type in a table generated
+ * from the message layouts, so a routing decision costs a few loads. A getter returns nullopt
+ * (or an empty payload) when the type has no such field or the frame is too short to hold it.
+ * view() and message() decode the whole frame when it is needed after all.
+ *
+ * A LazyFrame references the memory it was parsed from, which must outlive it.
+ */
+class LazyFrame {
+public:
+    /***
+     * Offsets of the routing fields within the body (the bytes after the type field), -1 when
+     * absent. A topic field holds a topic id or, for TopicIdType::Normal, the topic name as the
+     * tail. An encapsulated frame follows the Forward header, outside of its length.
+     */
+    struct Offsets {
+        int8_t flags = -1;
+        int8_t topic_id = -1;
+        int8_t message_id = -1;
+        int8_t tail = -1;
+        bool topic = false;
+        bool encapsulated = false;
+    };
+
+    LazyFrame(const uint8_t* data, size_t len, size_t size, size_t header_len, const Offsets& offsets)
+        : _data(data), _size(static_cast<uint32_t>(size)), _len(static_cast<uint16_t>(len)),
+          _header_len(static_cast<uint8_t>(header_len)), _offsets(&offsets) {}
+
+    MessageType type() const {
+        return static_cast<MessageType>(_data[_header_len - 1]);
+    }
+
+    /**
+     * @brief The whole frame, including the frame a Forward encapsulates.
+     */
+    ByteView frame() const {
+        return ByteView(_data, _size);
+    }
+
+    optional<MessageFlags> flags() const {
+        if (!has(_offsets->flags, sizeof(MessageFlags))) {
+            return nullopt;
+        }
+        MessageFlags flags;
+        flags.value = body()[_offsets->flags];
+        return flags;
+    }
+
+    optional<uint16_t> topic_id() const {
+        if (!has(_offsets->topic_id, sizeof(uint16_t)) || (_offsets->topic && is_topic_name())) {
+            return nullopt;
+        }
+        return load(body() + _offsets->topic_id);
+    }
+
+    optional<uint16_t> message_id() const {
+        if (!has(_offsets->message_id, sizeof(uint16_t))) {
+            return nullopt;
+        }
+        return load(body() + _offsets->message_id);
+    }
+
+    /**
+     * @brief The trailing variable-length field: PUBLISH data, REGISTER or SUBSCRIBE topic name,
+     * CONNECT client id, ..., or the frame encapsulated by a Forward.
+     */
+    ByteView payload() const {
+        if (_offsets->encapsulated) {
+            return ByteView(_data + _len, _size - _len);
+        }
+        if (!has(_offsets->tail, 0) || (_offsets->topic && !is_topic_name())) {
+            return {};
+        }
+        return ByteView(body() + _offsets->tail, body_len() - _offsets->tail);
+    }
+
+    optional<MessageView> view() const;
+    optional<Message> message() const;
+
+private:
+    const uint8_t* body() const {
+        return _data + _header_len;
+    }
+
+    size_t body_len() const {
+        return _len - _header_len;
+    }
+
+    bool has(int8_t offset, size_t size) const {
+        return offset >= 0 && static_cast<size_t>(offset) + size <= body_len();
+    }
+
+    bool is_topic_name() const {
+        return static_cast<TopicIdType>(flags()->topic_id_type) == TopicIdType::Normal;
+    }
+
+    static uint16_t load(const uint8_t* src) {
+        uint16_t value;
+        std::copy(src, src + sizeof(value), reinterpret_cast<uint8_t*>(&value));
+        return network_order(value);
+    }
+
+    const uint8_t* _data;
+    uint32_t _size;             // whole frame, including an encapsulated one
+    uint16_t _len;              // value of the length field
+    uint8_t _header_len;        // length and type fields
+    const Offsets* _offsets;
+};
+
+/**
+ * @brief Validates the length and type fields of the frame at the current offset of @p buffer,
+ * as parse() does, and moves past it without decoding its body. A Forward must be followed by
+ * the complete frame it encapsulates.
+ */
+optional<LazyFrame> parse_lazy(BufferReader& buffer);
+
+enum class FrameStatus : uint8_t {
+    Complete,
+    NeedMore,
+    Malformed
+};
+
+/**
+ * @brief Result of frame_extent().
+ *
+ * When Complete, size is the length of the frame. When NeedMore, size is the number of bytes
+ * that must be available before the extent can be determined further; this is the full frame
+ * length once the length field has been seen.
+ */
+struct FrameExtent {
+    FrameStatus status;
+    size_t size;
+};
+
+/**
+ * @brief Determines where the frame starting at @p data ends, looking only at length fields.
+ *
+ * A Forward frame extends over the frame it encapsulates, which must not be a Forward itself
+ * (Malformed otherwise), so no frame spans more than two length fields' worth of bytes.
+ */
+FrameExtent frame_extent(const uint8_t* data, size_t size);
+
+/**
+ * @brief Structure-of-arrays result of split_frames(); entry i describes the i-th frame of the
+ * buffer. A Forward entry spans the frame it encapsulates, as with frame_extent().
+ */
+struct FrameIndex {
+    const uint8_t* data = nullptr;  // the buffer that was split
+    vector<uint32_t> offsets;
+    vector<uint32_t> sizes;
+    vector<MessageType> types;
+
+    size_t size() const {
+        return types.size();
+    }
+
+    ByteView frame(size_t index) const {
+        return ByteView(data + offsets[index], sizes[index]);
+    }
+
+    void clear() {
+        offsets.clear();
+        sizes.clear();
+        types.clear();
+    }
+};
+
+/**
+ * @brief Result of split_frames(). When the buffer does not end on a frame boundary, status
+ * tells whether the rest is the start of a frame (NeedMore) or cannot be (Malformed).
+ */
+struct SplitResult {
+    FrameStatus status;
+    size_t consumed;    // bytes covered by the indexed frames
+};
+
+/**
+ * @brief Indexes the frames lying back to back in @p data (a serial or TCP read, a batch of
+ * relayed frames) in a single pass over their length fields.
+ *
+ * Every length is checked against the bytes that remain, but no frame is parsed: entries can be
+ * handed to parse() or parse_view() later, in any order or from several threads. The vectors in
+ * @p index are reused across calls, so steady-state splitting does not allocate.
+ *
+ * Offsets are 32-bit, so @p size must be below 4 GiB.
+ */
+SplitResult split_frames(const uint8_t* data, size_t size, FrameIndex& index);
+
+/**
+ * @brief Size of the Forward header that encapsulates a frame for a @p node_id_size byte
+ * wireless node id.
+ */
+constexpr size_t forward_header_size(size_t node_id_size) {
+    return 3 + node_id_size <= UINT8_MAX ? 3 + node_id_size : 5 + node_id_size;
+}
+
+/**
+ * @brief Forwarder fast path: splits the Forward frame at @p data into its header fields and the
+ * frame it encapsulates.
+ *
+ * Only length fields are read; nothing is copied and the inner frame is not parsed, so its view
+ * can be relayed as is or handed to parse_view().
+ *
+ * @return nullopt if @p data does not start with a Forward followed by a complete frame.
+ */
+optional<ForwardView> unwrap_forward(const uint8_t* data, size_t size);
+
+/**
+ * @brief Forwarder fast path: encapsulates the @p frame_size byte frame at @p frame in place, by
+ * writing a Forward header into the @p headroom bytes just before it. The frame is not touched.
+ *
+ * @return The Forward frame, which starts forward_header_size() bytes before @p frame, or nullopt
+ *         if @p headroom is too small or @p frame is itself a Forward.
+ */
+optional<ByteView> wrap_forward(uint8_t* frame, size_t frame_size, size_t headroom, uint8_t ctrl, ByteView node_id);
+
+/**
+ * @brief Splits a byte stream (TCP, serial) into frames.
+ *
+ * Chunks are handed over with feed() and frames are pulled with next(). Frames that lie
+ * entirely within a chunk are returned as views into it; only a frame straddling chunks is
+ * copied into an internal buffer. A returned frame stays valid until the following call to
+ * next() or feed(), and a fed chunk must stay valid until next() reports NeedMore.
+ *
+ * After an Error the stream has lost framing, and every call reports Error until reset().
+ * A Forward encapsulating a Forward is an Error, so the internal buffer never grows past one
+ * Forward and the frame it wraps.
+ */
+class StreamDecoder {
+public:
+    enum class Status : uint8_t {
+        NeedMore,
+        Frame,
+        Error
+    };
+
+    struct Result {
+        Status status;
+        ByteView frame;
+    };
+
+    void feed(const uint8_t* data, size_t size);
+    Result next();
+    void reset();
+
+    size_t buffered_bytes() const {
+        return _pending.size() + (_chunk_size - _chunk_offset);
+    }
+
+private:
+    vector<uint8_t> _pending;
+    bool _pending_emitted = false;
+    bool _error = false;
+    const uint8_t* _chunk = nullptr;
+    size_t _chunk_size = 0;
+    size_t _chunk_offset = 0;
+};
+
+/**
+ * @brief One received datagram, expected to hold exactly one frame.
+ */
+struct Datagram {
+    const uint8_t* data;
+    size_t size;
+};
+
+/**
+ * @brief Structure-of-arrays result of parse_batch(); entry i describes datagram i.
+ *
+ * Only the routing fields are decoded. Fields a message type does not carry are zero, and
+ * payloads hold the trailing variable-length field (PUBLISH data, REGISTER/SUBSCRIBE topic
+ * name, CONNECT client id, the frame encapsulated by a Forward, ...). Entries flagged in errors
+ * are left unspecified.
+ */
+struct ParsedBatch {
+    vector<MessageType> types;
+    vector<uint32_t> offsets;       // offset of the first byte after the type field
+    vector<uint16_t> topic_ids;
+    vector<uint16_t> message_ids;
+    vector<ByteView> payloads;
+    vector<uint64_t> errors;        // bit i set when datagram i is malformed
+
+    size_t size() const {
+        return types.size();
+    }
+
+    bool ok(size_t index) const {
+        return (errors[index / 64] & (uint64_t(1) << (index % 64))) == 0;
+    }
+
+    void resize(size_t count) {
+        types.resize(count);
+        offsets.resize(count);
+        topic_ids.resize(count);
+        message_ids.resize(count);
+        payloads.resize(count);
+        errors.assign((count + 63) / 64, 0);
+    }
+};
+
+/**
+ * @brief Decodes the header and routing fields of @p count datagrams into @p batch.
+ *
+ * Nothing is copied; payload views reference the datagrams. The vectors in @p batch are
+ * reused across calls, so steady-state batches do not allocate.
+ *
+ * @return The number of datagrams that parsed successfully.
+ */
+size_t parse_batch(const Datagram* datagrams, size_t count, ParsedBatch& batch);
+
+/**
+ * @brief Appends @p message to @p buffer; writes nothing if encoded_size() is nullopt.
+ */
 void encode(const Message& message, BufferWriter& buffer);
 
+/**
+ * @brief Exact number of bytes encode() writes for @p message, or nullopt if its length exceeds
+ * MAX_FRAME_LENGTH.
+ *
+ * Not constexpr: it walks std::string and std::vector fields, which are not literal types in
+ * C++17. frame_length() is the constexpr part, for sizes known at compile time.
+ */
+optional<size_t> encoded_size(const Message& message);
+
+/***
+ * Overloads for messages using another allocator, instantiated for std::pmr::polymorphic_allocator.
+ */
+template<template<typename> class Allocator>
+void encode(const BasicMessage<Allocator>& message, BufferWriter& buffer);
+
+template<template<typename> class Allocator>
+optional<size_t> encoded_size(const BasicMessage<Allocator>& message);
+
+template<template<typename> class Allocator>
+optional<size_t> encode_into(const BasicMessage<Allocator>& message, uint8_t* dst, size_t capacity);
+
+/**
+ * @brief Encodes @p message straight into @p dst in a single pass.
+ *
+ * @return The number of bytes written, or nullopt if @p capacity is too small or the frame is
+ *         longer than MAX_FRAME_LENGTH, in which case nothing is written.
+ */
+optional<size_t> encode_into(const Message& message, uint8_t* dst, size_t capacity);
+
+/***
+ * Scatter-gather encoding. A frame is split into a header, i.e. the length and type fields and
+ * every field before the payload, and the payload itself: the trailing string or byte field
+ * (e.g. PUBLISH data), or the frame encapsulated by a Forward. The payload is not copied;
+ * encoded_payload() returns it so that it can be sent as a separate iovec after the header.
+ * Messages without a payload are all header.
+ *
+ * The MessageView overloads let a Forward wrap a frame that is already encoded, e.g.
+ * ForwardView {ctrl, gateway_addr, ByteView(frame, size)}, by writing only the Forward header.
+ */
+template<template<typename> class Allocator>
+size_t header_size(const BasicMessage<Allocator>& message);
+
+template<template<typename> class Allocator>
+size_t encode_header(const BasicMessage<Allocator>& message, uint8_t* hdr);
+
+template<template<typename> class Allocator>
+ByteView encoded_payload(const BasicMessage<Allocator>& message);
+
+/**
+ * @brief Number of bytes encode_header() writes for @p message.
+ */
+size_t header_size(const Message& message);
+size_t header_size(const MessageView& message);
+
+/**
+ * @brief Writes the header of @p message to @p hdr, which must hold header_size() bytes.
+ *
+ * The length field accounts for the payload, so the header followed by encoded_payload()
+ * is byte for byte what encode() produces.
+ *
+ * @return The number of bytes written, or 0 if the frame is longer than MAX_FRAME_LENGTH, in
+ *         which case nothing is written.
+ */
+size_t encode_header(const Message& message, uint8_t* hdr);
+size_t encode_header(const MessageView& message, uint8_t* hdr);
+
+/**
+ * @brief The bytes that follow the header of @p message; empty if it has no payload.
+ * They reference @p message, which must outlive their use.
+ */
+ByteView encoded_payload(const Message& message);
+ByteView encoded_payload(const MessageView& message);
+
 }
 }
\ No newline at end of file
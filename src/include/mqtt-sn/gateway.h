@@ -0,0 +1,237 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+#include <mqtt-sn/keep_alive.h>
+#include <mqtt-sn/sleep_buffer.h>
+#include <mqtt-sn/spsc_ring.h>
+#include <mqtt-sn/subscription_index.h>
+#include <mqtt-sn/topic_registry.h>
+#include <mqtt-sn/udp_engine.h>
+
+namespace mqtt_sn::gateway {
+
+using net::Endpoint;
+using net::UdpEngine;
+
+struct Config {
+    Endpoint address;
+    size_t shards = 0;                  // 0 for one per hardware thread
+    bool pin_threads = true;            // pin shard i to CPU i
+    size_t ring_capacity = 32 * 1024;   // bytes of publications queued from one shard to another
+    UdpEngine::Config engine;           // reuse_port is always set
+    KeepAlive::Config keep_alive;       // ticks are milliseconds
+    SleepBuffer::Config sleep_buffer;   // deliveries held for each sleeping client
+    uint16_t idle_duration = 3600;      // seconds a client that connects without keep-alive may stay silent
+    size_t max_session_topics = 1024;   // topic ids a session may hold before its REGISTERs are refused
+    uint32_t poll_interval_ms = 10;     // longest a shard waits for datagrams before servicing rings and timers
+    uint32_t idle_polls = 64;           // empty turns a shard thread spins through before it waits
+};
+
+/**
+ * @brief One core's share of the gateway.
+ *
+ * A shard owns a SO_REUSEPORT socket on the gateway address, and with it every client the kernel
+ * steers to that socket, along with their sessions, the topic ids registered with them, their
+ * subscriptions and keep-alive timers. Nothing is shared with other shards: a PUBLISH is
+ * delivered to local subscribers directly and passed to every other shard through an SPSC ring,
+ * which that shard drains on its own thread. A publication travels by topic name, since topic ids
+ * are per shard, as one record copied into the ring; a ring takes its ring_capacity bytes when
+ * the first publication crosses it, so N shards hold at most N(N-1) of them.
+ *
+ * Clients behind a forwarder (Forward encapsulation) get a session per wireless node id, and
+ * are answered through the same forwarder.
+ *
+ * A client that connects with a keep-alive duration of 0 is held to idle_duration instead, so
+ * that its session still goes away once it falls silent.
+ *
+ * Deliveries go out at QoS 0. Those to a sleeping client are held in its SleepBuffer and sent
+ * when it checks in with a PINGREQ carrying its client id, ahead of the PINGRESP, or reconnects.
+ * A PINGREQ carrying another client's id is dropped. An incoming QoS 2 PUBLISH is delivered on
+ * receipt and its PUBREC/PUBREL/PUBCOMP exchange is acknowledged without further state. Wills and
+ * predefined topic ids are not supported.
+ *
+ * A topic id stays registered while a session holds it, whether the client registered it or was
+ * sent a REGISTER for it, and is released with the last such session. A REGISTER or SUBSCRIBE
+ * only takes a new id while the session holds fewer than max_session_topics; a REGISTER beyond
+ * that is answered with Congestion.
+ */
+class Shard {
+public:
+    struct Stats {
+        uint64_t malformed = 0;
+        uint64_t published = 0;         // PUBLISHes received from local clients
+        uint64_t delivered = 0;         // PUBLISHes sent to local subscribers
+        uint64_t buffered = 0;          // PUBLISHes held for sleeping subscribers
+        uint64_t forwarded = 0;         // publications passed to other shards
+        uint64_t dropped = 0;           // publications not passed because a ring was full
+        uint64_t receive_errors = 0;    // turns cut short because receiving failed
+    };
+
+    /**
+     * @param now Start of the millisecond clock later passed to poll().
+     */
+    Shard(size_t index, const Config& config, uint32_t now = 0);
+    ~Shard();
+
+    Shard(const Shard&) = delete;
+    Shard& operator=(const Shard&) = delete;
+
+    /**
+     * @brief Binds this shard's socket to @p address, along with the other shards'.
+     */
+    bool open(const Endpoint& address);
+
+    /**
+     * @brief Creates the ring carrying publications from this shard to @p peer, of @p capacity
+     * bytes or enough for the largest publication, whichever is more. Must be called before any
+     * shard runs.
+     */
+    void link(Shard& peer, size_t capacity);
+
+    /**
+     * @brief One turn of the shard loop: handles a batch of datagrams (waiting for one at most
+     * poll_interval_ms if @p wait is set), drains the rings from other shards, fires the
+     * keep-alive timers due up to @p now (in milliseconds) and sends the replies.
+     *
+     * @return The number of datagrams and publications handled, or -1 with errno set if
+     *         receiving failed, in which case the rest of the turn is skipped.
+     */
+    int poll(uint32_t now, bool wait = true);
+
+    size_t index() const {
+        return _index;
+    }
+
+    size_t sessions() const {
+        return _by_address.size();
+    }
+
+    const Stats& stats() const {
+        return _stats;
+    }
+
+    const UdpEngine& engine() const {
+        return _engine;
+    }
+
+private:
+    struct Session {
+        Endpoint endpoint;
+        std::string key;                        // endpoint and wireless node id, see find()
+        vector<uint8_t> node;                   // wireless node id when behind a forwarder
+        std::string client_id;
+        vector<std::string> filters;
+        std::unordered_set<uint16_t> topics;    // topic ids the client knows
+        SleepBuffer sleep_buffer {SleepBuffer::Config {}};
+        uint16_t next_message_id = 1;
+        bool active = false;
+    };
+
+    void handle(ByteView frame, const Endpoint& from, ByteView node);
+    void handle(const ConnectView& message, const Endpoint& from, ByteView node);
+    void handle(const RegisterTopicView& message, Session& session);
+    void handle(const PublishMessageView& message, ClientId client);
+    void handle(const SubscribeView& message, ClientId client);
+    void handle(const UnsubscribeView& message, ClientId client);
+    void handle(const Disconnect& message, ClientId client);
+
+    Session* find(const Endpoint& from, ByteView node, ClientId& client);
+    void remove(ClientId client);
+    optional<uint16_t> acquire_topic(Session& session, std::string_view name);
+    bool hold_topic(Session& session, uint16_t topic_id);
+    void release_topics(Session& session);
+    void deliver(std::string_view topic, MessageFlags flags, ByteView payload);
+    void wake(Session& session);
+    void send(Session& session, const Message& message);
+    void send(Session& session, ByteView frame);
+    void send(const Endpoint& to, ByteView node, const Message& message);
+    void send(const Endpoint& to, ByteView node, ByteView frame);
+    uint8_t* wrap_buffer(ByteView node, size_t size);
+    void send_wrapped(const Endpoint& to, ByteView node, size_t size);
+
+    size_t _index;
+    Config _config;
+    UdpEngine _engine;
+    uint32_t _now = 0;
+
+    vector<Session> _sessions;                                  // by ClientId
+    vector<ClientId> _free_sessions;
+    std::unordered_map<std::string, ClientId> _by_address;
+    std::string _key;                                           // scratch key for lookups
+
+    TopicRegistry _topics;
+    vector<uint32_t> _topic_holders;                            // by topic id: sessions holding it
+    SubscriptionIndex _subscriptions;
+    KeepAlive _keep_alive;
+
+    vector<std::unique_ptr<SpscByteRing>> _outbound;            // to the other shards
+    vector<SpscByteRing*> _inbound;                             // from the other shards
+
+    vector<SubscriberId> _matched;
+    vector<uint8_t> _frame;
+    vector<uint8_t> _wrapped;                                   // frames to forwarders, in a Forward
+    Stats _stats;
+};
+
+/**
+ * @brief Sharded MQTT-SN gateway: one Shard per core, each run by its own thread.
+ */
+class Gateway {
+public:
+    explicit Gateway(const Config& config);
+    ~Gateway();
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    /**
+     * @brief Binds every shard to the gateway address.
+     *
+     * @return false on failure, with errno set.
+     */
+    bool open();
+
+    /**
+     * @brief Starts one thread per shard.
+     *
+     * A thread whose shard fails to receive retries right away if the wait was interrupted, and
+     * otherwise after poll_interval_ms, so that a failing socket does not spin a core.
+     */
+    void start();
+
+    /**
+     * @brief Stops and joins the shard threads, within about poll_interval_ms.
+     */
+    void stop();
+
+    size_t shard_count() const {
+        return _shards.size();
+    }
+
+    Shard& shard(size_t index) {
+        return *_shards[index];
+    }
+
+    /**
+     * @brief Milliseconds on the clock the shard threads pass to Shard::poll().
+     */
+    static uint32_t now();
+
+private:
+    Config _config;
+    vector<std::unique_ptr<Shard>> _shards;
+    vector<std::thread> _threads;
+    std::atomic<bool> _running {false};
+};
+
+}
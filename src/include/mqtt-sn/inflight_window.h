@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn {
+
+/**
+ * @brief Tracks the QoS 1 and QoS 2 PUBLISHes a client or gateway has sent and not yet seen
+ * acknowledged, and schedules their retransmission.
+ *
+ * Entries live in a fixed ring of slots indexed by message_id & (capacity - 1), so with message
+ * ids allocated sequentially up to capacity messages are in flight without collisions. Each slot
+ * keeps the encoded frame: a retransmit resends those bytes, with only the DUP flag set.
+ *
+ * Time is counted in caller-defined ticks (e.g. milliseconds), which may wrap around.
+ */
+class InflightWindow {
+public:
+    struct Config {
+        size_t capacity = 64;               // slots; rounded up to a power of two
+        size_t max_frame_size = 256;        // bytes reserved per slot; at most MAX_FRAME_LENGTH
+        uint32_t retry_interval = 1000;     // ticks between retransmits; 0 is the next tick
+        uint8_t max_retries = 3;            // retransmits before a message is given up
+    };
+
+    enum class State : uint8_t {
+        Free,
+        AwaitAck,          // QoS 1 PUBLISH sent, waiting for PUBACK
+        AwaitReceived,     // QoS 2 PUBLISH sent, waiting for PUBREC
+        AwaitComplete      // PUBREL sent, waiting for PUBCOMP
+    };
+
+    enum class Event : uint8_t {
+        Retransmit,     // resend the frame
+        Expired         // max_retries reached; the message was dropped
+    };
+
+    /**
+     * @brief A max_frame_size above format::MAX_FRAME_LENGTH, which no frame can reach, is a
+     * programming error; release builds clamp it.
+     */
+    explicit InflightWindow(const Config& config);
+
+    /**
+     * @brief Starts tracking @p message and returns its encoded frame, ready to send.
+     *
+     * @return nullopt if the QoS is not 1 or 2, the frame is larger than max_frame_size, or the
+     *         slot for its message id is taken.
+     */
+    optional<ByteView> publish(const PublishMessage& message, uint32_t now);
+
+    /**
+     * @brief Completes a QoS 1 PUBLISH.
+     *
+     * @return false if no PUBLISH with that message id awaits a PUBACK.
+     */
+    bool on_ack(const PublishMessageAck& message);
+
+    /**
+     * @brief Moves a QoS 2 PUBLISH on to the PUBREL stage and returns the PUBREL frame to send.
+     * A PUBREC for a PUBREL already sent returns the PUBREL again.
+     */
+    optional<ByteView> on_received(const PublishMessageReceived& message, uint32_t now);
+
+    /**
+     * @brief Completes a QoS 2 PUBLISH.
+     *
+     * @return false if no PUBREL with that message id awaits a PUBCOMP.
+     */
+    bool on_complete(const PublishMessageComplete& message);
+
+    /**
+     * @brief Processes the deadlines up to @p now, calling
+     * @p on_event(Event, uint16_t message_id, ByteView frame) for each message due.
+     *
+     * Messages due for retransmission have DUP set and are rescheduled; expired ones are
+     * released before their callback returns, so the frame is only valid during the call.
+     * @p on_event must not modify the window.
+     *
+     * @return The number of events.
+     */
+    template<typename Visitor>
+    size_t poll(uint32_t now, Visitor&& on_event);
+
+    State state(uint16_t message_id) const;
+
+    /**
+     * @brief The stored frame of @p message_id, empty if it is not in flight.
+     */
+    ByteView frame(uint16_t message_id) const;
+
+    size_t size() const {
+        return _size;
+    }
+
+    size_t capacity() const {
+        return _slots.size();
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr size_t WHEEL_SIZE = 256;
+
+    struct Slot {
+        uint16_t message_id = 0;
+        State state = State::Free;
+        uint8_t retries = 0;
+        uint16_t frame_size = 0;
+        uint32_t deadline = 0;
+        uint32_t next = NIL;
+        uint32_t prev = NIL;
+    };
+
+    Slot* find(uint16_t message_id, State state);
+    uint8_t* frame_data(uint32_t index);
+    void schedule(uint32_t index, uint32_t now);
+    void unschedule(uint32_t index);
+    void release(uint32_t index);
+
+    Config _config;
+    std::vector<Slot> _slots;
+    std::vector<uint8_t> _frames;
+    std::vector<uint32_t> _wheel;       // head slot of each bucket, by deadline % WHEEL_SIZE
+    uint32_t _polled = 0;               // first tick not yet processed by poll()
+    bool _started = false;              // _polled is set, by the first schedule() or poll()
+    size_t _size = 0;
+};
+
+template<typename Visitor>
+size_t InflightWindow::poll(uint32_t now, Visitor&& on_event) {
+    if (!_started) {
+        _polled = now;
+        _started = true;
+    }
+
+    size_t events = 0;
+    // Past a full turn every bucket has been visited; the deadline check below does the rest.
+    uint32_t ticks = static_cast<int32_t>(now - _polled) < 0 ? 0 : now - _polled + 1;
+    if (ticks > WHEEL_SIZE) {
+        ticks = WHEEL_SIZE;
+    }
+
+    for (uint32_t i = 0; i < ticks; ++i) {
+        auto bucket = (_polled + i) % WHEEL_SIZE;
+        for (auto index = _wheel[bucket]; index != NIL;) {
+            auto& slot = _slots[index];
+            auto next = slot.next;
+            if (static_cast<int32_t>(slot.deadline - now) <= 0) {
+                ++events;
+                if (slot.retries >= _config.max_retries) {
+                    auto message_id = slot.message_id;
+                    auto frame = ByteView(frame_data(index), slot.frame_size);
+                    release(index);
+                    on_event(Event::Expired, message_id, frame);
+                } else {
+                    ++slot.retries;
+                    if (slot.state != State::AwaitComplete) {
+                        // PUBLISH flags follow the length and type fields.
+                        auto data = frame_data(index);
+                        auto flags_at = data[0] == 1 ? 4 : 2;
+                        MessageFlags flags {};
+                        flags.value = data[flags_at];
+                        flags.dup = 1;
+                        data[flags_at] = flags.value;
+                    }
+                    schedule(index, now);
+                    on_event(Event::Retransmit, slot.message_id, ByteView(frame_data(index), slot.frame_size));
+                }
+            }
+            index = next;
+        }
+    }
+    _polled = now + 1;
+    return events;
+}
+
+}
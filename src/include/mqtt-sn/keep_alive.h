@@ -0,0 +1,112 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+#include <mqtt-sn/timer_wheel.h>
+
+namespace mqtt_sn {
+
+using ClientId = uint32_t;
+
+/**
+ * @brief Keep-alive and sleep deadlines of connected clients, driven by the frames they send.
+ *
+ * CONNECT starts the keep-alive timer from its duration; any later frame from the client pushes
+ * the deadline out again with a single timer re-arm. DISCONNECT with a duration puts the client
+ * to sleep for that long, and without one stops tracking it. A client is reported once its
+ * deadline passes, after which it is no longer tracked.
+ *
+ * Client ids are small dense integers chosen by the caller, e.g. session slots. The client id a
+ * client connected with is kept as well, so that a PINGREQ naming it finds the client whichever
+ * address it arrives from.
+ */
+class KeepAlive {
+public:
+    struct Config {
+        uint32_t ticks_per_second = 1000;
+        uint32_t tolerance_percent = 150;   // deadline, relative to the announced duration
+    };
+
+    enum class Expiry : uint8_t {
+        KeepAlive,      // an active client went silent
+        Sleep           // a sleeping client did not wake up in time
+    };
+
+    explicit KeepAlive(const Config& config, uint32_t now = 0);
+
+    void on_connect(ClientId client, const Connect& message, uint32_t now);
+    void on_connect(ClientId client, const ConnectView& message, uint32_t now);
+    void on_disconnect(ClientId client, const Disconnect& message, uint32_t now);
+
+    /**
+     * @brief A PINGREQ received from @p client. One carrying a client id is matched to the client
+     * that connected with it, if any, instead: a sleeping client checking in restarts its sleep
+     * period, whichever address it sends from. Otherwise this is the same as any other frame.
+     *
+     * @return The client the ping was matched to, or nullopt if it is not tracked.
+     */
+    optional<ClientId> on_ping(ClientId client, const PingRequest& message, uint32_t now);
+    optional<ClientId> on_ping(ClientId client, const PingRequestView& message, uint32_t now);
+
+    /**
+     * @brief Any frame received from @p client.
+     */
+    void on_message(ClientId client, uint32_t now);
+
+    void remove(ClientId client);
+
+    bool tracked(ClientId client) const;
+    bool asleep(ClientId client) const;
+
+    /**
+     * @brief Reports the clients whose deadline passed up to @p now through
+     * @p on_expired(ClientId, Expiry).
+     *
+     * @return The number of clients reported.
+     */
+    template<typename Visitor>
+    size_t advance(uint32_t now, Visitor&& on_expired);
+
+    size_t size() const {
+        return _wheel.size();
+    }
+
+private:
+    static constexpr TimerWheel::TimerId NONE = UINT32_MAX;
+
+    struct Client {
+        TimerWheel::TimerId timer = NONE;
+        uint32_t period = 0;
+        bool asleep = false;
+        std::string client_id;
+    };
+
+    void start(ClientId client, uint16_t duration, bool asleep, uint32_t now);
+    void name(ClientId client, std::string_view client_id);
+    optional<ClientId> ping(ClientId client, optional<std::string_view> client_id, uint32_t now);
+    void forget(ClientId client);
+
+    Config _config;
+    std::vector<Client> _clients;
+    std::unordered_map<std::string, ClientId> _by_client_id;
+    std::string _key;                       // scratch key for lookups
+    TimerWheel _wheel;
+};
+
+template<typename Visitor>
+size_t KeepAlive::advance(uint32_t now, Visitor&& on_expired) {
+    return _wheel.advance(now, [&](TimerWheel::TimerId, uint64_t data) {
+        auto client = static_cast<ClientId>(data);
+        auto expiry = _clients[client].asleep ? Expiry::Sleep : Expiry::KeepAlive;
+        forget(client);
+        on_expired(client, expiry);
+    });
+}
+
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn {
+
+/**
+ * @brief Frames queued for a sleeping client until it wakes up.
+ *
+ * Messages are stored encoded, back to back in a single byte slab used as a ring. As MQTT-SN
+ * frames carry their own length, nothing else is stored per frame, and each frame is contiguous
+ * so that it can be sent as is. The slab is allocated on the first push and kept until reset().
+ */
+class SleepBuffer {
+public:
+    enum class DropPolicy : uint8_t {
+        DropNewest,     // reject frames that do not fit
+        DropOldest      // discard the oldest frames until the new one fits
+    };
+
+    struct Config {
+        size_t capacity = 4096;     // bytes
+        DropPolicy policy = DropPolicy::DropOldest;
+    };
+
+    explicit SleepBuffer(const Config& config);
+
+    /**
+     * @brief Encodes @p message straight into the buffer.
+     *
+     * @return false if it was dropped.
+     */
+    bool push(const Message& message);
+
+    /**
+     * @brief Queues an already encoded frame.
+     *
+     * @return false if @p frame is not exactly one complete frame, or if it was dropped.
+     */
+    bool push(ByteView frame);
+
+    /**
+     * @brief The oldest frame; empty if there is none.
+     */
+    ByteView front() const;
+
+    void pop();
+
+    /**
+     * @brief Hands every queued frame, oldest first, to @p send(ByteView frame) and empties the
+     * buffer. Frames stay valid until the buffer is next modified.
+     *
+     * @return The number of frames sent.
+     */
+    template<typename Visitor>
+    size_t drain(Visitor&& send);
+
+    /**
+     * @brief Empties the buffer and frees the slab.
+     */
+    void reset();
+
+    bool empty() const {
+        return _frames == 0;
+    }
+
+    /**
+     * @brief Number of queued frames.
+     */
+    size_t size() const {
+        return _frames;
+    }
+
+    /**
+     * @brief Number of bytes used by the queued frames.
+     */
+    size_t bytes() const {
+        return _bytes;
+    }
+
+    /**
+     * @brief Number of frames dropped since construction.
+     */
+    size_t dropped() const {
+        return _dropped;
+    }
+
+private:
+    uint8_t* reserve(size_t size);
+    bool fits(size_t size) const;
+
+    Config _config;
+    std::vector<uint8_t> _slab;
+    size_t _head = 0;       // first byte of the oldest frame
+    size_t _tail = 0;       // one past the newest frame
+    size_t _wrap = 0;       // end of the frames before _tail wrapped to the start, 0 if it has not
+    size_t _frames = 0;
+    size_t _bytes = 0;
+    size_t _dropped = 0;
+};
+
+template<typename Visitor>
+size_t SleepBuffer::drain(Visitor&& send) {
+    size_t sent = 0;
+    while (!empty()) {
+        send(front());
+        pop();
+        ++sent;
+    }
+    return sent;
+}
+
+}
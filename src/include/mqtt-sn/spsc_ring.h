@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+namespace mqtt_sn {
+
+/**
+ * @brief Bounded lock-free queue of variable-length byte records between one producer thread and
+ * one consumer thread.
+ *
+ * Records are written in place and read in place, so passing one costs a copy in and no
+ * allocation. Each record is stored contiguously behind a 4-byte length; one that does not fit
+ * before the end of the buffer starts over at its beginning. Records are limited to
+ * max_record() bytes, half the capacity less the length, so that one always fits in an empty
+ * ring wherever the last record ended. The buffer is allocated by the first try_reserve(), so a
+ * ring that is never written to costs no memory.
+ *
+ * Each side owns one index and only reads the other's, and caches it so that it only touches
+ * the shared cache line when the ring looks full or empty.
+ */
+class SpscByteRing {
+public:
+    /**
+     * @param capacity Bytes, rounded up to a power of two of at least 16. A record takes its size
+     *                 plus 4, rounded up to a multiple of 4.
+     */
+    explicit SpscByteRing(size_t capacity) {
+        size_t size = 16;
+        while (size < capacity) {
+            size <<= 1;
+        }
+        _mask = size - 1;
+    }
+
+    SpscByteRing(const SpscByteRing&) = delete;
+    SpscByteRing& operator=(const SpscByteRing&) = delete;
+
+    /**
+     * @brief Producer side: room for a record of @p size bytes, which is published by commit().
+     *
+     * @return nullptr if the ring is full, or @p size is over max_record().
+     */
+    uint8_t* try_reserve(size_t size) {
+        if (size > max_record()) {
+            return nullptr;
+        }
+        auto needed = footprint(size);
+        if (!_data) {
+            // Published to the consumer by the release store of the first commit().
+            _data.reset(new uint8_t[capacity()]);
+        }
+
+        auto tail = _tail.load(std::memory_order_relaxed);
+        auto offset = tail & _mask;
+        auto skipped = capacity() - offset < needed ? capacity() - offset : 0;
+        if (tail + skipped + needed - _cached_head > capacity()) {
+            _cached_head = _head.load(std::memory_order_acquire);
+            if (tail + skipped + needed - _cached_head > capacity()) {
+                return nullptr;
+            }
+        }
+
+        if (skipped != 0) {
+            store_length(offset, WRAP);
+            offset = 0;
+        }
+        store_length(offset, static_cast<uint32_t>(size));
+        _reserved = skipped + needed;
+        return _data.get() + offset + HEADER;
+    }
+
+    /**
+     * @brief Producer side: publishes the record from the last try_reserve().
+     */
+    void commit() {
+        _tail.store(_tail.load(std::memory_order_relaxed) + _reserved, std::memory_order_release);
+        _reserved = 0;
+    }
+
+    /**
+     * @brief Consumer side: the oldest record, which stays valid until pop().
+     *
+     * @return nullptr if the ring is empty.
+     */
+    const uint8_t* front(size_t& size) {
+        auto head = _head.load(std::memory_order_relaxed);
+        if (head == _cached_tail) {
+            _cached_tail = _tail.load(std::memory_order_acquire);
+            if (head == _cached_tail) {
+                return nullptr;
+            }
+        }
+
+        auto offset = head & _mask;
+        auto length = load_length(offset);
+        if (length == WRAP) {
+            _skipped = capacity() - offset;
+            offset = 0;
+            length = load_length(offset);
+        }
+        size = length;
+        _popped = _skipped + footprint(length);
+        return _data.get() + offset + HEADER;
+    }
+
+    /**
+     * @brief Consumer side: releases the record returned by front().
+     */
+    void pop() {
+        _head.store(_head.load(std::memory_order_relaxed) + _popped, std::memory_order_release);
+        _skipped = 0;
+        _popped = 0;
+    }
+
+    size_t capacity() const {
+        return _mask + 1;
+    }
+
+    /**
+     * @brief Largest record the ring takes.
+     */
+    size_t max_record() const {
+        return capacity() / 2 - HEADER;
+    }
+
+    /**
+     * @brief Smallest capacity whose max_record() is at least @p size.
+     */
+    static constexpr size_t capacity_for(size_t size) {
+        return 2 * footprint(size);
+    }
+
+    /**
+     * @brief Bytes in use, headers and padding included. Approximate when called while the other
+     * side is running.
+     */
+    size_t size() const {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr size_t CACHE_LINE = 64;
+    static constexpr size_t HEADER = sizeof(uint32_t);
+    static constexpr uint32_t WRAP = UINT32_MAX;        // length of the filler before a wrap
+
+    static constexpr size_t footprint(size_t size) {
+        return (HEADER + size + HEADER - 1) & ~(HEADER - 1);
+    }
+
+    void store_length(size_t offset, uint32_t length) {
+        std::memcpy(_data.get() + offset, &length, HEADER);
+    }
+
+    uint32_t load_length(size_t offset) const {
+        uint32_t length;
+        std::memcpy(&length, _data.get() + offset, HEADER);
+        return length;
+    }
+
+    std::unique_ptr<uint8_t[]> _data;
+    size_t _mask;
+
+    alignas(CACHE_LINE) std::atomic<size_t> _head {0};      // written by the consumer
+    size_t _cached_tail = 0;
+    size_t _skipped = 0;
+    size_t _popped = 0;
+    alignas(CACHE_LINE) std::atomic<size_t> _tail {0};      // written by the producer
+    size_t _cached_head = 0;
+    size_t _reserved = 0;
+};
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn::format::stats {
+
+/**
+ * @brief Whether the codec was built with MQTT_SN_FORMAT_ENABLE_STATS. Without it no counting
+ * code is compiled into parse() and encode(), and snapshot() is all zeros.
+ */
+#ifdef MQTT_SN_FORMAT_ENABLE_STATS
+constexpr bool enabled = true;
+#else
+constexpr bool enabled = false;
+#endif
+
+/**
+ * @brief Whether decode and encode times are sampled into the cycle histograms
+ * (MQTT_SN_FORMAT_ENABLE_CYCLE_STATS, on top of MQTT_SN_FORMAT_ENABLE_STATS).
+ */
+#if defined(MQTT_SN_FORMAT_ENABLE_STATS) && defined(MQTT_SN_FORMAT_ENABLE_CYCLE_STATS)
+constexpr bool cycles_enabled = true;
+#else
+constexpr bool cycles_enabled = false;
+#endif
+
+/**
+ * @brief Why a frame was rejected by the decoder; see ParseError.
+ */
+using Malformed = ParseError;
+using format::name;
+
+/**
+ * @brief Bucket i counts operations that took [2^i, 2^(i+1)) cycles; the last one is open-ended.
+ */
+constexpr size_t CYCLE_BUCKETS = 32;
+
+using CycleHistogram = std::array<uint64_t, CYCLE_BUCKETS>;
+
+struct TypeCounters {
+    uint64_t decoded = 0;
+    uint64_t decoded_bytes = 0;
+    uint64_t encoded = 0;
+    uint64_t encoded_bytes = 0;
+};
+
+/**
+ * @brief Codec counters summed over all threads. Counters only grow, so exporters report the
+ * difference between two snapshots.
+ */
+struct Snapshot {
+    std::array<TypeCounters, 256> types {};     // by MessageType value
+    std::array<uint64_t, PARSE_ERROR_COUNT> malformed {};
+    uint64_t long_decoded = 0;                  // frames with the 3-byte length field
+    uint64_t long_encoded = 0;
+    CycleHistogram decode_cycles {};
+    CycleHistogram encode_cycles {};
+
+    const TypeCounters& operator[](MessageType type) const {
+        return types[static_cast<size_t>(type)];
+    }
+
+    uint64_t malformed_count(Malformed reason) const {
+        return malformed[static_cast<size_t>(reason)];
+    }
+};
+
+/**
+ * @brief Collects the counters of every thread that used the codec, including exited ones.
+ *
+ * Each thread counts into its own block with plain (non-atomic read-modify-write) increments; a
+ * snapshot taken while other threads are decoding may miss their last few operations.
+ */
+Snapshot snapshot();
+
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+#include <mqtt-sn/topic_registry.h>
+
+namespace mqtt_sn {
+
+using SubscriberId = uint32_t;
+
+/**
+ * @brief Matches topics against the topic filters of many subscribers.
+ *
+ * Filters are stored in a trie with one node per '/'-separated level, so a match visits
+ * the levels of the topic rather than every filter. '+' matches exactly one level and '#'
+ * matches the rest of the topic, including none of it (a/# matches a). As in MQTT,
+ * wildcards at the first level do not match topics starting with '$'.
+ *
+ * Not synchronized: updates must not run concurrently with each other or with matches.
+ */
+class SubscriptionIndex {
+public:
+    SubscriptionIndex();
+    ~SubscriptionIndex();
+
+    SubscriptionIndex(const SubscriptionIndex&) = delete;
+    SubscriptionIndex& operator=(const SubscriptionIndex&) = delete;
+
+    /**
+     * @brief Adds @p filter for @p subscriber. Subscribing twice to the same filter has no effect.
+     *
+     * @return false if @p filter is not a valid topic filter.
+     */
+    bool subscribe(SubscriberId subscriber, std::string_view filter);
+
+    /**
+     * @brief Removes @p filter for @p subscriber.
+     *
+     * @return false if @p subscriber was not subscribed to @p filter.
+     */
+    bool unsubscribe(SubscriberId subscriber, std::string_view filter);
+
+    /***
+     * Decoded SUBSCRIBE and UNSUBSCRIBE messages. Topic names are used as filters, short topic
+     * names as their two characters, and topic ids are looked up in @p registry.
+     */
+    bool subscribe(SubscriberId subscriber, const Subscribe& message, const TopicRegistry& registry);
+    bool unsubscribe(SubscriberId subscriber, const Unsubscribe& message, const TopicRegistry& registry);
+
+    /**
+     * @brief Appends the subscribers whose filters match @p topic to @p subscribers.
+     *
+     * The appended ids are sorted and each appears once, however many of its filters match.
+     */
+    void match(std::string_view topic, std::vector<SubscriberId>& subscribers) const;
+
+    /**
+     * @brief As match(), for the topic registered under @p topic_id in @p registry.
+     */
+    void match(uint16_t topic_id, const TopicRegistry& registry, std::vector<SubscriberId>& subscribers) const;
+
+    /**
+     * @brief Number of (subscriber, filter) pairs.
+     */
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    struct Node;
+
+    static bool erase(Node& node, const std::string_view* levels, size_t count, SubscriberId subscriber);
+    static void collect(const Node& node, const std::string_view* levels, size_t count, bool root,
+                        std::vector<SubscriberId>& subscribers);
+
+    std::unique_ptr<Node> _root;
+    size_t _size = 0;
+};
+
+}
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace mqtt_sn {
+
+/**
+ * @brief Hashed hierarchical timer wheel: O(1) add, cancel and re-arm for large numbers of timers.
+ *
+ * Four levels of 256 buckets cover the whole 32-bit tick range. A timer sits in the level whose
+ * bucket width fits its distance to the current tick and is moved down a level when the level
+ * below wraps around, so every timer is touched at most once per level before it fires.
+ *
+ * Ticks are caller-defined (e.g. milliseconds) and may wrap around; deadlines must be less than
+ * 2^31 ticks ahead. Timers are referred to by id; ids of cancelled or fired timers are reused.
+ */
+class TimerWheel {
+public:
+    using TimerId = uint32_t;
+
+    explicit TimerWheel(uint32_t now = 0);
+
+    /**
+     * @brief Adds a timer firing at @p deadline, or at the next tick if that is already past.
+     * @p data is handed back when it fires.
+     */
+    TimerId add(uint32_t deadline, uint64_t data = 0);
+
+    /**
+     * @brief Moves an armed timer to @p deadline. Also keeps a timer that is firing, when called
+     * from the advance() callback.
+     */
+    void rearm(TimerId timer, uint32_t deadline);
+
+    /**
+     * @brief Stops @p timer and releases its id.
+     *
+     * @return false if it was not armed.
+     */
+    bool cancel(TimerId timer);
+
+    bool armed(TimerId timer) const;
+
+    uint32_t deadline(TimerId timer) const {
+        return _timers[timer].deadline;
+    }
+
+    /**
+     * @brief Fires every timer due up to and including @p now, calling
+     * @p on_expire(TimerId, uint64_t data) for each.
+     *
+     * A fired timer keeps its id until the callback returns: the callback may rearm() it to keep
+     * it, and it is released otherwise. The callback may add, re-arm and cancel other timers.
+     *
+     * @return The number of timers fired.
+     */
+    template<typename Visitor>
+    size_t advance(uint32_t now, Visitor&& on_expire);
+
+    /**
+     * @brief The first tick not processed by advance() yet.
+     */
+    uint32_t now() const {
+        return _now;
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    static constexpr uint32_t NIL = UINT32_MAX;
+    static constexpr size_t LEVELS = 4;
+    static constexpr size_t LEVEL_BITS = 8;
+    static constexpr size_t BUCKETS = size_t(1) << LEVEL_BITS;
+    static constexpr uint16_t EXPIRING = LEVELS * BUCKETS;     // list being fired by advance()
+    static constexpr uint16_t UNLINKED = EXPIRING + 1;
+
+    struct Timer {
+        uint32_t deadline = 0;
+        uint32_t next = NIL;
+        uint32_t prev = NIL;
+        uint16_t bucket = UNLINKED;
+        bool released = false;
+        uint64_t data = 0;
+    };
+
+    void link(TimerId timer);
+    void unlink(TimerId timer);
+    void release(TimerId timer);
+    void cascade(size_t level);
+
+    std::vector<Timer> _timers;
+    std::array<uint32_t, LEVELS * BUCKETS + 1> _buckets;    // heads, plus the EXPIRING list
+    uint32_t _free = NIL;
+    uint32_t _now;
+    size_t _size = 0;
+};
+
+template<typename Visitor>
+size_t TimerWheel::advance(uint32_t now, Visitor&& on_expire) {
+    size_t fired = 0;
+    while (static_cast<int32_t>(now - _now) >= 0) {
+        auto tick = _now;
+        for (size_t level = 1; level < LEVELS && (tick >> (LEVEL_BITS * (level - 1)) & (BUCKETS - 1)) == 0; ++level) {
+            cascade(level);
+        }
+
+        // Timers added or re-armed for this tick from here on go to the next one.
+        auto& bucket = _buckets[tick & (BUCKETS - 1)];
+        _buckets[EXPIRING] = bucket;
+        for (auto timer = bucket; timer != NIL; timer = _timers[timer].next) {
+            _timers[timer].bucket = EXPIRING;
+        }
+        bucket = NIL;
+        ++_now;
+
+        while (_buckets[EXPIRING] != NIL) {
+            auto timer = _buckets[EXPIRING];
+            unlink(timer);
+            ++fired;
+            on_expire(timer, _timers[timer].data);
+            if (_timers[timer].bucket == UNLINKED && !_timers[timer].released) {
+                release(timer);
+            }
+        }
+    }
+    return fired;
+}
+
+}
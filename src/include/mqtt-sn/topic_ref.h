@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn {
+
+/**
+ * @brief A topic as carried in PUBLISH, SUBSCRIBE and UNSUBSCRIBE: a registered topic id, a
+ * predefined topic id or a short topic name, packed with its TopicIdType into 4 bytes.
+ *
+ * Two refs name the same topic iff their key() is equal, so routing on them is a single integer
+ * compare and never needs the topic name.
+ */
+class TopicRef {
+public:
+    constexpr TopicRef() = default;
+    constexpr TopicRef(TopicIdType type, uint16_t value) : _key(uint32_t(type) << 16 | value) {}
+
+    static constexpr TopicRef registered(uint16_t topic_id) {
+        return TopicRef(TopicIdType::Normal, topic_id);
+    }
+
+    static constexpr TopicRef predefined(uint16_t topic_id) {
+        return TopicRef(TopicIdType::PreDefined, topic_id);
+    }
+
+    /**
+     * @brief The ref of a short topic name, or nullopt if @p name is not exactly two characters.
+     */
+    static constexpr optional<TopicRef> from_short_name(std::string_view name) {
+        if (name.size() != 2) {
+            return nullopt;
+        }
+        return TopicRef(TopicIdType::Short, uint16_t(uint8_t(name[0]) << 8 | uint8_t(name[1])));
+    }
+
+    constexpr TopicIdType type() const {
+        return static_cast<TopicIdType>(_key >> 16);
+    }
+
+    /**
+     * @brief The topic id, or the two characters of a short topic name, as sent on the wire.
+     */
+    constexpr uint16_t value() const {
+        return static_cast<uint16_t>(_key);
+    }
+
+    constexpr uint32_t key() const {
+        return _key;
+    }
+
+    /**
+     * @brief The two characters of a short topic name. Only meaningful when type() is Short.
+     */
+    constexpr std::array<char, 2> short_name() const {
+        return {static_cast<char>(value() >> 8), static_cast<char>(value() & 0xFF)};
+    }
+
+    friend constexpr bool operator==(TopicRef lhs, TopicRef rhs) {
+        return lhs._key == rhs._key;
+    }
+
+    friend constexpr bool operator!=(TopicRef lhs, TopicRef rhs) {
+        return lhs._key != rhs._key;
+    }
+
+    friend constexpr bool operator<(TopicRef lhs, TopicRef rhs) {
+        return lhs._key < rhs._key;
+    }
+
+private:
+    uint32_t _key = 0;
+};
+
+static_assert(sizeof(TopicRef) == 4 && std::is_trivially_copyable<TopicRef>::value);
+
+/**
+ * @brief The topic of a PUBLISH (or its view).
+ */
+template<typename T>
+constexpr auto topic_ref(const T& message) -> decltype(message.flags, message.topic_id, TopicRef()) {
+    return TopicRef(static_cast<TopicIdType>(message.flags.topic_id_type), message.topic_id);
+}
+
+/**
+ * @brief The topic of a SUBSCRIBE or UNSUBSCRIBE (or their views), or nullopt when it carries a
+ * topic name instead.
+ */
+template<typename T>
+constexpr auto topic_ref(const T& message) -> decltype(message.flags, std::get<uint16_t>(message.topic), optional<TopicRef>()) {
+    if (auto topic_id = std::get_if<uint16_t>(&message.topic)) {
+        return TopicRef(static_cast<TopicIdType>(message.flags.topic_id_type), *topic_id);
+    }
+    return nullopt;
+}
+
+/**
+ * @brief Immutable table of predefined topics, set up once at startup.
+ *
+ * Both gateway and clients must be configured with the same table, as predefined topic ids are
+ * used without prior registration.
+ */
+class PredefinedTopics {
+public:
+    struct Entry {
+        uint16_t topic_id;
+        std::string_view name;
+    };
+
+    PredefinedTopics() = default;
+
+    /***
+     * When an id or a name appears more than once, its first entry wins.
+     */
+    PredefinedTopics(std::initializer_list<Entry> entries);
+    PredefinedTopics(const Entry* entries, size_t count);
+
+    PredefinedTopics(const PredefinedTopics&) = delete;
+    PredefinedTopics& operator=(const PredefinedTopics&) = delete;
+
+    optional<std::string_view> name(uint16_t topic_id) const;
+    optional<std::string_view> name(TopicRef topic) const;
+    optional<TopicRef> find(std::string_view name) const;
+
+    size_t size() const {
+        return _ids.size();
+    }
+
+private:
+    vector<uint16_t> _ids;              // sorted
+    vector<std::string> _names;         // same order as _ids
+    std::unordered_map<std::string_view, uint16_t> _by_name;
+};
+
+}
+
+template<>
+struct std::hash<mqtt_sn::TopicRef> {
+    size_t operator()(mqtt_sn::TopicRef topic) const noexcept {
+        return std::hash<uint32_t> {}(topic.key());
+    }
+};
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn {
+
+/**
+ * @brief Maps topic names to topic ids and back.
+ *
+ * One registry can serve a single client or be shared by a whole gateway. Lookups in both
+ * directions are lock-free and may run concurrently with each other and with updates; updates
+ * are serialized by an internal mutex.
+ *
+ * Topic names are interned: each distinct name is stored once and kept until the registry is
+ * destroyed or compacted, so the string_views returned by name() stay valid even after the id is
+ * released. New ids come from a free-list of released ids first, then from the lowest id never
+ * used.
+ */
+class TopicRegistry {
+public:
+    /***
+     * 0x0000 and 0xFFFF are reserved topic ids.
+     */
+    static constexpr uint16_t MIN_TOPIC_ID = 0x0001;
+    static constexpr uint16_t MAX_TOPIC_ID = 0xFFFE;
+
+    TopicRegistry();
+    ~TopicRegistry();
+
+    TopicRegistry(const TopicRegistry&) = delete;
+    TopicRegistry& operator=(const TopicRegistry&) = delete;
+
+    /**
+     * @brief Returns the id of @p name, allocating one if it has none yet (gateway side of REGISTER
+     * and SUBSCRIBE).
+     *
+     * @return nullopt if @p name is empty or all ids are in use.
+     */
+    optional<uint16_t> register_topic(std::string_view name);
+
+    /**
+     * @brief Records an id chosen by the peer, e.g. from a REGACK or SUBACK (client side).
+     *
+     * Any previous mapping of @p topic_id or of @p name is replaced.
+     *
+     * @return false if @p topic_id is reserved or @p name is empty.
+     */
+    bool assign(uint16_t topic_id, std::string_view name);
+
+    /**
+     * @brief Releases @p topic_id so that it can be allocated again.
+     *
+     * @return false if it was not registered.
+     */
+    bool unregister(uint16_t topic_id);
+
+    /**
+     * @brief Topic name registered under @p topic_id. Lock-free.
+     */
+    optional<std::string_view> name(uint16_t topic_id) const;
+
+    /**
+     * @brief Topic id registered for @p name. Lock-free.
+     */
+    optional<uint16_t> find(std::string_view name) const;
+
+    /**
+     * @brief Number of registered ids.
+     */
+    size_t size() const;
+
+    /**
+     * @brief Number of interned names, including those whose id was released.
+     */
+    size_t interned() const;
+
+    /**
+     * @brief Frees the names whose id was released, and the tables replaced while growing.
+     *
+     * Unlike every other member this must not run concurrently with lookups, and it invalidates
+     * every string_view returned by name(), including those of names that keep their id.
+     */
+    void compact();
+
+private:
+    struct Name {
+        Name(std::string_view value, size_t hash) : value(value), hash(hash) {}
+
+        const std::string value;
+        const size_t hash;
+        std::atomic<uint16_t> id {0};
+    };
+
+    /***
+     * Open-addressed set of interned names. Slots are only ever filled, never cleared, so a
+     * reader probing it needs no lock. It is replaced by a larger copy when half full; replaced
+     * tables are kept alive for readers that may still be probing them.
+     */
+    struct Table {
+        explicit Table(size_t capacity);
+
+        const size_t mask;
+        std::unique_ptr<std::atomic<Name*>[]> slots;
+    };
+
+    /***
+     * id -> name, as 256 lazily allocated pages of 256 entries each.
+     */
+    using Page = std::array<std::atomic<Name*>, 256>;
+
+    Name* intern(std::string_view name);
+    std::atomic<Name*>& slot(uint16_t topic_id);
+    void bind(uint16_t topic_id, Name* name);
+    void release(uint16_t topic_id);
+    optional<uint16_t> allocate_id();
+
+    std::array<std::atomic<Page*>, 256> _pages {};
+    std::atomic<Table*> _table;
+
+    mutable std::mutex _mutex;
+    std::deque<Name> _names;
+    std::vector<std::unique_ptr<Table>> _tables;
+    std::vector<std::unique_ptr<Page>> _page_storage;
+    std::vector<uint16_t> _free_ids;
+    uint32_t _next_id = MIN_TOPIC_ID;
+    std::atomic<size_t> _size {0};
+};
+
+}
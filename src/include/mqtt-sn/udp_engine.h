@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <sys/socket.h>
+
+#include <mqtt-sn/format.h>
+
+struct io_uring_cqe;
+struct io_uring_sqe;
+
+namespace mqtt_sn::net {
+
+class IoUring;
+
+/**
+ * @brief A UDP peer address.
+ */
+struct Endpoint {
+    sockaddr_storage address {};
+    socklen_t length = 0;
+
+    static Endpoint ipv4(uint32_t host, uint16_t port);
+
+    const sockaddr* data() const {
+        return reinterpret_cast<const sockaddr*>(&address);
+    }
+};
+
+/**
+ * @brief Single-threaded, batched UDP I/O around the codec.
+ *
+ * Datagrams are received straight into buffers allocated once per engine, up to batch_size at a
+ * time, and exposed as format::Datagram for parse_batch() or as BufferReaders for parse(), with
+ * no copy. Outgoing messages are encoded into preallocated send buffers and sent together by
+ * flush(). Either way a whole batch costs one syscall: recvmmsg()/sendmmsg(), or io_uring_enter()
+ * with the io_uring backend, which keeps a receive posted for every buffer.
+ *
+ * Not thread-safe. With reuse_port, engines bound to the same address each get their own socket
+ * and the kernel spreads peers over them by address, one engine per thread.
+ */
+class UdpEngine {
+public:
+    enum class Backend : uint8_t {
+        Mmsg,
+        IoUring     // falls back to Mmsg where the kernel or build lacks io_uring
+    };
+
+    struct Config {
+        size_t batch_size = 64;
+        size_t buffer_size = 1500;      // largest datagram received or sent
+        Backend backend = Backend::Mmsg;
+        bool reuse_port = false;            // SO_REUSEPORT: one engine per thread on the same address
+        uint32_t receive_timeout_ms = 0;    // longest a waiting receive() blocks; 0 for no limit
+    };
+
+    struct Stats {
+        uint64_t syscalls = 0;
+        uint64_t received = 0;
+        uint64_t sent = 0;
+        uint64_t truncated = 0;     // datagrams longer than buffer_size, dropped on receipt
+        uint64_t send_errors = 0;   // datagrams the kernel refused for their destination
+    };
+
+    explicit UdpEngine(const Config& config);
+    ~UdpEngine();
+
+    UdpEngine(const UdpEngine&) = delete;
+    UdpEngine& operator=(const UdpEngine&) = delete;
+
+    /**
+     * @brief Creates the socket and binds it to @p address.
+     *
+     * @return false on failure, with errno set.
+     */
+    bool open(const Endpoint& address);
+
+    void close();
+
+    int fd() const {
+        return _fd;
+    }
+
+    Backend backend() const;
+
+    /**
+     * @brief The address the socket is bound to, e.g. to find the port picked for port 0.
+     */
+    Endpoint local_endpoint() const;
+
+    /**
+     * @brief Receives a batch of datagrams, replacing the previous one.
+     *
+     * Waits for at least one datagram if @p wait is set, up to receive_timeout_ms. Datagrams
+     * longer than buffer_size are dropped and counted in Stats::truncated.
+     *
+     * @return The number of datagrams received, or -1 with errno set.
+     */
+    int receive(bool wait = true);
+
+    size_t received() const {
+        return _datagrams.size();
+    }
+
+    /**
+     * @brief The datagrams of the last receive(); valid until the next one.
+     */
+    const format::Datagram* datagrams() const {
+        return _datagrams.data();
+    }
+
+    const Endpoint& source(size_t index) const {
+        return *_sources[index];
+    }
+
+    /**
+     * @brief Queues @p message for @p to, flushing first if the queue is full.
+     *
+     * @return false if it does not fit in buffer_size, or the flush failed.
+     */
+    bool send(const Message& message, const Endpoint& to);
+
+    /**
+     * @brief Queues a copy of an encoded frame.
+     */
+    bool send(ByteView frame, const Endpoint& to);
+
+    /**
+     * @brief Sends every queued datagram.
+     *
+     * A datagram refused for its destination alone (unreachable, refused, not permitted) is
+     * counted in Stats::send_errors and the rest of the batch still goes out.
+     *
+     * @return The number sent, or -1 with errno set if the socket failed. Datagrams not sent are
+     *         discarded.
+     */
+    int flush();
+
+    size_t pending() const {
+        return _pending;
+    }
+
+    const Stats& stats() const {
+        return _stats;
+    }
+
+private:
+    struct Slot;
+
+    uint8_t* next_send(const Endpoint& to, size_t size);
+    int receive_mmsg(bool wait);
+    int flush_mmsg();
+    int receive_ring(bool wait);
+    int flush_ring();
+    void collect_receive(const io_uring_cqe& cqe);
+    io_uring_sqe* next_sqe();
+    bool post_receive(uint32_t index);
+    void repost(uint32_t index);
+
+    Config _config;
+    int _fd = -1;
+    std::unique_ptr<IoUring> _ring;
+
+    std::vector<uint8_t> _buffers;              // receive buffers, then send buffers
+    std::vector<Slot> _receive_slots;
+    std::vector<Slot> _send_slots;
+    size_t _pending = 0;
+    std::vector<mmsghdr> _headers;              // mmsg: the batch handed to recvmmsg()/sendmmsg()
+
+    std::vector<format::Datagram> _datagrams;
+    std::vector<const Endpoint*> _sources;
+    std::vector<uint32_t> _consumed;            // io_uring: receive slots to post again
+    std::vector<uint32_t> _ready;               // io_uring: completed receive slots
+
+    Stats _stats;
+};
+
+}
@@ -0,0 +1,172 @@
+#include <mqtt-sn/inflight_window.h>
+
+#include <algorithm>
+
+namespace mqtt_sn {
+
+namespace {
+
+size_t round_up_to_power_of_two(size_t value) {
+    size_t result = 1;
+    while (result < value) {
+        result <<= 1;
+    }
+    return result;
+}
+
+}
+
+InflightWindow::InflightWindow(const Config& config)
+    : _config(config),
+      _slots(round_up_to_power_of_two(config.capacity)),
+      _wheel(WHEEL_SIZE, NIL) {
+    assert(_slots.size() <= 65536);
+    assert(config.max_frame_size <= format::MAX_FRAME_LENGTH);
+    // Slot frame sizes are 16 bits wide.
+    _config.max_frame_size = std::min(config.max_frame_size, format::MAX_FRAME_LENGTH);
+    _frames.resize(_slots.size() * _config.max_frame_size);
+}
+
+optional<ByteView> InflightWindow::publish(const PublishMessage& message, uint32_t now) {
+    if (message.flags.qos != 1 && message.flags.qos != 2) {
+        return nullopt;
+    }
+
+    uint32_t index = message.message_id & (_slots.size() - 1);
+    auto& slot = _slots[index];
+    if (slot.state != State::Free) {
+        return nullopt;
+    }
+
+    auto size = format::encode_into(message, frame_data(index), _config.max_frame_size);
+    if (!size) {
+        return nullopt;
+    }
+
+    slot.message_id = message.message_id;
+    slot.state = message.flags.qos == 1 ? State::AwaitAck : State::AwaitReceived;
+    slot.retries = 0;
+    slot.frame_size = static_cast<uint16_t>(size.value());
+    schedule(index, now);
+    ++_size;
+    return ByteView(frame_data(index), slot.frame_size);
+}
+
+bool InflightWindow::on_ack(const PublishMessageAck& message) {
+    auto slot = find(message.message_id, State::AwaitAck);
+    if (slot == nullptr) {
+        return false;
+    }
+
+    release(static_cast<uint32_t>(slot - _slots.data()));
+    return true;
+}
+
+optional<ByteView> InflightWindow::on_received(const PublishMessageReceived& message, uint32_t now) {
+    auto slot = find(message.message_id, State::AwaitReceived);
+    if (slot == nullptr) {
+        slot = find(message.message_id, State::AwaitComplete);
+        if (slot == nullptr) {
+            return nullopt;
+        }
+        return ByteView(frame_data(static_cast<uint32_t>(slot - _slots.data())), slot->frame_size);
+    }
+
+    auto index = static_cast<uint32_t>(slot - _slots.data());
+    auto size = format::encode_into(PublishMessageRelease {message.message_id}, frame_data(index), _config.max_frame_size);
+    assert(size.has_value());
+
+    slot->state = State::AwaitComplete;
+    slot->retries = 0;
+    slot->frame_size = static_cast<uint16_t>(size.value());
+    schedule(index, now);
+    return ByteView(frame_data(index), slot->frame_size);
+}
+
+bool InflightWindow::on_complete(const PublishMessageComplete& message) {
+    auto slot = find(message.message_id, State::AwaitComplete);
+    if (slot == nullptr) {
+        return false;
+    }
+
+    release(static_cast<uint32_t>(slot - _slots.data()));
+    return true;
+}
+
+InflightWindow::State InflightWindow::state(uint16_t message_id) const {
+    const auto& slot = _slots[message_id & (_slots.size() - 1)];
+    return slot.message_id == message_id ? slot.state : State::Free;
+}
+
+ByteView InflightWindow::frame(uint16_t message_id) const {
+    uint32_t index = message_id & (_slots.size() - 1);
+    const auto& slot = _slots[index];
+    if (slot.state == State::Free || slot.message_id != message_id) {
+        return {};
+    }
+    return ByteView(_frames.data() + index * _config.max_frame_size, slot.frame_size);
+}
+
+InflightWindow::Slot* InflightWindow::find(uint16_t message_id, State state) {
+    auto& slot = _slots[message_id & (_slots.size() - 1)];
+    if (slot.state != state || slot.message_id != message_id) {
+        return nullptr;
+    }
+    return &slot;
+}
+
+uint8_t* InflightWindow::frame_data(uint32_t index) {
+    return _frames.data() + index * _config.max_frame_size;
+}
+
+/***
+ * Moves the slot to the bucket of its next retransmit after @p now, unlinking it from its current
+ * bucket if any. A deadline poll() has already gone past, i.e. retry_interval 0 or a @p now
+ * behind the last poll(), would only be seen once the wheel came round again, so it is clamped
+ * to the next tick.
+ */
+void InflightWindow::schedule(uint32_t index, uint32_t now) {
+    unschedule(index);
+
+    if (!_started) {
+        _polled = now;
+        _started = true;
+    }
+    auto deadline = now + std::max<uint32_t>(_config.retry_interval, 1);
+    if (static_cast<int32_t>(deadline - _polled) < 0) {
+        deadline = _polled;
+    }
+
+    auto& slot = _slots[index];
+    auto& head = _wheel[deadline % WHEEL_SIZE];
+    slot.deadline = deadline;
+    slot.prev = NIL;
+    slot.next = head;
+    if (head != NIL) {
+        _slots[head].prev = index;
+    }
+    head = index;
+}
+
+void InflightWindow::unschedule(uint32_t index) {
+    auto& slot = _slots[index];
+    if (slot.prev != NIL) {
+        _slots[slot.prev].next = slot.next;
+    } else if (_wheel[slot.deadline % WHEEL_SIZE] == index) {
+        _wheel[slot.deadline % WHEEL_SIZE] = slot.next;
+    }
+    if (slot.next != NIL) {
+        _slots[slot.next].prev = slot.prev;
+    }
+    slot.next = NIL;
+    slot.prev = NIL;
+}
+
+void InflightWindow::release(uint32_t index) {
+    unschedule(index);
+    _slots[index].state = State::Free;
+    _slots[index].frame_size = 0;
+    --_size;
+}
+
+}
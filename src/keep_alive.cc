@@ -0,0 +1,129 @@
+#include <mqtt-sn/keep_alive.h>
+
+namespace mqtt_sn {
+
+KeepAlive::KeepAlive(const Config& config, uint32_t now) : _config(config), _wheel(now) {}
+
+void KeepAlive::on_connect(ClientId client, const Connect& message, uint32_t now) {
+    start(client, message.duration, false, now);
+    name(client, message.client_id);
+}
+
+void KeepAlive::on_connect(ClientId client, const ConnectView& message, uint32_t now) {
+    start(client, message.duration, false, now);
+    name(client, message.client_id);
+}
+
+void KeepAlive::on_disconnect(ClientId client, const Disconnect& message, uint32_t now) {
+    if (message.duration && message.duration.value() > 0) {
+        start(client, message.duration.value(), true, now);
+    } else {
+        remove(client);
+    }
+}
+
+optional<ClientId> KeepAlive::on_ping(ClientId client, const PingRequest& message, uint32_t now) {
+    return ping(client, message.client_id, now);
+}
+
+optional<ClientId> KeepAlive::on_ping(ClientId client, const PingRequestView& message, uint32_t now) {
+    return ping(client, message.client_id, now);
+}
+
+void KeepAlive::on_message(ClientId client, uint32_t now) {
+    if (!tracked(client)) {
+        return;
+    }
+
+    auto& state = _clients[client];
+    _wheel.rearm(state.timer, now + state.period);
+}
+
+void KeepAlive::remove(ClientId client) {
+    if (!tracked(client)) {
+        return;
+    }
+
+    _wheel.cancel(_clients[client].timer);
+    forget(client);
+}
+
+bool KeepAlive::tracked(ClientId client) const {
+    return client < _clients.size() && _clients[client].timer != NONE;
+}
+
+bool KeepAlive::asleep(ClientId client) const {
+    return tracked(client) && _clients[client].asleep;
+}
+
+/***
+ * (Re)starts the timer of @p client. A duration of 0 disables keep-alive.
+ */
+void KeepAlive::start(ClientId client, uint16_t duration, bool asleep, uint32_t now) {
+    if (duration == 0) {
+        remove(client);
+        return;
+    }
+
+    if (client >= _clients.size()) {
+        _clients.resize(client + 1);
+    }
+
+    auto& state = _clients[client];
+    state.period = static_cast<uint32_t>(uint64_t(duration) * _config.ticks_per_second * _config.tolerance_percent / 100);
+    state.asleep = asleep;
+    if (state.timer == NONE) {
+        state.timer = _wheel.add(now + state.period, client);
+    } else {
+        _wheel.rearm(state.timer, now + state.period);
+    }
+}
+
+/***
+ * Records the client id @p client connected with. A client id another slot was connected with is
+ * taken over: the latest CONNECT wins.
+ */
+void KeepAlive::name(ClientId client, std::string_view client_id) {
+    if (!tracked(client) || client_id.empty()) {
+        return;
+    }
+
+    auto& state = _clients[client];
+    if (state.client_id != client_id) {
+        if (auto it = _by_client_id.find(state.client_id); it != _by_client_id.end() && it->second == client) {
+            _by_client_id.erase(it);
+        }
+        state.client_id = client_id;
+    }
+    _by_client_id[state.client_id] = client;
+}
+
+optional<ClientId> KeepAlive::ping(ClientId client, optional<std::string_view> client_id, uint32_t now) {
+    if (client_id && !client_id->empty()) {
+        // unordered_map has no lookup by string_view before C++20; the scratch key keeps its
+        // capacity, so this does not allocate once it has seen the longest client id.
+        _key.assign(client_id->data(), client_id->size());
+        if (auto it = _by_client_id.find(_key); it != _by_client_id.end()) {
+            client = it->second;
+        }
+    }
+
+    if (!tracked(client)) {
+        return nullopt;
+    }
+    on_message(client, now);
+    return client;
+}
+
+/***
+ * Stops tracking @p client, whose timer has been cancelled or has fired.
+ */
+void KeepAlive::forget(ClientId client) {
+    auto& state = _clients[client];
+    if (auto it = _by_client_id.find(state.client_id); it != _by_client_id.end() && it->second == client) {
+        _by_client_id.erase(it);
+    }
+    state = Client {};
+}
+
+}
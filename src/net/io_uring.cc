@@ -0,0 +1,141 @@
+#ifdef MQTT_SN_NET_IO_URING
+
+#include "io_uring.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace mqtt_sn::net {
+
+namespace {
+
+int io_uring_setup(unsigned entries, io_uring_params* params) {
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int io_uring_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags, const void* arg, size_t arg_size) {
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, arg_size));
+}
+
+void* map(int fd, size_t size, off_t offset) {
+    auto ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+}
+
+template<typename T>
+T* at(void* base, unsigned offset) {
+    return reinterpret_cast<T*>(static_cast<uint8_t*>(base) + offset);
+}
+
+}
+
+IoUring::~IoUring() {
+    if (_sqes != nullptr) {
+        munmap(_sqes, _sqes_size);
+    }
+    if (_cq_ring != nullptr && _cq_ring != _sq_ring) {
+        munmap(_cq_ring, _cq_ring_size);
+    }
+    if (_sq_ring != nullptr) {
+        munmap(_sq_ring, _sq_ring_size);
+    }
+    if (_fd >= 0) {
+        ::close(_fd);
+    }
+}
+
+bool IoUring::setup(unsigned entries) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    _fd = io_uring_setup(entries, &params);
+    if (_fd < 0) {
+        return false;
+    }
+
+#ifdef IORING_FEAT_EXT_ARG
+    _ext_arg = (params.features & IORING_FEAT_EXT_ARG) != 0;
+#endif
+
+    _sq_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    _cq_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    if (params.features & IORING_FEAT_SINGLE_MMAP) {
+        _sq_ring_size = _cq_ring_size = std::max(_sq_ring_size, _cq_ring_size);
+    }
+
+    _sq_ring = map(_fd, _sq_ring_size, IORING_OFF_SQ_RING);
+    if (_sq_ring == nullptr) {
+        return false;
+    }
+    _cq_ring = (params.features & IORING_FEAT_SINGLE_MMAP) ? _sq_ring : map(_fd, _cq_ring_size, IORING_OFF_CQ_RING);
+    if (_cq_ring == nullptr) {
+        return false;
+    }
+    _sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    _sqes = static_cast<io_uring_sqe*>(map(_fd, _sqes_size, IORING_OFF_SQES));
+    if (_sqes == nullptr) {
+        return false;
+    }
+
+    _sq_head = at<unsigned>(_sq_ring, params.sq_off.head);
+    _sq_tail = at<unsigned>(_sq_ring, params.sq_off.tail);
+    _sq_mask = *at<unsigned>(_sq_ring, params.sq_off.ring_mask);
+    _sq_entries = params.sq_entries;
+    _sq_array = at<unsigned>(_sq_ring, params.sq_off.array);
+    _sq_local_tail = *_sq_tail;
+
+    _cq_head = at<unsigned>(_cq_ring, params.cq_off.head);
+    _cq_tail = at<unsigned>(_cq_ring, params.cq_off.tail);
+    _cq_mask = *at<unsigned>(_cq_ring, params.cq_off.ring_mask);
+    _cqes = at<io_uring_cqe>(_cq_ring, params.cq_off.cqes);
+    return true;
+}
+
+io_uring_sqe* IoUring::next_sqe() {
+    auto head = __atomic_load_n(_sq_head, __ATOMIC_ACQUIRE);
+    if (_sq_local_tail - head >= _sq_entries) {
+        return nullptr;
+    }
+
+    auto index = _sq_local_tail & _sq_mask;
+    auto sqe = &_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    _sq_array[index] = index;
+    ++_sq_local_tail;
+    return sqe;
+}
+
+int IoUring::submit(unsigned wait_nr, uint32_t timeout_ms) {
+    auto to_submit = _sq_local_tail - *_sq_tail;
+    __atomic_store_n(_sq_tail, _sq_local_tail, __ATOMIC_RELEASE);
+
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    const void* arg = nullptr;
+    size_t arg_size = 0;
+#ifdef IORING_FEAT_EXT_ARG
+    __kernel_timespec timeout {};
+    io_uring_getevents_arg events {};
+    if (wait_nr > 0 && timeout_ms > 0 && _ext_arg) {
+        timeout.tv_sec = timeout_ms / 1000;
+        timeout.tv_nsec = static_cast<long long>(timeout_ms % 1000) * 1000000;
+        events.ts = reinterpret_cast<uint64_t>(&timeout);
+        flags |= IORING_ENTER_EXT_ARG;
+        arg = &events;
+        arg_size = sizeof(events);
+    }
+#endif
+
+    int result;
+    do {
+        result = io_uring_enter(_fd, to_submit, wait_nr, flags, arg, arg_size);
+    } while (result < 0 && errno == EINTR);
+    return result;
+}
+
+}
+
+#endif
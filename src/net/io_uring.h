@@ -0,0 +1,90 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <linux/io_uring.h>
+
+namespace mqtt_sn::net {
+
+/***
+ * Minimal io_uring over the raw syscalls, so that no liburing is needed: one submission and one
+ * completion queue mapped from the kernel, with submit-and-wait in a single io_uring_enter().
+ */
+class IoUring {
+public:
+    IoUring() = default;
+    ~IoUring();
+
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    /**
+     * @brief Sets up a ring of at least @p entries submission entries.
+     *
+     * @return false if io_uring is unavailable, with errno set.
+     */
+    bool setup(unsigned entries);
+
+    /**
+     * @brief A zeroed submission entry, or nullptr if the submission queue is full.
+     */
+    io_uring_sqe* next_sqe();
+
+    /**
+     * @brief Submits the entries obtained since the last call and waits for @p wait_nr completions,
+     * or at most @p timeout_ms milliseconds if that is non-zero and timed_waits() is set.
+     *
+     * @return The number of entries submitted, or -1 with errno set (ETIME on timeout).
+     */
+    int submit(unsigned wait_nr, uint32_t timeout_ms = 0);
+
+    /**
+     * @brief Whether submit() supports a timeout (IORING_FEAT_EXT_ARG, Linux 5.11).
+     */
+    bool timed_waits() const {
+        return _ext_arg;
+    }
+
+    /**
+     * @brief Calls @p on_completion(const io_uring_cqe&) for each available completion.
+     */
+    template<typename Visitor>
+    unsigned reap(Visitor&& on_completion);
+
+private:
+    int _fd = -1;
+    bool _ext_arg = false;
+    void* _sq_ring = nullptr;
+    size_t _sq_ring_size = 0;
+    void* _cq_ring = nullptr;
+    size_t _cq_ring_size = 0;
+    io_uring_sqe* _sqes = nullptr;
+    size_t _sqes_size = 0;
+
+    unsigned* _sq_head = nullptr;
+    unsigned* _sq_tail = nullptr;
+    unsigned _sq_mask = 0;
+    unsigned _sq_entries = 0;
+    unsigned* _sq_array = nullptr;
+    unsigned _sq_local_tail = 0;
+
+    unsigned* _cq_head = nullptr;
+    unsigned* _cq_tail = nullptr;
+    unsigned _cq_mask = 0;
+    io_uring_cqe* _cqes = nullptr;
+};
+
+template<typename Visitor>
+unsigned IoUring::reap(Visitor&& on_completion) {
+    unsigned head = *_cq_head;
+    unsigned tail = __atomic_load_n(_cq_tail, __ATOMIC_ACQUIRE);
+    unsigned count = 0;
+    for (; head != tail; ++head, ++count) {
+        on_completion(_cqes[head & _cq_mask]);
+    }
+    __atomic_store_n(_cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
+
+}
@@ -0,0 +1,485 @@
+#include <mqtt-sn/udp_engine.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <netinet/in.h>
+#include <sys/time.h>
+#include <unistd.h>
+
+#ifdef MQTT_SN_NET_IO_URING
+#include "io_uring.h"
+#endif
+
+namespace mqtt_sn::net {
+
+#ifndef MQTT_SN_NET_IO_URING
+/***
+ * Without io_uring support the engine never creates a ring; this keeps unique_ptr<IoUring> complete.
+ */
+class IoUring {};
+#endif
+
+namespace {
+
+constexpr uint64_t SEND_TAG = uint64_t(1) << 32;
+
+/***
+ * Whether a send failed with @p error because of its destination alone, so that the datagrams
+ * queued behind it for other peers can still go out.
+ */
+bool destination_error(int error) {
+    switch (error) {
+    case EACCES:
+    case EPERM:
+    case ECONNREFUSED:
+    case EHOSTDOWN:
+    case EHOSTUNREACH:
+    case ENETUNREACH:
+    case EADDRNOTAVAIL:
+    case EAFNOSUPPORT:
+    case EINVAL:
+    case EMSGSIZE:
+        return true;
+    default:
+        return false;
+    }
+}
+
+}
+
+/***
+ * A datagram buffer with the headers that describe it to the kernel.
+ */
+struct UdpEngine::Slot {
+    Endpoint endpoint;
+    iovec iov {};
+    msghdr header {};
+    size_t size = 0;
+};
+
+Endpoint Endpoint::ipv4(uint32_t host, uint16_t port) {
+    Endpoint endpoint;
+    auto address = reinterpret_cast<sockaddr_in*>(&endpoint.address);
+    address->sin_family = AF_INET;
+    address->sin_addr.s_addr = htonl(host);
+    address->sin_port = htons(port);
+    endpoint.length = sizeof(sockaddr_in);
+    return endpoint;
+}
+
+UdpEngine::UdpEngine(const Config& config)
+    : _config(config),
+      _buffers(2 * config.batch_size * config.buffer_size),
+      _receive_slots(config.batch_size),
+      _send_slots(config.batch_size),
+      _headers(config.batch_size) {
+    _datagrams.reserve(config.batch_size);
+    _sources.reserve(config.batch_size);
+    _consumed.reserve(config.batch_size);
+    _ready.reserve(config.batch_size);
+
+    const auto prepare = [&](Slot& slot, uint8_t* buffer) {
+        slot.iov.iov_base = buffer;
+        slot.iov.iov_len = config.buffer_size;
+        slot.header.msg_name = &slot.endpoint.address;
+        slot.header.msg_namelen = sizeof(slot.endpoint.address);
+        slot.header.msg_iov = &slot.iov;
+        slot.header.msg_iovlen = 1;
+    };
+    for (size_t i = 0; i < config.batch_size; ++i) {
+        prepare(_receive_slots[i], _buffers.data() + i * config.buffer_size);
+        prepare(_send_slots[i], _buffers.data() + (config.batch_size + i) * config.buffer_size);
+    }
+}
+
+UdpEngine::~UdpEngine() {
+    close();
+}
+
+bool UdpEngine::open(const Endpoint& address) {
+    close();
+
+    _fd = ::socket(address.address.ss_family, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (_fd < 0) {
+        return false;
+    }
+    const int enable = 1;
+    if (_config.reuse_port && ::setsockopt(_fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable)) < 0) {
+        auto error = errno;
+        close();
+        errno = error;
+        return false;
+    }
+    if (_config.receive_timeout_ms > 0) {
+        timeval timeout {};
+        timeout.tv_sec = _config.receive_timeout_ms / 1000;
+        timeout.tv_usec = static_cast<suseconds_t>(_config.receive_timeout_ms % 1000) * 1000;
+        if (::setsockopt(_fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout)) < 0) {
+            auto error = errno;
+            close();
+            errno = error;
+            return false;
+        }
+    }
+    if (::bind(_fd, address.data(), address.length) < 0) {
+        auto error = errno;
+        close();
+        errno = error;
+        return false;
+    }
+
+#ifdef MQTT_SN_NET_IO_URING
+    if (_config.backend == Backend::IoUring) {
+        auto ring = std::make_unique<IoUring>();
+        if (ring->setup(static_cast<unsigned>(2 * _config.batch_size))
+            && (_config.receive_timeout_ms == 0 || ring->timed_waits())) {
+            _ring = std::move(ring);
+            for (uint32_t i = 0; i < _receive_slots.size(); ++i) {
+                _consumed.push_back(i);
+            }
+        }
+    }
+#endif
+    return true;
+}
+
+void UdpEngine::close() {
+    _ring.reset();
+    if (_fd >= 0) {
+        ::close(_fd);
+        _fd = -1;
+    }
+    _datagrams.clear();
+    _sources.clear();
+    _consumed.clear();
+    _ready.clear();
+    _pending = 0;
+}
+
+UdpEngine::Backend UdpEngine::backend() const {
+    return _ring ? Backend::IoUring : Backend::Mmsg;
+}
+
+Endpoint UdpEngine::local_endpoint() const {
+    Endpoint endpoint;
+    endpoint.length = sizeof(endpoint.address);
+    if (::getsockname(_fd, reinterpret_cast<sockaddr*>(&endpoint.address), &endpoint.length) < 0) {
+        return {};
+    }
+    return endpoint;
+}
+
+int UdpEngine::receive(bool wait) {
+    _datagrams.clear();
+    _sources.clear();
+    return _ring ? receive_ring(wait) : receive_mmsg(wait);
+}
+
+bool UdpEngine::send(const Message& message, const Endpoint& to) {
+    auto size = format::encoded_size(message);
+    if (!size) {
+        return false;
+    }
+
+    auto buffer = next_send(to, *size);
+    if (buffer == nullptr) {
+        return false;
+    }
+
+    format::encode_into(message, buffer, *size);
+    return true;
+}
+
+bool UdpEngine::send(ByteView frame, const Endpoint& to) {
+    auto buffer = next_send(to, frame.size());
+    if (buffer == nullptr) {
+        return false;
+    }
+
+    std::copy(frame.begin(), frame.end(), buffer);
+    return true;
+}
+
+int UdpEngine::flush() {
+    if (_pending == 0) {
+        return 0;
+    }
+    return _ring ? flush_ring() : flush_mmsg();
+}
+
+/***
+ * Claims the next send buffer for @p size bytes to @p to, flushing when all are queued.
+ */
+uint8_t* UdpEngine::next_send(const Endpoint& to, size_t size) {
+    if (size > _config.buffer_size) {
+        return nullptr;
+    }
+    if (_pending == _send_slots.size() && flush() < 0) {
+        return nullptr;
+    }
+
+    auto& slot = _send_slots[_pending++];
+    slot.endpoint = to;
+    slot.header.msg_namelen = to.length;
+    slot.iov.iov_len = size;
+    return static_cast<uint8_t*>(slot.iov.iov_base);
+}
+
+int UdpEngine::receive_mmsg(bool wait) {
+    auto headers = _headers.data();
+    for (size_t i = 0; i < _receive_slots.size(); ++i) {
+        auto& slot = _receive_slots[i];
+        slot.header.msg_namelen = sizeof(slot.endpoint.address);
+        headers[i].msg_hdr = slot.header;
+        headers[i].msg_len = 0;
+    }
+
+    int count;
+    do {
+        ++_stats.syscalls;
+        // MSG_TRUNC reports the full length of a datagram that did not fit, so it can be dropped.
+        count = ::recvmmsg(_fd, headers, static_cast<unsigned>(_receive_slots.size()), MSG_TRUNC | (wait ? MSG_WAITFORONE : MSG_DONTWAIT), nullptr);
+    } while (count < 0 && errno == EINTR);
+
+    if (count < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+
+    for (int i = 0; i < count; ++i) {
+        if (headers[i].msg_len > _config.buffer_size || (headers[i].msg_hdr.msg_flags & MSG_TRUNC)) {
+            ++_stats.truncated;
+            continue;
+        }
+        auto& slot = _receive_slots[i];
+        slot.endpoint.length = headers[i].msg_hdr.msg_namelen;
+        _datagrams.push_back({static_cast<const uint8_t*>(slot.iov.iov_base), headers[i].msg_len});
+        _sources.push_back(&slot.endpoint);
+    }
+    _stats.received += _datagrams.size();
+    return static_cast<int>(_datagrams.size());
+}
+
+int UdpEngine::flush_mmsg() {
+    auto headers = _headers.data();
+    for (size_t i = 0; i < _pending; ++i) {
+        headers[i].msg_hdr = _send_slots[i].header;
+        headers[i].msg_len = 0;
+    }
+
+    size_t done = 0;
+    size_t failed = 0;
+    int result = 0;
+    while (done < _pending) {
+        ++_stats.syscalls;
+        auto count = ::sendmmsg(_fd, headers + done, static_cast<unsigned>(_pending - done), 0);
+        if (count >= 0) {
+            done += static_cast<size_t>(count);
+            continue;
+        }
+        if (errno == EINTR) {
+            continue;
+        }
+        // sendmmsg() only fails on the first datagram it is handed; one refused for its
+        // destination is skipped, anything else fails the rest of the batch.
+        if (!destination_error(errno)) {
+            result = -1;
+            break;
+        }
+        ++_stats.send_errors;
+        ++failed;
+        ++done;
+    }
+
+    auto sent = done - failed;
+    _pending = 0;
+    _stats.sent += sent;
+    return result < 0 ? -1 : static_cast<int>(sent);
+}
+
+#ifdef MQTT_SN_NET_IO_URING
+
+/***
+ * Every receive slot always has a RECVMSG posted, except while its datagram is being handed out:
+ * slots consumed by the previous receive() are posted again in the same io_uring_enter() that
+ * waits for the next datagrams.
+ */
+int UdpEngine::receive_ring(bool wait) {
+    // Slots that cannot be posted now stay in _consumed for the next call.
+    size_t unposted = 0;
+    for (auto index : _consumed) {
+        if (!post_receive(index)) {
+            _consumed[unposted++] = index;
+        }
+    }
+    _consumed.resize(unposted);
+
+    const auto collect = [&](const io_uring_cqe& cqe) {
+        if (cqe.user_data & SEND_TAG) {
+            return;
+        }
+        collect_receive(cqe);
+    };
+
+    _ring->reap(collect);
+    while (_ready.empty()) {
+        ++_stats.syscalls;
+        if (_ring->submit(wait ? 1 : 0, _config.receive_timeout_ms) < 0) {
+            if (errno == ETIME) {
+                break;
+            }
+            return -1;
+        }
+        _ring->reap(collect);
+        if (!wait) {
+            break;
+        }
+    }
+
+    for (auto index : _ready) {
+        auto& slot = _receive_slots[index];
+        slot.endpoint.length = slot.header.msg_namelen;
+        _datagrams.push_back({static_cast<const uint8_t*>(slot.iov.iov_base), slot.size});
+        _sources.push_back(&slot.endpoint);
+        _consumed.push_back(index);
+    }
+    _ready.clear();
+    _stats.received += _datagrams.size();
+    return static_cast<int>(_datagrams.size());
+}
+
+int UdpEngine::flush_ring() {
+    // Sends that cannot be queued at all are discarded, like those the kernel fails.
+    size_t queued = 0;
+    int error = 0;
+    for (; queued < _pending; ++queued) {
+        auto sqe = next_sqe();
+        if (sqe == nullptr) {
+            error = errno;
+            break;
+        }
+        sqe->opcode = IORING_OP_SENDMSG;
+        sqe->fd = _fd;
+        sqe->addr = reinterpret_cast<uint64_t>(&_send_slots[queued].header);
+        sqe->len = 1;
+        sqe->user_data = SEND_TAG | queued;
+    }
+
+    size_t completed = 0;
+    size_t sent = 0;
+    const auto collect = [&](const io_uring_cqe& cqe) {
+        if (!(cqe.user_data & SEND_TAG)) {
+            collect_receive(cqe);
+            return;
+        }
+        ++completed;
+        if (cqe.res >= 0) {
+            ++sent;
+        } else if (destination_error(-cqe.res)) {
+            ++_stats.send_errors;
+        } else {
+            error = -cqe.res;
+        }
+    };
+
+    // The send buffers are reused as soon as this returns, so wait for every completion.
+    auto to_wait = static_cast<unsigned>(queued);
+    while (completed < queued) {
+        ++_stats.syscalls;
+        if (_ring->submit(to_wait) < 0) {
+            _pending = 0;
+            return -1;
+        }
+        _ring->reap(collect);
+        to_wait = static_cast<unsigned>(queued - completed);
+    }
+
+    _pending = 0;
+    _stats.sent += sent;
+    if (error != 0) {
+        errno = error;
+        return -1;
+    }
+    return static_cast<int>(sent);
+}
+
+/***
+ * Hands a completed receive over to the next batch, or posts the slot again if the receive failed
+ * or its datagram was truncated.
+ */
+void UdpEngine::collect_receive(const io_uring_cqe& cqe) {
+    auto index = static_cast<uint32_t>(cqe.user_data);
+    if (cqe.res < 0 || static_cast<size_t>(cqe.res) > _config.buffer_size) {
+        if (cqe.res >= 0) {
+            ++_stats.truncated;
+        }
+        repost(index);
+        return;
+    }
+    _receive_slots[index].size = static_cast<size_t>(cqe.res);
+    _ready.push_back(index);
+}
+
+/***
+ * A submission entry, submitting the entries queued so far to make room if the queue is full.
+ */
+io_uring_sqe* UdpEngine::next_sqe() {
+    auto sqe = _ring->next_sqe();
+    if (sqe == nullptr) {
+        ++_stats.syscalls;
+        if (_ring->submit(0) < 0) {
+            return nullptr;
+        }
+        sqe = _ring->next_sqe();
+    }
+    return sqe;
+}
+
+bool UdpEngine::post_receive(uint32_t index) {
+    auto sqe = next_sqe();
+    if (sqe == nullptr) {
+        return false;
+    }
+
+    auto& slot = _receive_slots[index];
+    slot.header.msg_namelen = sizeof(slot.endpoint.address);
+    slot.iov.iov_len = _config.buffer_size;
+
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->fd = _fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&slot.header);
+    sqe->len = 1;
+    // MSG_TRUNC reports the full length of a datagram that did not fit, so it can be dropped.
+    sqe->msg_flags = MSG_TRUNC;
+    sqe->user_data = index;
+    return true;
+}
+
+/***
+ * Posts the receive of @p index again, or leaves it for the next receive() if that fails.
+ */
+void UdpEngine::repost(uint32_t index) {
+    if (!post_receive(index)) {
+        _consumed.push_back(index);
+    }
+}
+
+#else
+
+int UdpEngine::receive_ring(bool wait) {
+    return receive_mmsg(wait);
+}
+
+int UdpEngine::flush_ring() {
+    return flush_mmsg();
+}
+
+bool UdpEngine::post_receive(uint32_t) {
+    return false;
+}
+
+void UdpEngine::repost(uint32_t) {}
+
+#endif
+
+}
@@ -0,0 +1,121 @@
+#include <mqtt-sn/sleep_buffer.h>
+
+#include <algorithm>
+
+namespace mqtt_sn {
+
+SleepBuffer::SleepBuffer(const Config& config) : _config(config) {}
+
+bool SleepBuffer::push(const Message& message) {
+    auto size = format::encoded_size(message);
+    if (!size) {
+        return false;
+    }
+
+    auto data = reserve(*size);
+    if (data == nullptr) {
+        return false;
+    }
+
+    format::encode_into(message, data, *size);
+    return true;
+}
+
+bool SleepBuffer::push(ByteView frame) {
+    // front() finds frame boundaries from the length fields, so they must cover the bytes exactly.
+    auto extent = format::frame_extent(frame.data(), frame.size());
+    if (extent.status != format::FrameStatus::Complete || extent.size != frame.size()) {
+        return false;
+    }
+
+    auto data = reserve(frame.size());
+    if (data == nullptr) {
+        return false;
+    }
+
+    std::copy(frame.begin(), frame.end(), data);
+    return true;
+}
+
+ByteView SleepBuffer::front() const {
+    if (empty()) {
+        return {};
+    }
+
+    auto end = _wrap != 0 ? _wrap : _tail;
+    auto extent = format::frame_extent(_slab.data() + _head, end - _head);
+    assert(extent.status == format::FrameStatus::Complete);
+    return ByteView(_slab.data() + _head, extent.size);
+}
+
+void SleepBuffer::pop() {
+    if (empty()) {
+        return;
+    }
+
+    auto size = front().size();
+    _head += size;
+    _bytes -= size;
+    --_frames;
+
+    if (_frames == 0) {
+        _head = _tail = _wrap = 0;
+    } else if (_wrap != 0 && _head == _wrap) {
+        _head = 0;
+        _wrap = 0;
+    }
+}
+
+void SleepBuffer::reset() {
+    _slab = {};
+    _head = _tail = _wrap = 0;
+    _frames = 0;
+    _bytes = 0;
+}
+
+/***
+ * Whether @p size contiguous bytes are free, after the newest frame or at the start of the slab.
+ */
+bool SleepBuffer::fits(size_t size) const {
+    if (_wrap != 0) {
+        return _head - _tail >= size;
+    }
+    return _config.capacity - _tail >= size || (_frames > 0 && _head >= size);
+}
+
+/***
+ * Makes room for a frame of @p size bytes following the drop policy and returns where to write it,
+ * or nullptr if it is dropped.
+ */
+uint8_t* SleepBuffer::reserve(size_t size) {
+    if (size == 0 || size > _config.capacity) {
+        ++_dropped;
+        return nullptr;
+    }
+
+    while (!fits(size)) {
+        if (_config.policy == DropPolicy::DropNewest) {
+            ++_dropped;
+            return nullptr;
+        }
+        pop();
+        ++_dropped;
+    }
+
+    if (_slab.empty()) {
+        _slab.resize(_config.capacity);
+    }
+
+    if (_wrap == 0 && _config.capacity - _tail < size) {
+        _wrap = _tail;
+        _tail = 0;
+    }
+
+    auto data = _slab.data() + _tail;
+    _tail += size;
+    _bytes += size;
+    ++_frames;
+    return data;
+}
+
+}
@@ -0,0 +1,95 @@
+#include "stats_counters.h"
+
+#include <algorithm>
+#include <mutex>
+#include <vector>
+
+namespace mqtt_sn::format::stats {
+
+#ifdef MQTT_SN_FORMAT_ENABLE_STATS
+
+namespace {
+
+void add_to(Snapshot& snapshot, const ThreadCounters& counters) {
+    for (size_t i = 0; i < counters.types.size(); ++i) {
+        auto& from = counters.types[i];
+        auto& to = snapshot.types[i];
+        to.decoded += from.decoded.load();
+        to.decoded_bytes += from.decoded_bytes.load();
+        to.encoded += from.encoded.load();
+        to.encoded_bytes += from.encoded_bytes.load();
+    }
+    for (size_t i = 0; i < counters.malformed.size(); ++i) {
+        snapshot.malformed[i] += counters.malformed[i].load();
+    }
+    snapshot.long_decoded += counters.long_decoded.load();
+    snapshot.long_encoded += counters.long_encoded.load();
+    for (size_t i = 0; i < CYCLE_BUCKETS; ++i) {
+        snapshot.decode_cycles[i] += counters.decode_cycles[i].load();
+        snapshot.encode_cycles[i] += counters.encode_cycles[i].load();
+    }
+}
+
+/***
+ * Live threads' counters, and the sum of those of exited threads.
+ */
+struct Registry {
+    std::mutex mutex;
+    std::vector<const ThreadCounters*> threads;
+    Snapshot retired;
+};
+
+Registry& registry() {
+    // Leaked, so that threads exiting during static destruction can still fold their counters.
+    static auto instance = new Registry();
+    return *instance;
+}
+
+/***
+ * Owns a thread's counters; folds them into the retired totals when the thread exits.
+ */
+struct ThreadSlot {
+    ThreadSlot() {
+        auto& shared = registry();
+        std::lock_guard lock(shared.mutex);
+        shared.threads.push_back(&counters);
+    }
+
+    ~ThreadSlot() {
+        auto& shared = registry();
+        std::lock_guard lock(shared.mutex);
+        add_to(shared.retired, counters);
+        shared.threads.erase(std::find(shared.threads.begin(), shared.threads.end(), &counters));
+        current = nullptr;
+    }
+
+    ThreadCounters counters;
+};
+
+}
+
+ThreadCounters& attach() {
+    thread_local ThreadSlot slot;
+    current = &slot.counters;
+    return slot.counters;
+}
+
+Snapshot snapshot() {
+    auto& shared = registry();
+    std::lock_guard lock(shared.mutex);
+    auto result = shared.retired;
+    for (auto counters : shared.threads) {
+        add_to(result, *counters);
+    }
+    return result;
+}
+
+#else
+
+Snapshot snapshot() {
+    return {};
+}
+
+#endif
+
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+#include <mqtt-sn/stats.h>
+
+#if defined(MQTT_SN_FORMAT_ENABLE_CYCLE_STATS) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#endif
+
+namespace mqtt_sn::format::stats {
+
+#ifdef MQTT_SN_FORMAT_ENABLE_STATS
+
+/***
+ * A counter written by a single thread. A relaxed load and store instead of fetch_add avoids the
+ * locked instruction, while snapshot() can still read it from another thread.
+ */
+class Counter {
+public:
+    void add(uint64_t n) {
+        _value.store(_value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    uint64_t load() const {
+        return _value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> _value {0};
+};
+
+struct TypeCounterBlock {
+    Counter decoded;
+    Counter decoded_bytes;
+    Counter encoded;
+    Counter encoded_bytes;
+};
+
+struct ThreadCounters {
+    std::array<TypeCounterBlock, 256> types;
+    std::array<Counter, PARSE_ERROR_COUNT> malformed;
+    Counter long_decoded;
+    Counter long_encoded;
+    std::array<Counter, CYCLE_BUCKETS> decode_cycles;
+    std::array<Counter, CYCLE_BUCKETS> encode_cycles;
+};
+
+/***
+ * The calling thread's counters, registered with snapshot() on first use. The pointer is
+ * constant-initialized, so the fast path is a plain thread-local load.
+ */
+inline thread_local ThreadCounters* current = nullptr;
+
+ThreadCounters& attach();
+
+inline ThreadCounters& counters() {
+    auto block = current;
+    return block != nullptr ? *block : attach();
+}
+
+inline void on_decoded(MessageType type, size_t len, bool long_length) {
+    auto& block = counters();
+    auto& type_block = block.types[static_cast<size_t>(type)];
+    type_block.decoded.add(1);
+    type_block.decoded_bytes.add(len);
+    if (long_length) {
+        block.long_decoded.add(1);
+    }
+}
+
+inline void on_encoded(MessageType type, size_t len, bool long_length) {
+    auto& block = counters();
+    auto& type_block = block.types[static_cast<size_t>(type)];
+    type_block.encoded.add(1);
+    type_block.encoded_bytes.add(len);
+    if (long_length) {
+        block.long_encoded.add(1);
+    }
+}
+
+inline void on_malformed(Malformed reason) {
+    counters().malformed[static_cast<size_t>(reason)].add(1);
+}
+
+#else
+
+inline void on_decoded(MessageType, size_t, bool) {}
+inline void on_encoded(MessageType, size_t, bool) {}
+inline void on_malformed(Malformed) {}
+
+#endif
+
+#if defined(MQTT_SN_FORMAT_ENABLE_STATS) && defined(MQTT_SN_FORMAT_ENABLE_CYCLE_STATS)
+
+inline uint64_t cycle_count() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+/***
+ * Adds the cycles between construction and destruction to a histogram of the thread's counters.
+ */
+template<std::array<Counter, CYCLE_BUCKETS> ThreadCounters::*Histogram>
+class ScopedCycles {
+public:
+    ScopedCycles() : _start(cycle_count()) {}
+
+    ~ScopedCycles() {
+        auto elapsed = cycle_count() - _start;
+        size_t bucket = elapsed == 0 ? 0 : static_cast<size_t>(63 - __builtin_clzll(elapsed));
+        (counters().*Histogram)[bucket < CYCLE_BUCKETS ? bucket : CYCLE_BUCKETS - 1].add(1);
+    }
+
+    ScopedCycles(const ScopedCycles&) = delete;
+    ScopedCycles& operator=(const ScopedCycles&) = delete;
+
+private:
+    uint64_t _start;
+};
+
+using DecodeCycles = ScopedCycles<&ThreadCounters::decode_cycles>;
+using EncodeCycles = ScopedCycles<&ThreadCounters::encode_cycles>;
+
+#else
+
+struct DecodeCycles {};
+struct EncodeCycles {};
+
+#endif
+
+}
@@ -0,0 +1,296 @@
+#include <mqtt-sn/subscription_index.h>
+
+#include <algorithm>
+#include <array>
+
+#if defined(__SSE2__) && (defined(__GNUC__) || defined(__clang__))
+#include <emmintrin.h>
+#define MQTT_SN_SPLIT_SSE2 1
+#endif
+
+namespace mqtt_sn {
+
+namespace {
+
+/***
+ * Calls @p visit with each '/'-separated level of @p topic, in order. Separators are located
+ * 16 bytes at a time with SSE2 where available.
+ */
+template<typename Visitor>
+void for_each_level(std::string_view topic, Visitor&& visit) {
+    size_t start = 0;
+    size_t i = 0;
+#ifdef MQTT_SN_SPLIT_SSE2
+    const __m128i separator = _mm_set1_epi8('/');
+    for (; i + 16 <= topic.size(); i += 16) {
+        auto chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(topic.data() + i));
+        auto mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, separator)));
+        while (mask != 0) {
+            auto at = i + static_cast<size_t>(__builtin_ctz(mask));
+            visit(topic.substr(start, at - start));
+            start = at + 1;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    for (; i < topic.size(); ++i) {
+        if (topic[i] == '/') {
+            visit(topic.substr(start, i - start));
+            start = i + 1;
+        }
+    }
+    visit(topic.substr(start));
+}
+
+/***
+ * The levels of a topic or filter. Views into the string, kept inline for typical depths.
+ */
+class Levels {
+public:
+    explicit Levels(std::string_view topic) {
+        for_each_level(topic, [this](std::string_view level) {
+            push(level);
+        });
+    }
+
+    const std::string_view* data() const {
+        return _overflow.empty() ? _inline.data() : _overflow.data();
+    }
+
+    size_t size() const {
+        return _size;
+    }
+
+private:
+    void push(std::string_view level) {
+        if (_size < _inline.size()) {
+            _inline[_size++] = level;
+            return;
+        }
+        if (_overflow.empty()) {
+            _overflow.assign(_inline.begin(), _inline.end());
+        }
+        _overflow.push_back(level);
+        ++_size;
+    }
+
+    std::array<std::string_view, 32> _inline;
+    std::vector<std::string_view> _overflow;
+    size_t _size = 0;
+};
+
+/***
+ * '+' and '#' must take up a whole level, and '#' must be the last one.
+ */
+bool valid_filter(const Levels& levels) {
+    for (size_t i = 0; i < levels.size(); ++i) {
+        auto level = levels.data()[i];
+        if (level.find('#') != std::string_view::npos && (level != "#" || i + 1 != levels.size())) {
+            return false;
+        }
+        if (level.find('+') != std::string_view::npos && level != "+") {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool insert_sorted(std::vector<SubscriberId>& subscribers, SubscriberId subscriber) {
+    auto it = std::lower_bound(subscribers.begin(), subscribers.end(), subscriber);
+    if (it != subscribers.end() && *it == subscriber) {
+        return false;
+    }
+    subscribers.insert(it, subscriber);
+    return true;
+}
+
+bool erase_sorted(std::vector<SubscriberId>& subscribers, SubscriberId subscriber) {
+    auto it = std::lower_bound(subscribers.begin(), subscribers.end(), subscriber);
+    if (it == subscribers.end() || *it != subscriber) {
+        return false;
+    }
+    subscribers.erase(it);
+    return true;
+}
+
+/***
+ * The filter a SUBSCRIBE or UNSUBSCRIBE refers to. A short topic name is written to @p short_name.
+ */
+template<typename T>
+optional<std::string_view> filter_of(const T& message, const TopicRegistry& registry, std::array<char, 2>& short_name) {
+    if (auto name = std::get_if<std::string>(&message.topic)) {
+        return std::string_view(*name);
+    }
+
+    auto topic_id = std::get<uint16_t>(message.topic);
+    if (static_cast<TopicIdType>(message.flags.topic_id_type) == TopicIdType::Short) {
+        short_name = {static_cast<char>(topic_id >> 8), static_cast<char>(topic_id & 0xFF)};
+        return std::string_view(short_name.data(), short_name.size());
+    }
+    return registry.name(topic_id);
+}
+
+}
+
+struct SubscriptionIndex::Node {
+    std::string level;
+    std::unordered_map<std::string_view, std::unique_ptr<Node>> children;   // keyed by the child's level
+    std::unique_ptr<Node> single;                                           // '+'
+    std::vector<SubscriberId> subscribers;                                  // filters ending here, sorted
+    std::vector<SubscriberId> rest;                                         // filters ending here with '#', sorted
+
+    bool empty() const {
+        return subscribers.empty() && rest.empty() && children.empty() && !single;
+    }
+};
+
+SubscriptionIndex::SubscriptionIndex() : _root(std::make_unique<Node>()) {}
+
+SubscriptionIndex::~SubscriptionIndex() = default;
+
+bool SubscriptionIndex::subscribe(SubscriberId subscriber, std::string_view filter) {
+    if (filter.empty()) {
+        return false;
+    }
+
+    Levels levels(filter);
+    if (!valid_filter(levels)) {
+        return false;
+    }
+
+    auto node = _root.get();
+    auto count = levels.size();
+    auto multi_level = levels.data()[count - 1] == "#";
+    if (multi_level) {
+        --count;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        auto level = levels.data()[i];
+        if (level == "+") {
+            if (!node->single) {
+                node->single = std::make_unique<Node>();
+                node->single->level = level;
+            }
+            node = node->single.get();
+            continue;
+        }
+
+        auto it = node->children.find(level);
+        if (it == node->children.end()) {
+            auto child = std::make_unique<Node>();
+            child->level = level;
+            std::string_view key = child->level;
+            it = node->children.emplace(key, std::move(child)).first;
+        }
+        node = it->second.get();
+    }
+
+    if (insert_sorted(multi_level ? node->rest : node->subscribers, subscriber)) {
+        ++_size;
+    }
+    return true;
+}
+
+bool SubscriptionIndex::unsubscribe(SubscriberId subscriber, std::string_view filter) {
+    if (filter.empty()) {
+        return false;
+    }
+
+    Levels levels(filter);
+    if (!valid_filter(levels) || !erase(*_root, levels.data(), levels.size(), subscriber)) {
+        return false;
+    }
+    --_size;
+    return true;
+}
+
+bool SubscriptionIndex::subscribe(SubscriberId subscriber, const Subscribe& message, const TopicRegistry& registry) {
+    std::array<char, 2> short_name;
+    auto filter = filter_of(message, registry, short_name);
+    return filter && subscribe(subscriber, filter.value());
+}
+
+bool SubscriptionIndex::unsubscribe(SubscriberId subscriber, const Unsubscribe& message, const TopicRegistry& registry) {
+    std::array<char, 2> short_name;
+    auto filter = filter_of(message, registry, short_name);
+    return filter && unsubscribe(subscriber, filter.value());
+}
+
+void SubscriptionIndex::match(std::string_view topic, std::vector<SubscriberId>& subscribers) const {
+    if (topic.empty()) {
+        return;
+    }
+
+    Levels levels(topic);
+    auto first = subscribers.size();
+    collect(*_root, levels.data(), levels.size(), true, subscribers);
+
+    std::sort(subscribers.begin() + first, subscribers.end());
+    subscribers.erase(std::unique(subscribers.begin() + first, subscribers.end()), subscribers.end());
+}
+
+void SubscriptionIndex::match(uint16_t topic_id, const TopicRegistry& registry, std::vector<SubscriberId>& subscribers) const {
+    if (auto topic = registry.name(topic_id)) {
+        match(topic.value(), subscribers);
+    }
+}
+
+/***
+ * Removes @p subscriber from the filter made of @p levels below @p node, then drops the nodes
+ * left empty on the way back up.
+ */
+bool SubscriptionIndex::erase(Node& node, const std::string_view* levels, size_t count, SubscriberId subscriber) {
+    if (count == 0) {
+        return erase_sorted(node.subscribers, subscriber);
+    }
+
+    auto level = levels[0];
+    if (count == 1 && level == "#") {
+        return erase_sorted(node.rest, subscriber);
+    }
+
+    if (level == "+") {
+        if (!node.single || !erase(*node.single, levels + 1, count - 1, subscriber)) {
+            return false;
+        }
+        if (node.single->empty()) {
+            node.single.reset();
+        }
+        return true;
+    }
+
+    auto it = node.children.find(level);
+    if (it == node.children.end() || !erase(*it->second, levels + 1, count - 1, subscriber)) {
+        return false;
+    }
+    if (it->second->empty()) {
+        node.children.erase(it);
+    }
+    return true;
+}
+
+void SubscriptionIndex::collect(const Node& node, const std::string_view* levels, size_t count, bool root,
+                                std::vector<SubscriberId>& subscribers) {
+    if (count == 0) {
+        subscribers.insert(subscribers.end(), node.subscribers.begin(), node.subscribers.end());
+        subscribers.insert(subscribers.end(), node.rest.begin(), node.rest.end());
+        return;
+    }
+
+    auto level = levels[0];
+    auto wildcards = !(root && !level.empty() && level[0] == '$');
+    if (wildcards) {
+        subscribers.insert(subscribers.end(), node.rest.begin(), node.rest.end());
+        if (node.single) {
+            collect(*node.single, levels + 1, count - 1, false, subscribers);
+        }
+    }
+
+    auto it = node.children.find(level);
+    if (it != node.children.end()) {
+        collect(*it->second, levels + 1, count - 1, false, subscribers);
+    }
+}
+
+}
@@ -0,0 +1,117 @@
+#include <mqtt-sn/timer_wheel.h>
+
+#include <cassert>
+
+namespace mqtt_sn {
+
+TimerWheel::TimerWheel(uint32_t now) : _now(now) {
+    _buckets.fill(NIL);
+}
+
+TimerWheel::TimerId TimerWheel::add(uint32_t deadline, uint64_t data) {
+    TimerId timer;
+    if (_free != NIL) {
+        timer = _free;
+        _free = _timers[timer].next;
+    } else {
+        timer = static_cast<TimerId>(_timers.size());
+        _timers.emplace_back();
+    }
+
+    auto& entry = _timers[timer];
+    entry.deadline = deadline;
+    entry.data = data;
+    entry.released = false;
+    entry.bucket = UNLINKED;
+    link(timer);
+    ++_size;
+    return timer;
+}
+
+void TimerWheel::rearm(TimerId timer, uint32_t deadline) {
+    assert(!_timers[timer].released);
+
+    if (_timers[timer].bucket != UNLINKED) {
+        unlink(timer);
+    }
+    _timers[timer].deadline = deadline;
+    link(timer);
+}
+
+bool TimerWheel::cancel(TimerId timer) {
+    if (!armed(timer)) {
+        return false;
+    }
+
+    unlink(timer);
+    release(timer);
+    return true;
+}
+
+bool TimerWheel::armed(TimerId timer) const {
+    return timer < _timers.size() && !_timers[timer].released && _timers[timer].bucket != UNLINKED;
+}
+
+/***
+ * Puts the timer in the bucket for its deadline: the lowest level whose span covers the distance
+ * to the current tick. Past deadlines go to the current tick.
+ */
+void TimerWheel::link(TimerId timer) {
+    auto& entry = _timers[timer];
+    auto deadline = static_cast<int32_t>(entry.deadline - _now) < 0 ? _now : entry.deadline;
+    auto distance = deadline - _now;
+
+    size_t level = 0;
+    while (level + 1 < LEVELS && distance >= (uint32_t(1) << (LEVEL_BITS * (level + 1)))) {
+        ++level;
+    }
+
+    auto bucket = static_cast<uint16_t>(level * BUCKETS + (deadline >> (LEVEL_BITS * level) & (BUCKETS - 1)));
+    auto& head = _buckets[bucket];
+    entry.bucket = bucket;
+    entry.prev = NIL;
+    entry.next = head;
+    if (head != NIL) {
+        _timers[head].prev = timer;
+    }
+    head = timer;
+}
+
+void TimerWheel::unlink(TimerId timer) {
+    auto& entry = _timers[timer];
+    if (entry.prev != NIL) {
+        _timers[entry.prev].next = entry.next;
+    } else {
+        _buckets[entry.bucket] = entry.next;
+    }
+    if (entry.next != NIL) {
+        _timers[entry.next].prev = entry.prev;
+    }
+    entry.next = NIL;
+    entry.prev = NIL;
+    entry.bucket = UNLINKED;
+}
+
+void TimerWheel::release(TimerId timer) {
+    auto& entry = _timers[timer];
+    entry.released = true;
+    entry.next = _free;
+    _free = timer;
+    --_size;
+}
+
+/***
+ * Moves the timers of the current bucket of @p level down to the levels below.
+ */
+void TimerWheel::cascade(size_t level) {
+    auto& bucket = _buckets[level * BUCKETS + (_now >> (LEVEL_BITS * level) & (BUCKETS - 1))];
+    auto timer = bucket;
+    bucket = NIL;
+    while (timer != NIL) {
+        auto next = _timers[timer].next;
+        link(timer);
+        timer = next;
+    }
+}
+
+}
@@ -0,0 +1,58 @@
+#include <mqtt-sn/topic_ref.h>
+
+#include <algorithm>
+
+namespace mqtt_sn {
+
+PredefinedTopics::PredefinedTopics(std::initializer_list<Entry> entries) : PredefinedTopics(entries.begin(), entries.size()) {}
+
+PredefinedTopics::PredefinedTopics(const Entry* entries, size_t count) {
+    vector<Entry> sorted;
+    for (size_t i = 0; i < count; ++i) {
+        const auto& entry = entries[i];
+        auto duplicate = std::find_if(sorted.begin(), sorted.end(), [&](const Entry& other) {
+            return other.topic_id == entry.topic_id || other.name == entry.name;
+        });
+        if (duplicate == sorted.end()) {
+            sorted.push_back(entry);
+        }
+    }
+    std::sort(sorted.begin(), sorted.end(), [](const Entry& lhs, const Entry& rhs) {
+        return lhs.topic_id < rhs.topic_id;
+    });
+
+    for (const auto& entry : sorted) {
+        _ids.push_back(entry.topic_id);
+        _names.emplace_back(entry.name);
+    }
+
+    // Keys view into _names, which is not modified past this point.
+    for (size_t i = 0; i < _ids.size(); ++i) {
+        _by_name.emplace(_names[i], _ids[i]);
+    }
+}
+
+optional<std::string_view> PredefinedTopics::name(uint16_t topic_id) const {
+    auto it = std::lower_bound(_ids.begin(), _ids.end(), topic_id);
+    if (it == _ids.end() || *it != topic_id) {
+        return nullopt;
+    }
+    return std::string_view(_names[it - _ids.begin()]);
+}
+
+optional<std::string_view> PredefinedTopics::name(TopicRef topic) const {
+    if (topic.type() != TopicIdType::PreDefined) {
+        return nullopt;
+    }
+    return name(topic.value());
+}
+
+optional<TopicRef> PredefinedTopics::find(std::string_view name) const {
+    auto it = _by_name.find(name);
+    if (it == _by_name.end()) {
+        return nullopt;
+    }
+    return TopicRef::predefined(it->second);
+}
+
+}
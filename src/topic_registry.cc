@@ -0,0 +1,247 @@
+#include <mqtt-sn/topic_registry.h>
+
+#include <algorithm>
+#include <functional>
+
+namespace mqtt_sn {
+
+namespace {
+
+constexpr size_t INITIAL_TABLE_CAPACITY = 64;
+
+size_t hash_of(std::string_view name) {
+    return std::hash<std::string_view> {}(name);
+}
+
+}
+
+TopicRegistry::Table::Table(size_t capacity) : mask(capacity - 1), slots(new std::atomic<Name*>[capacity]) {
+    for (size_t i = 0; i < capacity; ++i) {
+        slots[i].store(nullptr, std::memory_order_relaxed);
+    }
+}
+
+TopicRegistry::TopicRegistry() {
+    _tables.push_back(std::make_unique<Table>(INITIAL_TABLE_CAPACITY));
+    _table.store(_tables.back().get(), std::memory_order_release);
+}
+
+TopicRegistry::~TopicRegistry() = default;
+
+optional<uint16_t> TopicRegistry::register_topic(std::string_view name) {
+    if (name.empty()) {
+        return nullopt;
+    }
+
+    std::lock_guard lock(_mutex);
+    auto interned = intern(name);
+    if (auto id = interned->id.load(std::memory_order_relaxed); id != 0) {
+        return id;
+    }
+
+    auto id = allocate_id();
+    if (!id) {
+        return nullopt;
+    }
+    bind(id.value(), interned);
+    return id;
+}
+
+bool TopicRegistry::assign(uint16_t topic_id, std::string_view name) {
+    if (topic_id < MIN_TOPIC_ID || topic_id > MAX_TOPIC_ID || name.empty()) {
+        return false;
+    }
+
+    std::lock_guard lock(_mutex);
+    auto interned = intern(name);
+    if (interned->id.load(std::memory_order_relaxed) == topic_id) {
+        return true;
+    }
+
+    if (auto previous = interned->id.load(std::memory_order_relaxed); previous != 0) {
+        release(previous);
+        _free_ids.push_back(previous);
+    }
+    if (slot(topic_id).load(std::memory_order_relaxed) != nullptr) {
+        release(topic_id);
+    }
+
+    // Ids handed out by the peer are taken out of our own allocation range.
+    if (topic_id >= _next_id) {
+        for (auto id = _next_id; id < topic_id; ++id) {
+            _free_ids.push_back(static_cast<uint16_t>(id));
+        }
+        _next_id = topic_id + 1u;
+    } else {
+        auto it = std::find(_free_ids.begin(), _free_ids.end(), topic_id);
+        if (it != _free_ids.end()) {
+            *it = _free_ids.back();
+            _free_ids.pop_back();
+        }
+    }
+
+    bind(topic_id, interned);
+    return true;
+}
+
+bool TopicRegistry::unregister(uint16_t topic_id) {
+    if (topic_id < MIN_TOPIC_ID || topic_id > MAX_TOPIC_ID) {
+        return false;
+    }
+
+    std::lock_guard lock(_mutex);
+    if (slot(topic_id).load(std::memory_order_relaxed) == nullptr) {
+        return false;
+    }
+
+    release(topic_id);
+    _free_ids.push_back(topic_id);
+    return true;
+}
+
+optional<std::string_view> TopicRegistry::name(uint16_t topic_id) const {
+    auto page = _pages[topic_id >> 8].load(std::memory_order_acquire);
+    if (page == nullptr) {
+        return nullopt;
+    }
+
+    auto name = (*page)[topic_id & 0xFF].load(std::memory_order_acquire);
+    if (name == nullptr) {
+        return nullopt;
+    }
+    return std::string_view(name->value);
+}
+
+optional<uint16_t> TopicRegistry::find(std::string_view name) const {
+    auto hash = hash_of(name);
+    auto table = _table.load(std::memory_order_acquire);
+    for (auto index = hash & table->mask;; index = (index + 1) & table->mask) {
+        auto candidate = table->slots[index].load(std::memory_order_acquire);
+        if (candidate == nullptr) {
+            return nullopt;
+        }
+        if (candidate->hash == hash && candidate->value == name) {
+            auto id = candidate->id.load(std::memory_order_acquire);
+            if (id == 0) {
+                return nullopt;
+            }
+            return id;
+        }
+    }
+}
+
+size_t TopicRegistry::size() const {
+    return _size.load(std::memory_order_relaxed);
+}
+
+size_t TopicRegistry::interned() const {
+    std::lock_guard lock(_mutex);
+    return _names.size();
+}
+
+void TopicRegistry::compact() {
+    std::lock_guard lock(_mutex);
+    std::deque<Name> names;
+    for (auto& name : _names) {
+        if (auto id = name.id.load(std::memory_order_relaxed); id != 0) {
+            auto& kept = names.emplace_back(name.value, name.hash);
+            kept.id.store(id, std::memory_order_relaxed);
+            slot(id).store(&kept, std::memory_order_relaxed);
+        }
+    }
+    _names.swap(names);
+
+    // Sized as intern() would have grown it for this many names.
+    auto capacity = INITIAL_TABLE_CAPACITY;
+    while ((_names.size() + 1) * 2 > capacity) {
+        capacity *= 2;
+    }
+    auto table = std::make_unique<Table>(capacity);
+    for (auto& name : _names) {
+        auto index = name.hash & table->mask;
+        while (table->slots[index].load(std::memory_order_relaxed) != nullptr) {
+            index = (index + 1) & table->mask;
+        }
+        table->slots[index].store(&name, std::memory_order_relaxed);
+    }
+    _table.store(table.get(), std::memory_order_release);
+    _tables.clear();
+    _tables.push_back(std::move(table));
+}
+
+/***
+ * Returns the interned copy of @p name, adding it if needed. Called with the mutex held.
+ */
+TopicRegistry::Name* TopicRegistry::intern(std::string_view name) {
+    auto hash = hash_of(name);
+    auto table = _table.load(std::memory_order_relaxed);
+    auto index = hash & table->mask;
+    for (;; index = (index + 1) & table->mask) {
+        auto candidate = table->slots[index].load(std::memory_order_relaxed);
+        if (candidate == nullptr) {
+            break;
+        }
+        if (candidate->hash == hash && candidate->value == name) {
+            return candidate;
+        }
+    }
+
+    auto interned = &_names.emplace_back(name, hash);
+    if ((_names.size() + 1) * 2 <= table->mask + 1) {
+        table->slots[index].store(interned, std::memory_order_release);
+        return interned;
+    }
+
+    // Grow: fill a table twice the size, then publish it in one store.
+    auto grown = std::make_unique<Table>((table->mask + 1) * 2);
+    for (auto& existing : _names) {
+        auto slot_index = existing.hash & grown->mask;
+        while (grown->slots[slot_index].load(std::memory_order_relaxed) != nullptr) {
+            slot_index = (slot_index + 1) & grown->mask;
+        }
+        grown->slots[slot_index].store(&existing, std::memory_order_relaxed);
+    }
+    _table.store(grown.get(), std::memory_order_release);
+    _tables.push_back(std::move(grown));
+    return interned;
+}
+
+std::atomic<TopicRegistry::Name*>& TopicRegistry::slot(uint16_t topic_id) {
+    auto& page = _pages[topic_id >> 8];
+    if (page.load(std::memory_order_relaxed) == nullptr) {
+        _page_storage.push_back(std::make_unique<Page>());
+        for (auto& entry : *_page_storage.back()) {
+            entry.store(nullptr, std::memory_order_relaxed);
+        }
+        page.store(_page_storage.back().get(), std::memory_order_release);
+    }
+    return (*page.load(std::memory_order_relaxed))[topic_id & 0xFF];
+}
+
+void TopicRegistry::bind(uint16_t topic_id, Name* name) {
+    name->id.store(topic_id, std::memory_order_release);
+    slot(topic_id).store(name, std::memory_order_release);
+    _size.fetch_add(1, std::memory_order_relaxed);
+}
+
+void TopicRegistry::release(uint16_t topic_id) {
+    auto& entry = slot(topic_id);
+    auto name = entry.load(std::memory_order_relaxed);
+    name->id.store(0, std::memory_order_release);
+    entry.store(nullptr, std::memory_order_release);
+    _size.fetch_sub(1, std::memory_order_relaxed);
+}
+
+optional<uint16_t> TopicRegistry::allocate_id() {
+    if (!_free_ids.empty()) {
+        auto id = _free_ids.back();
+        _free_ids.pop_back();
+        return id;
+    }
+    if (_next_id > MAX_TOPIC_ID) {
+        return nullopt;
+    }
+    return static_cast<uint16_t>(_next_id++);
+}
+
+}
@@ -0,0 +1,127 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mqtt-sn/compact_message.h>
+
+namespace {
+
+mqtt_sn::PublishMessage make_publish(uint16_t message_id, size_t payload_size) {
+    mqtt_sn::PublishMessage message {};
+    message.topic_id = 7;
+    message.message_id = message_id;
+    message.payload.assign(payload_size, 0x5A);
+    return message;
+}
+
+std::vector<uint8_t> encode(const mqtt_sn::Message& message) {
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(message, buffer);
+    return buffer;
+}
+
+}
+
+TEST_CASE("CompactMessage is smaller than Message", "[compact_message]") {
+    STATIC_REQUIRE(sizeof(mqtt_sn::CompactMessage) < sizeof(mqtt_sn::Message));
+}
+
+TEST_CASE("CompactMessage keeps short messages inline", "[compact_message]") {
+    mqtt_sn::Message publish = make_publish(3, 23);
+    mqtt_sn::CompactMessage compact(publish);
+    REQUIRE(compact.is_inline());
+    REQUIRE(compact.type() == mqtt_sn::MessageType::Publish);
+
+    auto frame = encode(publish);
+    REQUIRE(compact.frame() == mqtt_sn::ByteView(frame.data(), frame.size()));
+
+    auto view = compact.view();
+    REQUIRE(view.has_value());
+    auto& message = std::get<mqtt_sn::PublishMessageView>(*view);
+    REQUIRE(message.topic_id == 7);
+    REQUIRE(message.message_id == 3);
+    REQUIRE(message.payload.size() == 23);
+    REQUIRE(message.payload.data() == compact.frame().data() + 7);
+
+    mqtt_sn::CompactMessage connect(mqtt_sn::Message(mqtt_sn::Connect {{}, 1, 60, std::string(23, 'c')}));
+    REQUIRE(connect.is_inline());
+    REQUIRE(std::get<mqtt_sn::Connect>(*connect.message()).client_id == std::string(23, 'c'));
+
+    mqtt_sn::CompactMessage ping(mqtt_sn::Message(mqtt_sn::PingResponse {}));
+    REQUIRE(ping.is_inline());
+    REQUIRE(ping.frame().size() == 2);
+    REQUIRE(std::holds_alternative<mqtt_sn::PingResponse>(*ping.view()));
+}
+
+TEST_CASE("CompactMessage moves long messages to the heap", "[compact_message]") {
+    for (size_t size : {size_t(25), size_t(300), size_t(4096)}) {
+        mqtt_sn::Message publish = make_publish(1, size);
+        mqtt_sn::CompactMessage compact(publish);
+        REQUIRE_FALSE(compact.is_inline());
+        REQUIRE(compact.type() == mqtt_sn::MessageType::Publish);
+
+        auto frame = encode(publish);
+        REQUIRE(compact.frame() == mqtt_sn::ByteView(frame.data(), frame.size()));
+        REQUIRE(std::get<mqtt_sn::PublishMessage>(*compact.message()).payload.size() == size);
+    }
+
+    mqtt_sn::format::BufferWriter inner;
+    mqtt_sn::format::encode(make_publish(2, 16), inner);
+    mqtt_sn::Message forward = mqtt_sn::Forward {1, {1, 2, 3, 4}, inner};
+    mqtt_sn::CompactMessage compact(forward);
+    REQUIRE(compact.type() == mqtt_sn::MessageType::Forward);
+    auto frame = encode(forward);
+    REQUIRE(compact.frame() == mqtt_sn::ByteView(frame.data(), frame.size()));
+}
+
+TEST_CASE("CompactMessage from a view or a frame", "[compact_message]") {
+    auto frame = encode(make_publish(9, 40));
+    auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+    auto view = mqtt_sn::format::parse_view(reader);
+    REQUIRE(view.has_value());
+
+    mqtt_sn::CompactMessage from_view(*view);
+    REQUIRE(from_view.frame() == mqtt_sn::ByteView(frame.data(), frame.size()));
+
+    mqtt_sn::CompactMessage from_frame(mqtt_sn::ByteView(frame.data(), frame.size()));
+    REQUIRE(from_frame.frame() == from_view.frame());
+    REQUIRE(from_frame.frame().data() != frame.data());
+}
+
+TEST_CASE("CompactMessage copies and moves", "[compact_message]") {
+    for (size_t size : {size_t(4), size_t(100)}) {
+        mqtt_sn::CompactMessage original(mqtt_sn::Message(make_publish(5, size)));
+        auto frame = original.frame();
+
+        mqtt_sn::CompactMessage copy(original);
+        REQUIRE(copy.frame() == frame);
+        REQUIRE(copy.frame().data() != frame.data());
+
+        mqtt_sn::CompactMessage moved(std::move(copy));
+        REQUIRE(moved.frame() == frame);
+        REQUIRE(copy.empty());
+        REQUIRE_FALSE(copy.view().has_value());
+
+        mqtt_sn::CompactMessage assigned(mqtt_sn::Message(make_publish(6, 200)));
+        assigned = moved;
+        REQUIRE(assigned.frame() == frame);
+        assigned = std::move(moved);
+        REQUIRE(assigned.frame() == frame);
+        REQUIRE(moved.empty());
+
+        assigned = assigned;
+        REQUIRE(assigned.frame() == frame);
+    }
+
+    std::vector<mqtt_sn::CompactMessage> queue;
+    for (uint16_t i = 0; i < 100; ++i) {
+        queue.emplace_back(mqtt_sn::Message(make_publish(i, i)));
+    }
+    for (uint16_t i = 0; i < 100; ++i) {
+        auto message = std::get<mqtt_sn::PublishMessageView>(*queue[i].view());
+        REQUIRE(message.message_id == i);
+        REQUIRE(message.payload.size() == i);
+    }
+}
@@ -0,0 +1,373 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <netinet/in.h>
+
+#include <mqtt-sn/gateway.h>
+
+namespace {
+
+using mqtt_sn::gateway::Gateway;
+using mqtt_sn::net::Endpoint;
+using mqtt_sn::net::UdpEngine;
+
+mqtt_sn::gateway::Config make_config(size_t shards) {
+    mqtt_sn::gateway::Config config;
+    config.address = Endpoint::ipv4(INADDR_LOOPBACK, 0);
+    config.shards = shards;
+    config.pin_threads = false;
+    config.poll_interval_ms = 1;
+    config.engine.batch_size = 16;
+    return config;
+}
+
+/***
+ * A test client: an engine on an ephemeral port talking to the gateway.
+ */
+class Client {
+public:
+    explicit Client(const Endpoint& gateway) : _gateway(gateway), _engine([] {
+        UdpEngine::Config config;
+        config.batch_size = 16;
+        config.receive_timeout_ms = 1000;
+        return config;
+    }()) {
+        REQUIRE(_engine.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+    }
+
+    void send(const mqtt_sn::Message& message) {
+        REQUIRE(_engine.send(message, _gateway));
+        REQUIRE(_engine.flush() == 1);
+    }
+
+    /***
+     * The next message from the gateway, polling @p gateway's shards until one arrives.
+     */
+    mqtt_sn::Message receive(Gateway& gateway, uint32_t now = 0) {
+        if (_next == _engine.received()) {
+            for (int attempt = 0; attempt < 100 && !_engine.receive(false); ++attempt) {
+                for (size_t i = 0; i < gateway.shard_count(); ++i) {
+                    gateway.shard(i).poll(now, false);
+                }
+            }
+            REQUIRE(_engine.received() > 0);
+            _next = 0;
+        }
+
+        auto& datagram = _engine.datagrams()[_next++];
+        auto reader = mqtt_sn::format::BufferReader(datagram.data, datagram.size);
+        auto message = mqtt_sn::format::parse(reader);
+        REQUIRE(message.has_value());
+        return message.value();
+    }
+
+    void connect(Gateway& gateway, uint16_t duration = 60, const std::string& client_id = "client") {
+        mqtt_sn::Connect connect {};
+        connect.flags.clean_session = 1;
+        connect.protocol_version = 1;
+        connect.duration = duration;
+        connect.client_id = client_id;
+        send(connect);
+        auto ack = receive(gateway);
+        REQUIRE(std::get<mqtt_sn::ConnectAck>(ack).code == mqtt_sn::MessageErrorCode::Accepted);
+    }
+
+private:
+    Endpoint _gateway;
+    UdpEngine _engine;
+    size_t _next = 0;
+};
+
+size_t owner(Gateway& gateway, const std::vector<size_t>& before) {
+    for (size_t i = 0; i < gateway.shard_count(); ++i) {
+        if (gateway.shard(i).sessions() > before[i]) {
+            return i;
+        }
+    }
+    FAIL("no shard took the session");
+    return 0;
+}
+
+std::vector<size_t> sessions(Gateway& gateway) {
+    std::vector<size_t> counts;
+    for (size_t i = 0; i < gateway.shard_count(); ++i) {
+        counts.push_back(gateway.shard(i).sessions());
+    }
+    return counts;
+}
+
+}
+
+TEST_CASE("Gateway shards fan PUBLISHes out to subscribers on every shard", "[gateway]") {
+    Gateway gateway(make_config(2));
+    REQUIRE(gateway.open());
+    auto address = gateway.shard(0).engine().local_endpoint();
+    REQUIRE(gateway.shard(1).engine().local_endpoint().length == address.length);
+
+    Client subscriber(address);
+    auto before = sessions(gateway);
+    subscriber.connect(gateway);
+    auto subscriber_shard = owner(gateway, before);
+
+    mqtt_sn::Subscribe subscribe {};
+    subscribe.message_id = 1;
+    subscribe.topic = std::string("sensors/+/temp");
+    subscriber.send(subscribe);
+    auto subscribe_ack = std::get<mqtt_sn::SubscribeAck>(subscriber.receive(gateway));
+    REQUIRE(subscribe_ack.code == mqtt_sn::MessageErrorCode::Accepted);
+    REQUIRE(subscribe_ack.message_id == 1);
+
+    // Find publishers the kernel steers to either shard, so both paths are covered.
+    std::vector<std::unique_ptr<Client>> publishers(2);
+    for (int attempt = 0; attempt < 64 && (!publishers[0] || !publishers[1]); ++attempt) {
+        auto publisher = std::make_unique<Client>(address);
+        before = sessions(gateway);
+        publisher->connect(gateway);
+        auto local = owner(gateway, before) == subscriber_shard ? 0 : 1;
+        if (!publishers[local]) {
+            publishers[local] = std::move(publisher);
+        }
+    }
+    REQUIRE(publishers[0]);
+    REQUIRE(publishers[1]);
+
+    for (uint16_t i = 0; i < 2; ++i) {
+        auto& publisher = *publishers[i];
+        mqtt_sn::RegisterTopic register_topic {0, 10, "sensors/kitchen/temp"};
+        publisher.send(register_topic);
+        auto register_ack = std::get<mqtt_sn::RegisterTopicAck>(publisher.receive(gateway));
+        REQUIRE(register_ack.code == mqtt_sn::MessageErrorCode::Accepted);
+
+        mqtt_sn::PublishMessage publish {};
+        publish.flags.qos = 1;
+        publish.topic_id = register_ack.topic_id;
+        publish.message_id = static_cast<uint16_t>(20 + i);
+        publish.payload = {0x32, 0x31, static_cast<uint8_t>(i)};
+        publisher.send(publish);
+        auto publish_ack = std::get<mqtt_sn::PublishMessageAck>(publisher.receive(gateway));
+        REQUIRE(publish_ack.code == mqtt_sn::MessageErrorCode::Accepted);
+        REQUIRE(publish_ack.message_id == 20 + i);
+
+        // The subscriber learns the topic id on the first delivery.
+        if (i == 0) {
+            auto registered = std::get<mqtt_sn::RegisterTopic>(subscriber.receive(gateway));
+            REQUIRE(registered.topic == "sensors/kitchen/temp");
+        }
+        auto delivered = std::get<mqtt_sn::PublishMessage>(subscriber.receive(gateway));
+        REQUIRE(delivered.flags.qos == 0);
+        REQUIRE(delivered.payload == publish.payload);
+    }
+
+    auto& remote = gateway.shard(1 - subscriber_shard);
+    REQUIRE(remote.stats().forwarded >= 1);
+    REQUIRE(gateway.shard(subscriber_shard).stats().delivered == 2);
+}
+
+TEST_CASE("Gateway shards answer clients behind a forwarder", "[gateway]") {
+    Gateway gateway(make_config(1));
+    REQUIRE(gateway.open());
+    Client forwarder(gateway.shard(0).engine().local_endpoint());
+
+    mqtt_sn::Connect connect {};
+    connect.duration = 60;
+    connect.client_id = "node";
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(connect, frame);
+
+    mqtt_sn::Forward forward {};
+    forward.gateway_addr = {0xAB, 0xCD};
+    forward.payload.assign(frame.data(), frame.data() + frame.size());
+    forwarder.send(forward);
+
+    auto reply = std::get<mqtt_sn::Forward>(forwarder.receive(gateway));
+    REQUIRE(reply.gateway_addr == forward.gateway_addr);
+    auto reader = mqtt_sn::format::BufferReader(reply.payload.data(), reply.payload.size());
+    auto ack = mqtt_sn::format::parse(reader);
+    REQUIRE(ack.has_value());
+    REQUIRE(std::get<mqtt_sn::ConnectAck>(ack.value()).code == mqtt_sn::MessageErrorCode::Accepted);
+    REQUIRE(gateway.shard(0).sessions() == 1);
+}
+
+TEST_CASE("Gateway shards drop sessions that stop sending", "[gateway]") {
+    auto config = make_config(1);
+    mqtt_sn::gateway::Shard shard(0, config, 1000);
+    REQUIRE(shard.open(config.address));
+
+    Client client(shard.engine().local_endpoint());
+    mqtt_sn::Connect connect {};
+    connect.duration = 1;
+    connect.client_id = "sleepy";
+    client.send(connect);
+    REQUIRE(shard.poll(1000) == 1);
+    REQUIRE(shard.sessions() == 1);
+
+    client.send(mqtt_sn::PingRequest {});
+    REQUIRE(shard.poll(1500) == 1);
+    REQUIRE(shard.sessions() == 1);
+
+    // 150% of 1 s after the PINGREQ.
+    shard.poll(2999, false);
+    REQUIRE(shard.sessions() == 1);
+    shard.poll(3001, false);
+    REQUIRE(shard.sessions() == 0);
+}
+
+TEST_CASE("Gateway shards free the sessions of refused and departing clients", "[gateway]") {
+    auto config = make_config(1);
+    config.idle_duration = 2;
+    mqtt_sn::gateway::Shard shard(0, config, 1000);
+    REQUIRE(shard.open(config.address));
+    Client client(shard.engine().local_endpoint());
+
+    mqtt_sn::Connect connect {};
+    connect.duration = 60;
+    connect.client_id = "client";
+
+    SECTION("a CONNECT with a will") {
+        connect.flags.will = 1;
+        client.send(connect);
+        REQUIRE(shard.poll(1000) == 1);
+        REQUIRE(shard.sessions() == 0);
+    }
+
+    SECTION("a DISCONNECT with a duration of 0") {
+        client.send(connect);
+        REQUIRE(shard.poll(1000) == 1);
+        REQUIRE(shard.sessions() == 1);
+
+        client.send(mqtt_sn::Disconnect {0});
+        REQUIRE(shard.poll(1000) == 1);
+        REQUIRE(shard.sessions() == 0);
+    }
+
+    SECTION("a CONNECT without keep-alive") {
+        connect.duration = 0;
+        client.send(connect);
+        REQUIRE(shard.poll(1000) == 1);
+        REQUIRE(shard.sessions() == 1);
+
+        // 150% of idle_duration.
+        shard.poll(3999, false);
+        REQUIRE(shard.sessions() == 1);
+        shard.poll(4001, false);
+        REQUIRE(shard.sessions() == 0);
+    }
+}
+
+TEST_CASE("Gateway shards release topic ids with the sessions holding them", "[gateway]") {
+    auto config = make_config(1);
+    config.max_session_topics = 2;
+    Gateway gateway(config);
+    REQUIRE(gateway.open());
+    auto address = gateway.shard(0).engine().local_endpoint();
+
+    Client first(address);
+    first.connect(gateway, 60, "first");
+    first.send(mqtt_sn::RegisterTopic {0, 1, "a"});
+    auto a = std::get<mqtt_sn::RegisterTopicAck>(first.receive(gateway));
+    first.send(mqtt_sn::RegisterTopic {0, 2, "b"});
+    auto b = std::get<mqtt_sn::RegisterTopicAck>(first.receive(gateway));
+    REQUIRE(a.code == mqtt_sn::MessageErrorCode::Accepted);
+    REQUIRE(b.code == mqtt_sn::MessageErrorCode::Accepted);
+
+    // Over the limit, though what the session already holds is still answered.
+    first.send(mqtt_sn::RegisterTopic {0, 3, "c"});
+    REQUIRE(std::get<mqtt_sn::RegisterTopicAck>(first.receive(gateway)).code == mqtt_sn::MessageErrorCode::Congestion);
+    first.send(mqtt_sn::RegisterTopic {0, 4, "a"});
+    REQUIRE(std::get<mqtt_sn::RegisterTopicAck>(first.receive(gateway)).topic_id == a.topic_id);
+
+    Client second(address);
+    second.connect(gateway, 60, "second");
+    second.send(mqtt_sn::RegisterTopic {0, 1, "a"});
+    REQUIRE(std::get<mqtt_sn::RegisterTopicAck>(second.receive(gateway)).topic_id == a.topic_id);
+
+    first.send(mqtt_sn::Disconnect {});
+    REQUIRE(std::holds_alternative<mqtt_sn::Disconnect>(first.receive(gateway)));
+    REQUIRE(gateway.shard(0).sessions() == 1);
+
+    // "a" is still held by the second client; "b" was released and its id is handed out again.
+    mqtt_sn::PublishMessage publish {};
+    publish.flags.qos = 1;
+    publish.topic_id = a.topic_id;
+    publish.message_id = 2;
+    second.send(publish);
+    REQUIRE(std::get<mqtt_sn::PublishMessageAck>(second.receive(gateway)).code == mqtt_sn::MessageErrorCode::Accepted);
+    second.send(mqtt_sn::RegisterTopic {0, 3, "d"});
+    REQUIRE(std::get<mqtt_sn::RegisterTopicAck>(second.receive(gateway)).topic_id == b.topic_id);
+}
+
+TEST_CASE("Gateway shards hold deliveries for sleeping clients", "[gateway]") {
+    Gateway gateway(make_config(1));
+    REQUIRE(gateway.open());
+    auto address = gateway.shard(0).engine().local_endpoint();
+
+    Client sleeper(address);
+    sleeper.connect(gateway, 60, "sleeper");
+    mqtt_sn::Subscribe subscribe {};
+    subscribe.message_id = 1;
+    subscribe.topic = std::string("sensors/#");
+    sleeper.send(subscribe);
+    REQUIRE(std::get<mqtt_sn::SubscribeAck>(sleeper.receive(gateway)).code == mqtt_sn::MessageErrorCode::Accepted);
+    sleeper.send(mqtt_sn::Disconnect {600});
+    REQUIRE(std::holds_alternative<mqtt_sn::Disconnect>(sleeper.receive(gateway)));
+
+    Client publisher(address);
+    publisher.connect(gateway, 60, "publisher");
+    publisher.send(mqtt_sn::RegisterTopic {0, 1, "sensors/door"});
+    auto register_ack = std::get<mqtt_sn::RegisterTopicAck>(publisher.receive(gateway));
+
+    mqtt_sn::PublishMessage publish {};
+    publish.flags.qos = 1;
+    publish.topic_id = register_ack.topic_id;
+    publish.message_id = 2;
+    publish.payload = {1, 2, 3};
+    publisher.send(publish);
+    REQUIRE(std::get<mqtt_sn::PublishMessageAck>(publisher.receive(gateway)).code == mqtt_sn::MessageErrorCode::Accepted);
+    REQUIRE(gateway.shard(0).stats().buffered == 1);
+    REQUIRE(gateway.shard(0).stats().delivered == 0);
+
+    // Another client cannot check in on the sleeper's behalf.
+    publisher.send(mqtt_sn::PingRequest {std::string("sleeper")});
+    int handled = 0;
+    for (int attempt = 0; attempt < 100 && handled == 0; ++attempt) {
+        handled = gateway.shard(0).poll(0, false);
+    }
+    REQUIRE(handled == 1);
+    REQUIRE(gateway.shard(0).stats().delivered == 0);
+
+    // Checking in, the client gets what was held for it and then the PINGRESP.
+    sleeper.send(mqtt_sn::PingRequest {std::string("sleeper")});
+    REQUIRE(std::get<mqtt_sn::RegisterTopic>(sleeper.receive(gateway)).topic == "sensors/door");
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(sleeper.receive(gateway)).payload == publish.payload);
+    REQUIRE(std::holds_alternative<mqtt_sn::PingResponse>(sleeper.receive(gateway)));
+    REQUIRE(gateway.shard(0).stats().delivered == 1);
+}
+
+TEST_CASE("Gateway runs a thread per shard", "[gateway]") {
+    auto config = make_config(2);
+    Gateway gateway(config);
+    REQUIRE(gateway.open());
+    gateway.start();
+
+    UdpEngine::Config client_config;
+    client_config.receive_timeout_ms = 2000;
+    UdpEngine client(client_config);
+    REQUIRE(client.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+
+    mqtt_sn::Connect connect {};
+    connect.duration = 60;
+    connect.client_id = "threaded";
+    REQUIRE(client.send(connect, gateway.shard(0).engine().local_endpoint()));
+    REQUIRE(client.flush() == 1);
+    REQUIRE(client.receive() == 1);
+
+    auto reader = mqtt_sn::format::BufferReader(client.datagrams()[0].data, client.datagrams()[0].size);
+    auto ack = mqtt_sn::format::parse(reader);
+    REQUIRE(ack.has_value());
+    REQUIRE(std::holds_alternative<mqtt_sn::ConnectAck>(ack.value()));
+
+    gateway.stop();
+}
@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include <mqtt-sn/inflight_window.h>
+
+namespace {
+
+mqtt_sn::PublishMessage make_publish(uint16_t message_id, uint8_t qos) {
+    mqtt_sn::PublishMessage message {};
+    message.flags.qos = qos;
+    message.topic_id = 1;
+    message.message_id = message_id;
+    message.payload = {1, 2, 3};
+    return message;
+}
+
+struct Event {
+    mqtt_sn::InflightWindow::Event event;
+    uint16_t message_id;
+    std::vector<uint8_t> frame;
+};
+
+std::vector<Event> poll(mqtt_sn::InflightWindow& window, uint32_t now) {
+    std::vector<Event> events;
+    window.poll(now, [&](mqtt_sn::InflightWindow::Event event, uint16_t message_id, mqtt_sn::ByteView frame) {
+        events.push_back({event, message_id, std::vector<uint8_t>(frame.begin(), frame.end())});
+    });
+    return events;
+}
+
+}
+
+TEST_CASE("InflightWindow QoS 1", "[inflight_window]") {
+    mqtt_sn::InflightWindow window({8, 64, 10, 2});
+
+    auto frame = window.publish(make_publish(1, 1), 0);
+    REQUIRE(frame.has_value());
+
+    mqtt_sn::format::BufferWriter expected;
+    mqtt_sn::format::encode(make_publish(1, 1), expected);
+    REQUIRE(std::vector<uint8_t>(frame->begin(), frame->end()) == expected);
+    REQUIRE(window.state(1) == mqtt_sn::InflightWindow::State::AwaitAck);
+    REQUIRE(window.size() == 1);
+
+    REQUIRE_FALSE(window.publish(make_publish(9, 1), 0).has_value()); // same slot as 1
+    REQUIRE_FALSE(window.publish(make_publish(2, 0), 0).has_value());
+
+    REQUIRE_FALSE(window.on_ack({1, 2, mqtt_sn::MessageErrorCode::Accepted}));
+    REQUIRE(window.on_ack({1, 1, mqtt_sn::MessageErrorCode::Accepted}));
+    REQUIRE(window.size() == 0);
+    REQUIRE(window.state(1) == mqtt_sn::InflightWindow::State::Free);
+    REQUIRE(poll(window, 100).empty());
+}
+
+TEST_CASE("InflightWindow QoS 2", "[inflight_window]") {
+    mqtt_sn::InflightWindow window({8, 64, 10, 2});
+    REQUIRE(window.publish(make_publish(3, 2), 0).has_value());
+    REQUIRE(window.state(3) == mqtt_sn::InflightWindow::State::AwaitReceived);
+
+    auto release = window.on_received({3}, 5);
+    REQUIRE(release.has_value());
+    REQUIRE(std::vector<uint8_t>(release->begin(), release->end()) == std::vector<uint8_t> {4, 0x10, 0, 3});
+    REQUIRE(window.state(3) == mqtt_sn::InflightWindow::State::AwaitComplete);
+    REQUIRE(window.on_received({3}, 6).has_value());
+
+    REQUIRE(window.on_complete({3}));
+    REQUIRE_FALSE(window.on_complete({3}));
+    REQUIRE(window.size() == 0);
+}
+
+TEST_CASE("InflightWindow retransmits", "[inflight_window]") {
+    mqtt_sn::InflightWindow window({8, 64, 10, 2});
+    REQUIRE(window.publish(make_publish(1, 1), 0).has_value());
+    REQUIRE(window.publish(make_publish(2, 2), 5).has_value());
+    REQUIRE(window.on_received({2}, 5).has_value());
+
+    REQUIRE(poll(window, 9).empty());
+
+    auto events = poll(window, 10);
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].event == mqtt_sn::InflightWindow::Event::Retransmit);
+    REQUIRE(events[0].message_id == 1);
+
+    auto reader = mqtt_sn::format::BufferReader(events[0].frame.data(), events[0].frame.size());
+    auto message = mqtt_sn::format::parse(reader);
+    REQUIRE(message.has_value());
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(message.value()).flags.dup == 1);
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(message.value()).payload == std::vector<uint8_t> {1, 2, 3});
+
+    events = poll(window, 15);
+    REQUIRE(events.size() == 1);
+    REQUIRE(events[0].message_id == 2);
+    REQUIRE(events[0].frame == std::vector<uint8_t> {4, 0x10, 0, 2});
+
+    REQUIRE(poll(window, 20).size() == 1);
+    REQUIRE(poll(window, 25).size() == 1);
+
+    events = poll(window, 1000);
+    REQUIRE(events.size() == 2);
+    REQUIRE(events[0].event == mqtt_sn::InflightWindow::Event::Expired);
+    REQUIRE(events[1].event == mqtt_sn::InflightWindow::Event::Expired);
+    REQUIRE(window.size() == 0);
+}
+
+TEST_CASE("InflightWindow deadlines behind the wheel", "[inflight_window]") {
+    SECTION("retry_interval 0 retransmits on the next tick") {
+        mqtt_sn::InflightWindow window({8, 64, 0, 2});
+        REQUIRE(window.publish(make_publish(1, 1), 0).has_value());
+
+        REQUIRE(poll(window, 0).empty());
+        REQUIRE(poll(window, 1).size() == 1);
+        REQUIRE(poll(window, 2).size() == 1);
+
+        auto events = poll(window, 3);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].event == mqtt_sn::InflightWindow::Event::Expired);
+    }
+
+    SECTION("a clock behind the last poll") {
+        mqtt_sn::InflightWindow window({8, 64, 10, 2});
+        REQUIRE(window.publish(make_publish(1, 1), 0).has_value());
+        REQUIRE(poll(window, 100).size() == 1);
+
+        // Due at 60, a bucket the wheel has gone past; it is retransmitted on the next tick.
+        REQUIRE(window.publish(make_publish(2, 1), 50).has_value());
+        auto events = poll(window, 101);
+        REQUIRE(events.size() == 1);
+        REQUIRE(events[0].message_id == 2);
+    }
+}
@@ -0,0 +1,81 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <utility>
+#include <vector>
+
+#include <mqtt-sn/keep_alive.h>
+
+TEST_CASE("KeepAlive", "[keep_alive]") {
+    mqtt_sn::KeepAlive keep_alive({1000, 150});
+    std::vector<std::pair<mqtt_sn::ClientId, mqtt_sn::KeepAlive::Expiry>> expired;
+    const auto record = [&](mqtt_sn::ClientId client, mqtt_sn::KeepAlive::Expiry expiry) {
+        expired.emplace_back(client, expiry);
+    };
+
+    mqtt_sn::Connect connect {};
+    connect.duration = 10;
+    keep_alive.on_connect(1, connect, 0);
+    keep_alive.on_connect(2, connect, 0);
+    keep_alive.on_connect(3, connect, 0);
+    REQUIRE(keep_alive.size() == 3);
+
+    keep_alive.on_message(1, 10000);
+    keep_alive.on_disconnect(2, mqtt_sn::Disconnect {60}, 10000);
+    keep_alive.on_disconnect(3, mqtt_sn::Disconnect {}, 10000);
+    REQUIRE(keep_alive.asleep(2));
+    REQUIRE_FALSE(keep_alive.tracked(3));
+
+    REQUIRE(keep_alive.advance(24999, record) == 0);
+    REQUIRE(keep_alive.advance(25000, record) == 1);
+    REQUIRE(expired.back() == std::make_pair(mqtt_sn::ClientId(1), mqtt_sn::KeepAlive::Expiry::KeepAlive));
+    REQUIRE_FALSE(keep_alive.tracked(1));
+
+    keep_alive.on_ping(2, mqtt_sn::PingRequest {std::string("client-2")}, 50000);
+    REQUIRE(keep_alive.advance(50000 + 89999, record) == 0);
+    REQUIRE(keep_alive.advance(50000 + 90000, record) == 1);
+    REQUIRE(expired.back() == std::make_pair(mqtt_sn::ClientId(2), mqtt_sn::KeepAlive::Expiry::Sleep));
+    REQUIRE(keep_alive.size() == 0);
+}
+
+TEST_CASE("KeepAlive ping", "[keep_alive]") {
+    mqtt_sn::KeepAlive keep_alive({1000, 150});
+    std::vector<std::pair<mqtt_sn::ClientId, mqtt_sn::KeepAlive::Expiry>> expired;
+    const auto record = [&](mqtt_sn::ClientId client, mqtt_sn::KeepAlive::Expiry expiry) {
+        expired.emplace_back(client, expiry);
+    };
+
+    mqtt_sn::Connect connect {};
+    connect.duration = 10;
+    connect.client_id = "sensor-1";
+    keep_alive.on_connect(1, connect, 0);
+
+    SECTION("refreshes the deadline") {
+        REQUIRE(keep_alive.on_ping(1, mqtt_sn::PingRequest {}, 10000) == mqtt_sn::ClientId(1));
+        REQUIRE(keep_alive.advance(24999, record) == 0);
+        REQUIRE(keep_alive.advance(25000, record) == 1);
+        REQUIRE(expired.back() == std::make_pair(mqtt_sn::ClientId(1), mqtt_sn::KeepAlive::Expiry::KeepAlive));
+
+        REQUIRE_FALSE(keep_alive.on_ping(1, mqtt_sn::PingRequest {}, 30000).has_value());
+    }
+
+    SECTION("is matched by client id") {
+        keep_alive.on_disconnect(1, mqtt_sn::Disconnect {60}, 0);
+        REQUIRE(keep_alive.asleep(1));
+
+        // The sleeping client wakes up and checks in from an address mapped to another slot.
+        mqtt_sn::PingRequestView ping {std::string_view("sensor-1")};
+        REQUIRE(keep_alive.on_ping(7, ping, 50000) == mqtt_sn::ClientId(1));
+        REQUIRE(keep_alive.advance(50000 + 89999, record) == 0);
+        REQUIRE(keep_alive.advance(50000 + 90000, record) == 1);
+        REQUIRE(expired.back() == std::make_pair(mqtt_sn::ClientId(1), mqtt_sn::KeepAlive::Expiry::Sleep));
+
+        // Once the client has expired its id no longer matches.
+        REQUIRE_FALSE(keep_alive.on_ping(7, ping, 150000).has_value());
+    }
+
+    SECTION("follows the latest CONNECT with a client id") {
+        keep_alive.on_connect(2, connect, 0);
+        keep_alive.remove(1);
+        REQUIRE(keep_alive.on_ping(7, mqtt_sn::PingRequest {std::string("sensor-1")}, 1000) == mqtt_sn::ClientId(2));
+    }
+}
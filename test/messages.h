@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mqtt-sn/format.h>
+
+namespace mqtt_sn::fixtures {
+
+inline MessageFlags topic_flags(TopicIdType type) {
+    MessageFlags flags {};
+    flags.topic_id_type = static_cast<uint8_t>(type);
+    return flags;
+}
+
+inline MessageFlags clean_session() {
+    MessageFlags flags {};
+    flags.clean_session = true;
+    return flags;
+}
+
+/***
+ * One message of every type, by name, with the fields of the format test cases. test/test.cc
+ * round-trips each of them and fuzz/seeds.cc writes them out as the seed corpus, so a message
+ * added here is covered by both.
+ */
+inline std::vector<std::pair<std::string, Message>> messages() {
+    const std::vector<uint8_t> bytes {1, 2, 3};
+
+    return {
+        {"advertise", Advertise {1, 2}},
+        {"search_gateway", SearchGateway {1}},
+        {"gateway_info", GatewayInfo {1, std::nullopt}},
+        {"gateway_info2", GatewayInfo {1, bytes}},
+        {"connect", Connect {clean_session(), 1, 2, "foo"}},
+        {"connect_ack", ConnectAck {MessageErrorCode::Accepted}},
+        {"will_topic_request", WillTopicRequest {}},
+        {"will_topic_empty", WillTopicEmpty {}},
+        {"will_topic", WillTopic {{}, "foo"}},
+        {"will_message_request", WillMessageRequest {}},
+        {"will_message", WillMessage {bytes}},
+        {"will_topic_update_empty", WillTopicUpdateEmpty {}},
+        {"will_topic_update", WillTopicUpdate {{}, "foo"}},
+        {"will_topic_response", WillTopicResponse {MessageErrorCode::Accepted}},
+        {"will_message_update", WillMessageUpdate {bytes}},
+        {"will_message_response", WillMessageResponse {MessageErrorCode::Accepted}},
+        {"register_topic", RegisterTopic {1, 2, "foo"}},
+        {"register_topic_ack", RegisterTopicAck {1, 2, MessageErrorCode::Accepted}},
+        {"publish_message", PublishMessage {{}, 1, 2, bytes}},
+        {"publish_message_long", PublishMessage {{}, 1, 2, std::vector<uint8_t>(300, 0x5A)}},
+        {"publish_message_ack", PublishMessageAck {1, 2, MessageErrorCode::Accepted}},
+        {"publish_message_complete", PublishMessageComplete {1}},
+        {"publish_message_received", PublishMessageReceived {1}},
+        {"publish_message_release", PublishMessageRelease {1}},
+        {"subscribe", Subscribe {topic_flags(TopicIdType::Normal), 1, std::string("foo")}},
+        {"subscribe2", Subscribe {topic_flags(TopicIdType::PreDefined), 1, uint16_t(2)}},
+        {"subscribe3", Subscribe {topic_flags(TopicIdType::Short), 1, uint16_t(0x7474)}},
+        {"subscribe_ack", SubscribeAck {{}, 1, 2, MessageErrorCode::Accepted}},
+        {"unsubscribe", Unsubscribe {topic_flags(TopicIdType::Normal), 1, std::string("foo")}},
+        {"unsubscribe2", Unsubscribe {topic_flags(TopicIdType::PreDefined), 1, uint16_t(2)}},
+        {"unsubscribe_ack", UnsubscribeAck {1}},
+        {"ping_request", PingRequest {}},
+        {"ping_request2", PingRequest {"foo"}},
+        {"ping_response", PingResponse {}},
+        {"disconnect", Disconnect {}},
+        {"disconnect2", Disconnect {1}},
+        {"forward", Forward {1 & FORWARD_CTRL_RADIUS_MASK, bytes, {3, 0x01, 2}}},
+    };
+}
+
+}
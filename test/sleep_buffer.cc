@@ -0,0 +1,101 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <vector>
+
+#include <mqtt-sn/sleep_buffer.h>
+
+namespace {
+
+mqtt_sn::PublishMessage make_publish(uint16_t message_id, size_t payload_size) {
+    mqtt_sn::PublishMessage message {};
+    message.topic_id = 1;
+    message.message_id = message_id;
+    message.payload.assign(payload_size, static_cast<uint8_t>(message_id));
+    return message;
+}
+
+std::vector<uint16_t> drain(mqtt_sn::SleepBuffer& buffer) {
+    std::vector<uint16_t> message_ids;
+    buffer.drain([&](mqtt_sn::ByteView frame) {
+        auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+        auto message = mqtt_sn::format::parse(reader);
+        REQUIRE(message.has_value());
+        REQUIRE(reader.readable_bytes() == 0);
+        message_ids.push_back(std::get<mqtt_sn::PublishMessage>(message.value()).message_id);
+    });
+    return message_ids;
+}
+
+}
+
+TEST_CASE("SleepBuffer queues frames in order", "[sleep_buffer]") {
+    mqtt_sn::SleepBuffer buffer({100, mqtt_sn::SleepBuffer::DropPolicy::DropNewest});
+    REQUIRE(buffer.push(make_publish(1, 20)));  // 27 bytes each
+    REQUIRE(buffer.push(make_publish(2, 20)));
+
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(make_publish(3, 20), frame);
+    REQUIRE(buffer.push(mqtt_sn::ByteView(frame.data(), frame.size())));
+    REQUIRE(buffer.size() == 3);
+    REQUIRE(buffer.bytes() == 81);
+
+    REQUIRE_FALSE(buffer.push(make_publish(4, 20)));
+    REQUIRE(buffer.dropped() == 1);
+    REQUIRE(drain(buffer) == std::vector<uint16_t> {1, 2, 3});
+    REQUIRE(buffer.empty());
+    REQUIRE(buffer.bytes() == 0);
+}
+
+TEST_CASE("SleepBuffer drops the oldest frames", "[sleep_buffer]") {
+    mqtt_sn::SleepBuffer buffer({100, mqtt_sn::SleepBuffer::DropPolicy::DropOldest});
+    for (uint16_t id = 1; id <= 10; ++id) {
+        REQUIRE(buffer.push(make_publish(id, 20)));
+    }
+    REQUIRE(buffer.size() == 3);
+    REQUIRE(buffer.dropped() == 7);
+    REQUIRE(drain(buffer) == std::vector<uint16_t> {8, 9, 10});
+
+    REQUIRE_FALSE(buffer.push(make_publish(11, 200)));
+}
+
+TEST_CASE("SleepBuffer wraps around", "[sleep_buffer]") {
+    mqtt_sn::SleepBuffer buffer({100, mqtt_sn::SleepBuffer::DropPolicy::DropNewest});
+    REQUIRE(buffer.push(make_publish(1, 30)));   // 37 bytes
+    REQUIRE(buffer.push(make_publish(2, 30)));
+    buffer.pop();
+
+    REQUIRE(buffer.push(make_publish(3, 30)));   // wraps to the start
+    REQUIRE_FALSE(buffer.push(make_publish(4, 30)));
+    REQUIRE(buffer.front().size() == 37);
+    buffer.pop();
+    REQUIRE(buffer.push(make_publish(5, 20)));
+
+    REQUIRE(drain(buffer) == std::vector<uint16_t> {3, 5});
+
+    buffer.reset();
+    REQUIRE(buffer.empty());
+    REQUIRE(buffer.push(make_publish(6, 90)));
+    REQUIRE(drain(buffer) == std::vector<uint16_t> {6});
+}
+
+TEST_CASE("SleepBuffer rejects bytes that are not one frame", "[sleep_buffer]") {
+    mqtt_sn::SleepBuffer buffer({100, mqtt_sn::SleepBuffer::DropPolicy::DropNewest});
+
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(make_publish(1, 20), frame);
+    mqtt_sn::format::encode(make_publish(2, 20), frame);
+
+    REQUIRE_FALSE(buffer.push(mqtt_sn::ByteView()));
+    REQUIRE_FALSE(buffer.push(mqtt_sn::ByteView(frame.data(), 26)));        // truncated
+    REQUIRE_FALSE(buffer.push(mqtt_sn::ByteView(frame.data(), 28)));        // trailing byte
+    REQUIRE_FALSE(buffer.push(mqtt_sn::ByteView(frame.data(), frame.size())));
+
+    const uint8_t bad_length[] = {0, 0x0C, 0};
+    REQUIRE_FALSE(buffer.push(mqtt_sn::ByteView(bad_length, sizeof(bad_length))));
+    REQUIRE(buffer.empty());
+    REQUIRE(buffer.bytes() == 0);
+    REQUIRE(buffer.dropped() == 0);
+
+    REQUIRE(buffer.push(mqtt_sn::ByteView(frame.data() + 27, 27)));
+    REQUIRE(drain(buffer) == std::vector<uint16_t> {2});
+}
@@ -0,0 +1,120 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <cstring>
+#include <string>
+#include <thread>
+
+#include <mqtt-sn/spsc_ring.h>
+
+namespace {
+
+bool push(mqtt_sn::SpscByteRing& ring, const std::string& record) {
+    auto data = ring.try_reserve(record.size());
+    if (data == nullptr) {
+        return false;
+    }
+    std::memcpy(data, record.data(), record.size());
+    ring.commit();
+    return true;
+}
+
+std::string pop(mqtt_sn::SpscByteRing& ring) {
+    size_t size = 0;
+    auto data = ring.front(size);
+    REQUIRE(data != nullptr);
+    std::string record(reinterpret_cast<const char*>(data), size);
+    ring.pop();
+    return record;
+}
+
+}
+
+TEST_CASE("SpscByteRing is FIFO and bounded", "[spsc_ring]") {
+    mqtt_sn::SpscByteRing ring(30);
+    REQUIRE(ring.capacity() == 32);
+    REQUIRE(ring.max_record() == 12);
+    size_t size;
+    REQUIRE(ring.front(size) == nullptr);
+
+    // Each of these takes 8 bytes.
+    for (auto record : {"a", "bb", "ccc", "dddd"}) {
+        REQUIRE(push(ring, record));
+    }
+    REQUIRE_FALSE(push(ring, ""));
+    REQUIRE(ring.size() == 32);
+    REQUIRE(pop(ring) == "a");
+    REQUIRE(push(ring, ""));
+    for (auto record : {"bb", "ccc", "dddd", ""}) {
+        REQUIRE(pop(ring) == record);
+    }
+    REQUIRE(ring.size() == 0);
+
+    REQUIRE_FALSE(push(ring, std::string(13, 'x')));
+}
+
+TEST_CASE("SpscByteRing keeps records that reach the end whole", "[spsc_ring]") {
+    mqtt_sn::SpscByteRing ring(64);
+    REQUIRE(ring.max_record() == 28);
+    REQUIRE(push(ring, std::string(20, 'a')));     // 24 bytes
+    REQUIRE(push(ring, std::string(20, 'b')));
+    REQUIRE(pop(ring) == std::string(20, 'a'));
+
+    // 16 bytes are left at the end, so the record goes to the start, before the b's.
+    REQUIRE(push(ring, std::string(20, 'c')));
+    REQUIRE_FALSE(push(ring, "d"));
+    REQUIRE(pop(ring) == std::string(20, 'b'));
+    REQUIRE(push(ring, "d"));
+    REQUIRE(pop(ring) == std::string(20, 'c'));
+    REQUIRE(pop(ring) == "d");
+    REQUIRE(ring.size() == 0);
+}
+
+TEST_CASE("SpscByteRing takes its largest record once drained, wherever it stopped", "[spsc_ring]") {
+    for (size_t size = 0; size <= 28; ++size) {
+        mqtt_sn::SpscByteRing ring(64);
+        REQUIRE(push(ring, std::string(size, 'a')));
+        REQUIRE(pop(ring) == std::string(size, 'a'));
+
+        auto largest = std::string(ring.max_record(), 'b');
+        REQUIRE(push(ring, largest));
+        REQUIRE(pop(ring) == largest);
+        REQUIRE_FALSE(push(ring, largest + 'b'));
+    }
+    REQUIRE(mqtt_sn::SpscByteRing(mqtt_sn::SpscByteRing::capacity_for(100)).max_record() >= 100);
+}
+
+TEST_CASE("SpscByteRing passes records between threads in order", "[spsc_ring]") {
+    constexpr uint32_t COUNT = 200000;
+    mqtt_sn::SpscByteRing ring(256);
+
+    // Record i holds i in its first 4 bytes, padded to a length that varies with i.
+    std::thread producer([&] {
+        for (uint32_t i = 0; i < COUNT;) {
+            auto size = sizeof(i) + i % 23;
+            if (auto data = ring.try_reserve(size)) {
+                std::memcpy(data, &i, sizeof(i));
+                ring.commit();
+                ++i;
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    });
+
+    uint32_t expected = 0;
+    bool ordered = true;
+    while (expected < COUNT) {
+        size_t size;
+        if (auto data = ring.front(size)) {
+            uint32_t value;
+            std::memcpy(&value, data, sizeof(value));
+            ordered = ordered && value == expected && size == sizeof(value) + expected % 23;
+            ring.pop();
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+    REQUIRE(ordered);
+}
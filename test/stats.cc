@@ -0,0 +1,91 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <thread>
+#include <vector>
+
+#include <mqtt-sn/stats.h>
+
+namespace stats = mqtt_sn::format::stats;
+
+namespace {
+
+uint64_t total(const stats::CycleHistogram& histogram) {
+    uint64_t sum = 0;
+    for (auto count : histogram) {
+        sum += count;
+    }
+    return sum;
+}
+
+}
+
+TEST_CASE("stats count decoded, encoded and malformed frames", "[stats]") {
+    auto before = stats::snapshot();
+
+    mqtt_sn::PublishMessage publish {};
+    publish.topic_id = 1;
+    publish.payload.assign(300, 0x55);
+
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(publish, frame);
+    mqtt_sn::format::encode(mqtt_sn::PingResponse {}, frame);
+
+    auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+    REQUIRE(mqtt_sn::format::parse(reader).has_value());
+    REQUIRE(mqtt_sn::format::parse_view(reader).has_value());
+
+    const uint8_t unknown[] = {2, 0x03};
+    reader = mqtt_sn::format::BufferReader(unknown, sizeof(unknown));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+
+    const uint8_t truncated[] = {9, 0x0C, 0, 0, 1};
+    reader = mqtt_sn::format::BufferReader(truncated, sizeof(truncated));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+
+    auto after = stats::snapshot();
+    if (!stats::enabled) {
+        REQUIRE(after[mqtt_sn::MessageType::Publish].decoded == 0);
+        REQUIRE(after.malformed_count(stats::Malformed::UnknownType) == 0);
+        return;
+    }
+
+    const auto& publish_before = before[mqtt_sn::MessageType::Publish];
+    const auto& publish_after = after[mqtt_sn::MessageType::Publish];
+    REQUIRE(publish_after.encoded - publish_before.encoded == 1);
+    REQUIRE(publish_after.encoded_bytes - publish_before.encoded_bytes == 309);
+    REQUIRE(publish_after.decoded - publish_before.decoded == 1);
+    REQUIRE(publish_after.decoded_bytes - publish_before.decoded_bytes == 309);
+    REQUIRE(after[mqtt_sn::MessageType::PingResponse].decoded - before[mqtt_sn::MessageType::PingResponse].decoded == 1);
+    REQUIRE(after.long_encoded - before.long_encoded == 1);
+    REQUIRE(after.long_decoded - before.long_decoded == 1);
+    REQUIRE(after.malformed_count(stats::Malformed::UnknownType) - before.malformed_count(stats::Malformed::UnknownType) == 1);
+    REQUIRE(after.malformed_count(stats::Malformed::Truncated) - before.malformed_count(stats::Malformed::Truncated) == 1);
+
+    if (stats::cycles_enabled) {
+        REQUIRE(total(after.decode_cycles) - total(before.decode_cycles) == 4);
+        REQUIRE(total(after.encode_cycles) - total(before.encode_cycles) == 2);
+    }
+}
+
+TEST_CASE("stats keep the counts of exited threads", "[stats]") {
+    auto before = stats::snapshot();
+
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([] {
+            mqtt_sn::format::BufferWriter frame;
+            for (int j = 0; j < 100; ++j) {
+                frame.clear();
+                mqtt_sn::format::encode(mqtt_sn::PingResponse {}, frame);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    auto after = stats::snapshot();
+    auto encoded = after[mqtt_sn::MessageType::PingResponse].encoded - before[mqtt_sn::MessageType::PingResponse].encoded;
+    REQUIRE(encoded == (stats::enabled ? 400 : 0));
+    REQUIRE(stats::name(stats::Malformed::TooShort) == "too_short");
+}
@@ -0,0 +1,112 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <vector>
+
+#include <mqtt-sn/subscription_index.h>
+
+namespace {
+
+std::vector<mqtt_sn::SubscriberId> match(const mqtt_sn::SubscriptionIndex& index, std::string_view topic) {
+    std::vector<mqtt_sn::SubscriberId> subscribers;
+    index.match(topic, subscribers);
+    return subscribers;
+}
+
+}
+
+TEST_CASE("SubscriptionIndex wildcards", "[subscription_index]") {
+    mqtt_sn::SubscriptionIndex index;
+    REQUIRE(index.subscribe(1, "sensors/kitchen/temperature"));
+    REQUIRE(index.subscribe(2, "sensors/+/temperature"));
+    REQUIRE(index.subscribe(3, "sensors/#"));
+    REQUIRE(index.subscribe(4, "#"));
+    REQUIRE(index.subscribe(5, "+/+"));
+    REQUIRE(index.subscribe(6, "sensors/+/temperature/#"));
+    REQUIRE(index.size() == 6);
+
+    using Ids = std::vector<mqtt_sn::SubscriberId>;
+    REQUIRE(match(index, "sensors/kitchen/temperature") == Ids {1, 2, 3, 4, 6});
+    REQUIRE(match(index, "sensors/hall/temperature") == Ids {2, 3, 4, 6});
+    REQUIRE(match(index, "sensors/hall") == Ids {3, 4, 5});
+    REQUIRE(match(index, "sensors") == Ids {3, 4});
+    REQUIRE(match(index, "sensors/") == Ids {3, 4, 5});
+    REQUIRE(match(index, "lights/a/b") == Ids {4});
+    REQUIRE(match(index, "$SYS/uptime").empty());
+    REQUIRE(match(index, "").empty());
+}
+
+TEST_CASE("SubscriptionIndex long topics", "[subscription_index]") {
+    mqtt_sn::SubscriptionIndex index;
+    std::string topic = "a";
+    for (int i = 0; i < 40; ++i) {
+        topic += "/level-" + std::to_string(i);
+    }
+    REQUIRE(index.subscribe(1, topic));
+    REQUIRE(index.subscribe(2, "a/+/level-1/#"));
+
+    REQUIRE(match(index, topic) == std::vector<mqtt_sn::SubscriberId> {1, 2});
+    REQUIRE(match(index, topic + "/more") == std::vector<mqtt_sn::SubscriberId> {2});
+}
+
+TEST_CASE("SubscriptionIndex rejects invalid filters", "[subscription_index]") {
+    mqtt_sn::SubscriptionIndex index;
+    REQUIRE_FALSE(index.subscribe(1, ""));
+    REQUIRE_FALSE(index.subscribe(1, "a/#/b"));
+    REQUIRE_FALSE(index.subscribe(1, "a/b#"));
+    REQUIRE_FALSE(index.subscribe(1, "a/+b"));
+    REQUIRE(index.size() == 0);
+}
+
+TEST_CASE("SubscriptionIndex unsubscribe", "[subscription_index]") {
+    mqtt_sn::SubscriptionIndex index;
+    REQUIRE(index.subscribe(1, "a/+/c"));
+    REQUIRE(index.subscribe(1, "a/+/c"));
+    REQUIRE(index.subscribe(2, "a/+/c"));
+    REQUIRE(index.subscribe(1, "a/#"));
+    REQUIRE(index.size() == 3);
+
+    REQUIRE(index.unsubscribe(1, "a/+/c"));
+    REQUIRE_FALSE(index.unsubscribe(1, "a/+/c"));
+    REQUIRE_FALSE(index.unsubscribe(1, "x/y"));
+    REQUIRE(match(index, "a/b/c") == std::vector<mqtt_sn::SubscriberId> {1, 2});
+
+    REQUIRE(index.unsubscribe(1, "a/#"));
+    REQUIRE(index.unsubscribe(2, "a/+/c"));
+    REQUIRE(index.size() == 0);
+    REQUIRE(match(index, "a/b/c").empty());
+}
+
+TEST_CASE("SubscriptionIndex from messages", "[subscription_index]") {
+    mqtt_sn::TopicRegistry registry;
+    auto topic_id = registry.register_topic("sensors/kitchen/temperature").value();
+
+    mqtt_sn::SubscriptionIndex index;
+
+    mqtt_sn::Subscribe by_name {};
+    by_name.topic = std::string("sensors/+/temperature");
+    REQUIRE(index.subscribe(1, by_name, registry));
+
+    mqtt_sn::Subscribe by_id {};
+    by_id.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::PreDefined);
+    by_id.topic = topic_id;
+    REQUIRE(index.subscribe(2, by_id, registry));
+
+    mqtt_sn::Subscribe short_name {};
+    short_name.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Short);
+    short_name.topic = uint16_t('a' << 8 | 'b');
+    REQUIRE(index.subscribe(3, short_name, registry));
+
+    std::vector<mqtt_sn::SubscriberId> subscribers;
+    index.match(topic_id, registry, subscribers);
+    REQUIRE(subscribers == std::vector<mqtt_sn::SubscriberId> {1, 2});
+    REQUIRE(match(index, "ab") == std::vector<mqtt_sn::SubscriberId> {3});
+
+    mqtt_sn::Unsubscribe unsubscribe {};
+    unsubscribe.topic = std::string("sensors/+/temperature");
+    REQUIRE(index.unsubscribe(1, unsubscribe, registry));
+
+    subscribers.clear();
+    index.match(topic_id, registry, subscribers);
+    REQUIRE(subscribers == std::vector<mqtt_sn::SubscriberId> {2});
+}
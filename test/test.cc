@@ -5,6 +5,8 @@
 
 #include <mqtt-sn/format.h>
 
+#include "messages.h"
+
 
 uint32_t factorial( uint32_t number ) {
     return number <= 1 ? number : factorial(number-1) * number;
@@ -537,7 +539,7 @@ TEST_CASE("Forward", "[format]") {
     mqtt_sn::Forward forward;
     forward.ctrl = 1 & mqtt_sn::FORWARD_CTRL_RADIUS_MASK;
     forward.gateway_addr = std::vector<uint8_t> {1, 2, 3};
-    forward.payload = std::vector<uint8_t> {1, 2, 3};
+    forward.payload = std::vector<uint8_t> {3, 0x01, 2}; // SearchGateway, radius 2
 
     mqtt_sn::format::BufferWriter buffer;
     mqtt_sn::format::encode(forward, buffer);
@@ -551,5 +553,821 @@ TEST_CASE("Forward", "[format]") {
     auto& forward_msg = std::get<mqtt_sn::Forward>(msg.value());
     REQUIRE(forward_msg.ctrl == 1);
     REQUIRE(forward_msg.gateway_addr == std::vector<uint8_t> {1, 2, 3});
-    REQUIRE(forward_msg.payload == std::vector<uint8_t> {1, 2, 3});
+    REQUIRE(forward_msg.payload == std::vector<uint8_t> {3, 0x01, 2});
+}
+TEST_CASE("fixtures round-trip", "[format]") {
+    for (const auto& [name, message] : mqtt_sn::fixtures::messages()) {
+        INFO(name);
+        mqtt_sn::format::BufferWriter buffer;
+        mqtt_sn::format::encode(message, buffer);
+
+        auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        auto msg = mqtt_sn::format::parse(reader);
+        REQUIRE(msg.has_value());
+        REQUIRE(msg->index() == message.index());
+        REQUIRE(reader.readable_bytes() == 0);
+
+        mqtt_sn::format::BufferWriter again;
+        mqtt_sn::format::encode(msg.value(), again);
+        REQUIRE(again == buffer);
+    }
+}
+
+TEST_CASE("PublishMessageView", "[format][view]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.flags.qos = 1;
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+    publish_message.payload = std::vector<uint8_t> {1, 2, 3};
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish_message, buffer);
+
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto msg = mqtt_sn::format::parse_view(reader);
+
+    REQUIRE(msg.has_value());
+    REQUIRE(std::holds_alternative<mqtt_sn::PublishMessageView>(msg.value()));
+
+    auto& view = std::get<mqtt_sn::PublishMessageView>(msg.value());
+    REQUIRE(view.flags.qos == 1);
+    REQUIRE(view.topic_id == 1);
+    REQUIRE(view.message_id == 2);
+    REQUIRE(view.payload.size() == 3);
+    REQUIRE(view.payload.data() == buffer.data() + 7);
+    REQUIRE(reader.readable_bytes() == 0);
+}
+
+TEST_CASE("PublishMessageView empty payload", "[format][view]") {
+    const uint8_t frame[] = {7, 0x0C, 0, 1, 0, 2, 0};
+
+    auto reader = mqtt_sn::format::BufferReader(frame, sizeof(frame));
+    auto msg = mqtt_sn::format::parse_view(reader);
+
+    REQUIRE(msg.has_value());
+    REQUIRE(std::get<mqtt_sn::PublishMessageView>(msg.value()).payload.empty());
+}
+
+TEST_CASE("ConnectView", "[format][view]") {
+    mqtt_sn::Connect connect;
+    connect.flags.clean_session = true;
+    connect.protocol_version = 1;
+    connect.duration = 2;
+    connect.client_id = "foo";
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(connect, buffer);
+
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto msg = mqtt_sn::format::parse_view(reader);
+
+    REQUIRE(msg.has_value());
+    REQUIRE(msg->index() == mqtt_sn::Message(connect).index());
+    REQUIRE(std::get<mqtt_sn::ConnectView>(msg.value()).client_id == "foo");
+    REQUIRE(std::get<mqtt_sn::ConnectView>(msg.value()).duration == 2);
+}
+
+TEST_CASE("SubscribeView", "[format][view]") {
+    mqtt_sn::Subscribe subscribe;
+    subscribe.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Normal);
+    subscribe.message_id = 1;
+    subscribe.topic = "foo/bar";
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(subscribe, buffer);
+
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto msg = mqtt_sn::format::parse_view(reader);
+
+    REQUIRE(msg.has_value());
+    auto& view = std::get<mqtt_sn::SubscribeView>(msg.value());
+    REQUIRE(std::get<std::string_view>(view.topic) == "foo/bar");
+}
+
+TEST_CASE("ForwardView", "[format][view]") {
+    mqtt_sn::Forward forward;
+    forward.ctrl = 1 & mqtt_sn::FORWARD_CTRL_RADIUS_MASK;
+    forward.gateway_addr = std::vector<uint8_t> {1, 2, 3};
+    forward.payload = std::vector<uint8_t> {3, 0x01, 2}; // SearchGateway, radius 2
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(forward, buffer);
+
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto msg = mqtt_sn::format::parse_view(reader);
+
+    REQUIRE(msg.has_value());
+    auto& view = std::get<mqtt_sn::ForwardView>(msg.value());
+    REQUIRE(view.ctrl == 1);
+    REQUIRE(view.gateway_addr.size() == 3);
+    REQUIRE(view.payload.size() == 3);
+}
+
+TEST_CASE("parse_view rejects truncated frames", "[format][view]") {
+    const uint8_t advertise[] = {2, 0x00};
+    auto reader = mqtt_sn::format::BufferReader(advertise, sizeof(advertise));
+    REQUIRE_FALSE(mqtt_sn::format::parse_view(reader).has_value());
+
+    const uint8_t publish[] = {9, 0x0C, 0, 0, 1};
+    reader = mqtt_sn::format::BufferReader(publish, sizeof(publish));
+    REQUIRE_FALSE(mqtt_sn::format::parse_view(reader).has_value());
+
+    const uint8_t unknown[] = {2, 0x03};
+    reader = mqtt_sn::format::BufferReader(unknown, sizeof(unknown));
+    REQUIRE_FALSE(mqtt_sn::format::parse_view(reader).has_value());
+}
+
+TEST_CASE("encoded_size", "[format][encode]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+
+    for (size_t payload_size : {0, 16, 248, 249, 250, 4096}) {
+        publish_message.payload.assign(payload_size, 0xAB);
+
+        mqtt_sn::format::BufferWriter buffer;
+        mqtt_sn::format::encode(publish_message, buffer);
+
+        REQUIRE(mqtt_sn::format::encoded_size(publish_message) == buffer.size());
+        REQUIRE(buffer.size() == mqtt_sn::format::frame_length(7 + payload_size));
+    }
+
+    REQUIRE(mqtt_sn::format::encoded_size(mqtt_sn::PingResponse {}) == 2);
+    REQUIRE(mqtt_sn::format::encoded_size(mqtt_sn::Advertise {1, 2}) == 5);
+    REQUIRE(mqtt_sn::format::frame_length(255) == 255);
+    REQUIRE(mqtt_sn::format::frame_length(256) == 258);
+}
+
+TEST_CASE("encode_into", "[format][encode]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+    publish_message.payload.assign(300, 0xAB);
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish_message, buffer);
+
+    std::vector<uint8_t> dst(512);
+    auto written = mqtt_sn::format::encode_into(publish_message, dst.data(), dst.size());
+    REQUIRE(written.has_value());
+    REQUIRE(written.value() == buffer.size());
+    REQUIRE(std::equal(buffer.begin(), buffer.end(), dst.begin()));
+
+    auto reader = mqtt_sn::format::BufferReader(dst.data(), written.value());
+    auto msg = mqtt_sn::format::parse(reader);
+    REQUIRE(msg.has_value());
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(msg.value()).payload == publish_message.payload);
+
+    REQUIRE_FALSE(mqtt_sn::format::encode_into(publish_message, dst.data(), buffer.size() - 1).has_value());
+}
+
+TEST_CASE("encode rejects frames longer than the length field", "[format][encode]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+
+    // 3-byte length, type, flags, topic id and message id take 9 bytes.
+    publish_message.payload.assign(mqtt_sn::format::MAX_FRAME_LENGTH - 9, 0xAB);
+    REQUIRE(mqtt_sn::format::encoded_size(publish_message) == mqtt_sn::format::MAX_FRAME_LENGTH);
+
+    publish_message.payload.push_back(0xAB);
+    REQUIRE_FALSE(mqtt_sn::format::encoded_size(publish_message).has_value());
+
+    std::vector<uint8_t> dst(mqtt_sn::format::MAX_FRAME_LENGTH * 2);
+    REQUIRE_FALSE(mqtt_sn::format::encode_into(publish_message, dst.data(), dst.size()).has_value());
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish_message, buffer);
+    REQUIRE(buffer.empty());
+
+    const mqtt_sn::Message message = publish_message;
+    REQUIRE(mqtt_sn::format::encode_header(message, dst.data()) == 0);
+}
+
+TEST_CASE("encode_header", "[format][encode]") {
+    const auto gather = [](const auto& message) {
+        std::vector<uint8_t> frame(mqtt_sn::format::header_size(message));
+        REQUIRE(mqtt_sn::format::encode_header(message, frame.data()) == frame.size());
+        auto payload = mqtt_sn::format::encoded_payload(message);
+        frame.insert(frame.end(), payload.begin(), payload.end());
+        return frame;
+    };
+
+    mqtt_sn::PublishMessage publish_message {};
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+    publish_message.payload.assign(1024, 0xAB);
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish_message, buffer);
+    const mqtt_sn::Message message = publish_message;
+    REQUIRE(mqtt_sn::format::header_size(message) == 9);
+    REQUIRE(mqtt_sn::format::encoded_payload(message).data() == std::get<mqtt_sn::PublishMessage>(message).payload.data());
+    REQUIRE(gather(message) == buffer);
+
+    buffer.clear();
+    mqtt_sn::format::encode(mqtt_sn::SubscribeAck {}, buffer);
+    REQUIRE(mqtt_sn::format::encoded_payload(mqtt_sn::Message(mqtt_sn::SubscribeAck {})).empty());
+    REQUIRE(gather(mqtt_sn::Message(mqtt_sn::SubscribeAck {})) == buffer);
+
+    mqtt_sn::Forward forward {};
+    forward.ctrl = 1;
+    forward.gateway_addr = {0x12, 0x34};
+    forward.payload.assign(buffer.begin(), buffer.end());
+
+    mqtt_sn::format::BufferWriter wrapped;
+    mqtt_sn::format::encode(forward, wrapped);
+    REQUIRE(gather(mqtt_sn::Message(forward)) == wrapped);
+
+    mqtt_sn::ForwardView forward_view {1, mqtt_sn::ByteView(forward.gateway_addr.data(), 2), mqtt_sn::ByteView(buffer.data(), buffer.size())};
+    REQUIRE(mqtt_sn::format::encoded_payload(forward_view).data() == buffer.data());
+    REQUIRE(gather(mqtt_sn::MessageView(forward_view)) == wrapped);
+}
+
+TEST_CASE("network byte order", "[format][encode]") {
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(mqtt_sn::Advertise {1, 0x0102}, buffer);
+    REQUIRE(buffer == std::vector<uint8_t> {5, 0x00, 1, 0x01, 0x02});
+
+    mqtt_sn::PublishMessage publish_message {};
+    publish_message.topic_id = 0x0304;
+    publish_message.message_id = 0x0506;
+    publish_message.payload.assign(300, 0xAB);
+
+    buffer.clear();
+    mqtt_sn::format::encode(publish_message, buffer);
+    REQUIRE(buffer.size() == 309);
+    REQUIRE(std::vector<uint8_t>(buffer.begin(), buffer.begin() + 9) == std::vector<uint8_t> {1, 0x01, 0x35, 0x0C, 0, 0x03, 0x04, 0x05, 0x06});
+
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto message = mqtt_sn::format::parse(reader);
+    REQUIRE(message.has_value());
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(message.value()).topic_id == 0x0304);
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(message.value()).message_id == 0x0506);
+    REQUIRE(mqtt_sn::format::frame_extent(buffer.data(), buffer.size()).size == 309);
+}
+
+TEST_CASE("parse_batch", "[format][batch]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.topic_id = 7;
+    publish_message.message_id = 9;
+    publish_message.payload = std::vector<uint8_t> {1, 2, 3};
+
+    mqtt_sn::Subscribe subscribe;
+    subscribe.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Normal);
+    subscribe.message_id = 3;
+    subscribe.topic = "foo";
+
+    mqtt_sn::format::BufferWriter publish_buffer;
+    mqtt_sn::format::encode(publish_message, publish_buffer);
+    mqtt_sn::format::BufferWriter subscribe_buffer;
+    mqtt_sn::format::encode(subscribe, subscribe_buffer);
+    const uint8_t truncated[] = {9, 0x0C, 0, 0, 1};
+
+    const mqtt_sn::format::Datagram datagrams[] = {
+        {publish_buffer.data(), publish_buffer.size()},
+        {truncated, sizeof(truncated)},
+        {subscribe_buffer.data(), subscribe_buffer.size()},
+    };
+
+    mqtt_sn::format::ParsedBatch batch;
+    REQUIRE(mqtt_sn::format::parse_batch(datagrams, 3, batch) == 2);
+    REQUIRE(batch.size() == 3);
+
+    REQUIRE(batch.ok(0));
+    REQUIRE(batch.types[0] == mqtt_sn::MessageType::Publish);
+    REQUIRE(batch.topic_ids[0] == 7);
+    REQUIRE(batch.message_ids[0] == 9);
+    REQUIRE(batch.offsets[0] == 2);
+    REQUIRE(batch.payloads[0].data() == publish_buffer.data() + 7);
+    REQUIRE(batch.payloads[0].size() == 3);
+
+    REQUIRE_FALSE(batch.ok(1));
+
+    REQUIRE(batch.ok(2));
+    REQUIRE(batch.types[2] == mqtt_sn::MessageType::Subscribe);
+    REQUIRE(batch.message_ids[2] == 3);
+    REQUIRE(batch.payloads[2].size() == 3);
+}
+
+TEST_CASE("Forward back-to-back", "[format]") {
+    mqtt_sn::Forward forward;
+    forward.ctrl = 1;
+    forward.gateway_addr = std::vector<uint8_t> {1, 2};
+    forward.payload = std::vector<uint8_t> {3, 0x01, 2};
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(forward, buffer);
+    mqtt_sn::format::encode(mqtt_sn::PingResponse {}, buffer);
+
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto first = mqtt_sn::format::parse(reader);
+    REQUIRE(first.has_value());
+    REQUIRE(std::get<mqtt_sn::Forward>(first.value()).payload == forward.payload);
+
+    auto second = mqtt_sn::format::parse(reader);
+    REQUIRE(second.has_value());
+    REQUIRE(std::holds_alternative<mqtt_sn::PingResponse>(second.value()));
+}
+
+TEST_CASE("unwrap_forward", "[format][forward]") {
+    mqtt_sn::Forward forward;
+    forward.ctrl = 2;
+    forward.gateway_addr = std::vector<uint8_t> {1, 2, 3};
+    forward.payload = std::vector<uint8_t> {3, 0x01, 2};
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(forward, buffer);
+    mqtt_sn::format::encode(mqtt_sn::PingResponse {}, buffer);
+
+    auto view = mqtt_sn::format::unwrap_forward(buffer.data(), buffer.size());
+    REQUIRE(view.has_value());
+    REQUIRE(view->ctrl == 2);
+    REQUIRE(view->gateway_addr.data() == buffer.data() + 3);
+    REQUIRE(view->gateway_addr.size() == 3);
+    REQUIRE(view->payload.data() == buffer.data() + 6);
+    REQUIRE(view->payload.size() == 3);
+
+    auto reader = mqtt_sn::format::BufferReader(view->payload.data(), view->payload.size());
+    auto inner = mqtt_sn::format::parse_view(reader);
+    REQUIRE(inner.has_value());
+    REQUIRE(std::get<mqtt_sn::SearchGateway>(inner.value()).radius == 2);
+
+    // Truncated inner frame, and a frame that is not a Forward.
+    REQUIRE_FALSE(mqtt_sn::format::unwrap_forward(buffer.data(), 8).has_value());
+    REQUIRE_FALSE(mqtt_sn::format::unwrap_forward(buffer.data() + 9, 2).has_value());
+}
+
+TEST_CASE("wrap_forward", "[format][forward]") {
+    const uint8_t node_id[] = {0xAA, 0xBB};
+    std::vector<uint8_t> buffer(16 + 4);
+    auto frame = buffer.data() + 16;
+    const uint8_t ping_response[] = {2, 0x17};
+    std::copy(std::begin(ping_response), std::end(ping_response), frame);
+
+    REQUIRE(mqtt_sn::format::forward_header_size(sizeof(node_id)) == 5);
+    REQUIRE_FALSE(mqtt_sn::format::wrap_forward(frame, 2, 4, 1, mqtt_sn::ByteView(node_id, sizeof(node_id))).has_value());
+
+    auto wrapped = mqtt_sn::format::wrap_forward(frame, 2, 16, 1, mqtt_sn::ByteView(node_id, sizeof(node_id)));
+    REQUIRE(wrapped.has_value());
+    REQUIRE(wrapped->data() == frame - 5);
+    REQUIRE(wrapped->size() == 7);
+
+    auto reader = mqtt_sn::format::BufferReader(wrapped->data(), wrapped->size());
+    auto msg = mqtt_sn::format::parse(reader);
+    REQUIRE(msg.has_value());
+    auto& forward = std::get<mqtt_sn::Forward>(msg.value());
+    REQUIRE(forward.ctrl == 1);
+    REQUIRE(forward.gateway_addr == std::vector<uint8_t> {0xAA, 0xBB});
+    REQUIRE(forward.payload == std::vector<uint8_t> {2, 0x17});
+
+    // Wrapping the Forward again would make a frame that parse() rejects.
+    std::vector<uint8_t> outer(16 + wrapped->size());
+    std::copy(wrapped->begin(), wrapped->end(), outer.begin() + 16);
+    REQUIRE_FALSE(mqtt_sn::format::wrap_forward(outer.data() + 16, wrapped->size(), 16, 0, mqtt_sn::ByteView(node_id, sizeof(node_id))).has_value());
+
+    // A node id too long for the 1-byte length field switches to the 3-byte one.
+    std::vector<uint8_t> long_node_id(300, 0x11);
+    std::vector<uint8_t> large(400);
+    auto long_wrapped = mqtt_sn::format::wrap_forward(large.data() + 320, 0, 320, 0, mqtt_sn::ByteView(long_node_id.data(), long_node_id.size()));
+    REQUIRE(long_wrapped.has_value());
+    REQUIRE(long_wrapped->size() == 305);
+    REQUIRE(long_wrapped->data()[0] == 1);
+    std::copy(std::begin(ping_response), std::end(ping_response), large.data() + 320);
+    auto unwrapped = mqtt_sn::format::unwrap_forward(long_wrapped->data(), long_wrapped->size() + 2);
+    REQUIRE(unwrapped.has_value());
+    REQUIRE(unwrapped->gateway_addr.size() == 300);
+    REQUIRE(unwrapped->payload.size() == 2);
+}
+
+TEST_CASE("frame_extent", "[format][stream]") {
+    const uint8_t short_frame[] = {4, 0x0E, 0, 1};
+    auto extent = mqtt_sn::format::frame_extent(short_frame, sizeof(short_frame));
+    REQUIRE(extent.status == mqtt_sn::format::FrameStatus::Complete);
+    REQUIRE(extent.size == 4);
+
+    extent = mqtt_sn::format::frame_extent(short_frame, 1);
+    REQUIRE(extent.status == mqtt_sn::format::FrameStatus::NeedMore);
+    REQUIRE(extent.size == 2);
+
+    extent = mqtt_sn::format::frame_extent(short_frame, 3);
+    REQUIRE(extent.status == mqtt_sn::format::FrameStatus::NeedMore);
+    REQUIRE(extent.size == 4);
+
+    const uint8_t bad_length[] = {0, 0x0E};
+    extent = mqtt_sn::format::frame_extent(bad_length, sizeof(bad_length));
+    REQUIRE(extent.status == mqtt_sn::format::FrameStatus::Malformed);
+
+    // A Forward may only encapsulate a frame that is not a Forward itself.
+    const uint8_t nested_forward[] = {3, 0xFE, 1, 3, 0xFE, 1, 2, 0x16};
+    extent = mqtt_sn::format::frame_extent(nested_forward, sizeof(nested_forward));
+    REQUIRE(extent.status == mqtt_sn::format::FrameStatus::Malformed);
+    extent = mqtt_sn::format::frame_extent(nested_forward + 3, sizeof(nested_forward) - 3);
+    REQUIRE(extent.status == mqtt_sn::format::FrameStatus::Complete);
+    REQUIRE(extent.size == 5);
+
+    auto reader = mqtt_sn::format::BufferReader(nested_forward, sizeof(nested_forward));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+    reader = mqtt_sn::format::BufferReader(nested_forward, sizeof(nested_forward));
+    REQUIRE_FALSE(mqtt_sn::format::parse_lazy(reader).has_value());
+    REQUIRE_FALSE(mqtt_sn::format::unwrap_forward(nested_forward, sizeof(nested_forward)).has_value());
+
+    mqtt_sn::format::FrameIndex index;
+    REQUIRE(mqtt_sn::format::split_frames(nested_forward, sizeof(nested_forward), index).status == mqtt_sn::format::FrameStatus::Malformed);
+    REQUIRE(index.size() == 0);
+}
+
+TEST_CASE("split_frames", "[format][stream]") {
+    mqtt_sn::PublishMessage large_publish {};
+    large_publish.topic_id = 1;
+    large_publish.payload.assign(300, 0x5A);
+
+    mqtt_sn::format::BufferWriter inner;
+    mqtt_sn::format::encode(mqtt_sn::PingResponse {}, inner);
+
+    const std::vector<mqtt_sn::Message> messages = {
+        mqtt_sn::PublishMessageComplete {1},
+        large_publish,
+        mqtt_sn::Forward {1, {1, 2}, inner},
+        mqtt_sn::Disconnect {},
+    };
+    mqtt_sn::format::BufferWriter buffer;
+    std::vector<size_t> offsets;
+    for (const auto& message : messages) {
+        offsets.push_back(buffer.size());
+        mqtt_sn::format::encode(message, buffer);
+    }
+
+    mqtt_sn::format::FrameIndex index;
+    auto result = mqtt_sn::format::split_frames(buffer.data(), buffer.size(), index);
+    REQUIRE(result.status == mqtt_sn::format::FrameStatus::Complete);
+    REQUIRE(result.consumed == buffer.size());
+    REQUIRE(index.size() == 4);
+    REQUIRE(index.types[0] == mqtt_sn::MessageType::PublishComplete);
+    REQUIRE(index.types[1] == mqtt_sn::MessageType::Publish);
+    REQUIRE(index.types[2] == mqtt_sn::MessageType::Forward);
+    REQUIRE(index.types[3] == mqtt_sn::MessageType::Disconnect);
+    REQUIRE(index.sizes[1] == 309);
+    REQUIRE(index.sizes[2] == 7);   // the Forward header and the PINGRESP it carries
+
+    // Frames are parsed later, in any order.
+    for (size_t i = index.size(); i-- > 0;) {
+        REQUIRE(index.offsets[i] == offsets[i]);
+        auto frame = index.frame(i);
+        auto reader = mqtt_sn::format::BufferReader(frame.data(), frame.size());
+        auto message = mqtt_sn::format::parse(reader);
+        REQUIRE(message.has_value());
+        REQUIRE(message->index() == messages[i].index());
+        REQUIRE(reader.readable_bytes() == 0);
+    }
+
+    // A frame cut short at the end of the buffer.
+    result = mqtt_sn::format::split_frames(buffer.data(), buffer.size() - 1, index);
+    REQUIRE(result.status == mqtt_sn::format::FrameStatus::NeedMore);
+    REQUIRE(result.consumed == offsets[3]);
+    REQUIRE(index.size() == 3);
+
+    // A length field pointing past the end, and one smaller than its header.
+    buffer[offsets[1] + 2] = 0xFF;
+    result = mqtt_sn::format::split_frames(buffer.data(), buffer.size(), index);
+    REQUIRE(result.status == mqtt_sn::format::FrameStatus::NeedMore);
+    REQUIRE(result.consumed == offsets[1]);
+    REQUIRE(index.size() == 1);
+
+    buffer[offsets[1]] = 0;
+    result = mqtt_sn::format::split_frames(buffer.data(), buffer.size(), index);
+    REQUIRE(result.status == mqtt_sn::format::FrameStatus::Malformed);
+    REQUIRE(result.consumed == offsets[1]);
+    REQUIRE(index.size() == 1);
+
+    result = mqtt_sn::format::split_frames(buffer.data(), 0, index);
+    REQUIRE(result.status == mqtt_sn::format::FrameStatus::Complete);
+    REQUIRE(index.size() == 0);
+}
+
+TEST_CASE("parse_lazy", "[format][lazy]") {
+    mqtt_sn::PublishMessage publish_message {};
+    publish_message.flags.qos = 1;
+    publish_message.topic_id = 0x1234;
+    publish_message.message_id = 0x5678;
+    publish_message.payload = {1, 2, 3};
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish_message, buffer);
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto frame = mqtt_sn::format::parse_lazy(reader);
+    REQUIRE(frame.has_value());
+    REQUIRE(reader.readable_bytes() == 0);
+    REQUIRE(frame->type() == mqtt_sn::MessageType::Publish);
+    REQUIRE(frame->flags()->qos == 1);
+    REQUIRE(frame->topic_id() == 0x1234);
+    REQUIRE(frame->message_id() == 0x5678);
+    REQUIRE(frame->payload() == mqtt_sn::ByteView(publish_message.payload.data(), publish_message.payload.size()));
+    REQUIRE(frame->payload().data() == buffer.data() + 7);
+
+    auto message = frame->message();
+    REQUIRE(message.has_value());
+    REQUIRE(std::get<mqtt_sn::PublishMessage>(*message).payload == publish_message.payload);
+
+    SECTION("Fields a type does not have") {
+        buffer.clear();
+        mqtt_sn::format::encode(mqtt_sn::PublishMessageComplete {9}, buffer);
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        frame = mqtt_sn::format::parse_lazy(reader);
+        REQUIRE(frame.has_value());
+        REQUIRE(frame->message_id() == 9);
+        REQUIRE_FALSE(frame->topic_id().has_value());
+        REQUIRE_FALSE(frame->flags().has_value());
+        REQUIRE(frame->payload().empty());
+
+        // WILLTOPIC has flags, but its empty form does not.
+        buffer.clear();
+        mqtt_sn::format::encode(mqtt_sn::WillTopicEmpty {}, buffer);
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        frame = mqtt_sn::format::parse_lazy(reader);
+        REQUIRE(frame.has_value());
+        REQUIRE_FALSE(frame->flags().has_value());
+        REQUIRE(std::holds_alternative<mqtt_sn::WillTopicEmpty>(*frame->view()));
+    }
+
+    SECTION("Topic name or topic id") {
+        mqtt_sn::MessageFlags flags {};
+        flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Normal);
+        buffer.clear();
+        mqtt_sn::format::encode(mqtt_sn::Subscribe {flags, 3, std::string("a/b")}, buffer);
+        flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::PreDefined);
+        mqtt_sn::format::encode(mqtt_sn::Subscribe {flags, 4, uint16_t(0x0102)}, buffer);
+
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        frame = mqtt_sn::format::parse_lazy(reader);
+        REQUIRE(frame.has_value());
+        REQUIRE(frame->message_id() == 3);
+        REQUIRE_FALSE(frame->topic_id().has_value());
+        REQUIRE(frame->payload().size() == 3);
+
+        frame = mqtt_sn::format::parse_lazy(reader);
+        REQUIRE(frame.has_value());
+        REQUIRE(frame->message_id() == 4);
+        REQUIRE(frame->topic_id() == 0x0102);
+        REQUIRE(frame->payload().empty());
+        REQUIRE(reader.readable_bytes() == 0);
+    }
+
+    SECTION("Forward") {
+        buffer.clear();
+        mqtt_sn::format::BufferWriter inner;
+        mqtt_sn::format::encode(publish_message, inner);
+        mqtt_sn::format::encode(mqtt_sn::Forward {1, {1, 2}, inner}, buffer);
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        frame = mqtt_sn::format::parse_lazy(reader);
+        REQUIRE(frame.has_value());
+        REQUIRE(reader.readable_bytes() == 0);
+        REQUIRE(frame->frame().size() == buffer.size());
+        REQUIRE(frame->payload() == mqtt_sn::ByteView(inner.data(), inner.size()));
+
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size() - 1);
+        REQUIRE_FALSE(mqtt_sn::format::parse_lazy(reader).has_value());
+    }
+
+    SECTION("Malformed headers") {
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size() - 1);
+        REQUIRE_FALSE(mqtt_sn::format::parse_lazy(reader).has_value());
+
+        buffer[1] = 0x03;   // unknown type
+        reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        REQUIRE_FALSE(mqtt_sn::format::parse_lazy(reader).has_value());
+    }
+}
+
+TEST_CASE("try_parse", "[format]") {
+    using mqtt_sn::format::ParseError;
+
+    const uint8_t one_byte[] = {2};
+    auto reader = mqtt_sn::format::BufferReader(one_byte, sizeof(one_byte));
+    auto result = mqtt_sn::format::try_parse(reader);
+    REQUIRE_FALSE(result);
+    REQUIRE(result.error() == ParseError::Truncated);
+    REQUIRE(result.offset() == 0);
+
+    const uint8_t bad_length[] = {0, 0x0C};
+    reader = mqtt_sn::format::BufferReader(bad_length, sizeof(bad_length));
+    result = mqtt_sn::format::try_parse(reader);
+    REQUIRE(result.error() == ParseError::BadLength);
+    REQUIRE(result.offset() == 0);
+
+    // After a well-formed frame, offsets are relative to the start of the buffer.
+    const uint8_t unknown_type[] = {2, 0x16, 2, 0x03};
+    reader = mqtt_sn::format::BufferReader(unknown_type, sizeof(unknown_type));
+    REQUIRE(mqtt_sn::format::try_parse(reader).has_value());
+    result = mqtt_sn::format::try_parse(reader);
+    REQUIRE(result.error() == ParseError::UnknownType);
+    REQUIRE(result.offset() == 3);
+
+    const uint8_t too_short[] = {5, 0x0D, 0, 1, 0};
+    reader = mqtt_sn::format::BufferReader(too_short, sizeof(too_short));
+    result = mqtt_sn::format::try_parse(reader);
+    REQUIRE(result.error() == ParseError::TooShort);
+    REQUIRE(result.offset() == 0);
+
+    const uint8_t subscribe_topic_id[] = {5, 0x12, 0x40, 0, 1}; // predefined topic id missing
+    reader = mqtt_sn::format::BufferReader(subscribe_topic_id, sizeof(subscribe_topic_id));
+    result = mqtt_sn::format::try_parse(reader);
+    REQUIRE(result.error() == ParseError::BadField);
+    REQUIRE(result.offset() == 5);
+
+    const uint8_t forward_truncated[] = {3, 0xFE, 1, 5, 0x0D, 0};
+    reader = mqtt_sn::format::BufferReader(forward_truncated, sizeof(forward_truncated));
+    result = mqtt_sn::format::try_parse(reader);
+    REQUIRE(result.error() == ParseError::BadField);
+    REQUIRE(result.offset() == 3);
+
+    const uint8_t publish[] = {10, 0x0C, 0, 0, 1, 0, 2, 'a', 'b', 'c'};
+    for (size_t size = 0; size < sizeof(publish); ++size) {
+        reader = mqtt_sn::format::BufferReader(publish, size);
+        result = mqtt_sn::format::try_parse(reader);
+        REQUIRE(result.error() == ParseError::Truncated);
+        REQUIRE(result.offset() == 0);
+    }
+
+    reader = mqtt_sn::format::BufferReader(publish, sizeof(publish));
+    result = mqtt_sn::format::try_parse(reader);
+    REQUIRE(result);
+    auto& message = std::get<mqtt_sn::PublishMessage>(result.value());
+    REQUIRE(message.topic_id == 1);
+    REQUIRE(message.message_id == 2);
+
+    auto view_reader = mqtt_sn::format::BufferReader(publish, sizeof(publish));
+    auto view = mqtt_sn::format::try_parse_view(view_reader);
+    REQUIRE(view);
+    REQUIRE(view_reader.read_offset() == sizeof(publish));
+    REQUIRE(std::holds_alternative<mqtt_sn::PublishMessageView>(*view));
+
+    view_reader = mqtt_sn::format::BufferReader(subscribe_topic_id, sizeof(subscribe_topic_id));
+    view = mqtt_sn::format::try_parse_view(view_reader);
+    REQUIRE(view.error() == ParseError::BadField);
+    REQUIRE(view.offset() == 5);
+
+    REQUIRE(mqtt_sn::format::name(ParseError::TooShort) == "too_short");
+}
+
+TEST_CASE("StreamDecoder", "[format][stream]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+    publish_message.payload.assign(300, 0xAB);
+
+    mqtt_sn::format::BufferWriter stream;
+    mqtt_sn::format::encode(mqtt_sn::PingResponse {}, stream);
+    mqtt_sn::format::encode(publish_message, stream);
+    mqtt_sn::format::encode(mqtt_sn::PublishMessageAck {1, 2, mqtt_sn::MessageErrorCode::Accepted}, stream);
+
+    SECTION("whole stream in one chunk") {
+        mqtt_sn::format::StreamDecoder decoder;
+        decoder.feed(stream.data(), stream.size());
+
+        auto result = decoder.next();
+        REQUIRE(result.status == mqtt_sn::format::StreamDecoder::Status::Frame);
+        REQUIRE(result.frame.data() == stream.data());
+        REQUIRE(result.frame.size() == 2);
+
+        result = decoder.next();
+        REQUIRE(result.status == mqtt_sn::format::StreamDecoder::Status::Frame);
+        REQUIRE(result.frame.data() == stream.data() + 2);
+        REQUIRE(result.frame.size() == 309);
+
+        result = decoder.next();
+        REQUIRE(result.status == mqtt_sn::format::StreamDecoder::Status::Frame);
+        REQUIRE(result.frame.size() == 7);
+
+        REQUIRE(decoder.next().status == mqtt_sn::format::StreamDecoder::Status::NeedMore);
+    }
+
+    SECTION("one byte at a time") {
+        mqtt_sn::format::StreamDecoder decoder;
+        std::vector<std::vector<uint8_t>> frames;
+        for (size_t i = 0; i < stream.size(); ++i) {
+            decoder.feed(stream.data() + i, 1);
+            for (auto result = decoder.next(); result.status != mqtt_sn::format::StreamDecoder::Status::NeedMore; result = decoder.next()) {
+                REQUIRE(result.status == mqtt_sn::format::StreamDecoder::Status::Frame);
+                frames.emplace_back(result.frame.begin(), result.frame.end());
+            }
+        }
+
+        REQUIRE(frames.size() == 3);
+        REQUIRE(frames[1].size() == 309);
+
+        auto reader = mqtt_sn::format::BufferReader(frames[1].data(), frames[1].size());
+        auto msg = mqtt_sn::format::parse(reader);
+        REQUIRE(msg.has_value());
+        REQUIRE(std::get<mqtt_sn::PublishMessage>(msg.value()).payload == publish_message.payload);
+    }
+
+    SECTION("malformed length") {
+        const uint8_t garbage[] = {0, 0, 0};
+        mqtt_sn::format::StreamDecoder decoder;
+        decoder.feed(garbage, sizeof(garbage));
+        REQUIRE(decoder.next().status == mqtt_sn::format::StreamDecoder::Status::Error);
+        REQUIRE(decoder.next().status == mqtt_sn::format::StreamDecoder::Status::Error);
+
+        decoder.reset();
+        decoder.feed(stream.data(), 2);
+        REQUIRE(decoder.next().status == mqtt_sn::format::StreamDecoder::Status::Frame);
+    }
+
+    SECTION("nested Forward headers") {
+        std::vector<uint8_t> nested;
+        for (int i = 0; i < 1000; ++i) {
+            nested.insert(nested.end(), {3, 0xFE, 1});
+        }
+
+        mqtt_sn::format::StreamDecoder decoder;
+        decoder.feed(nested.data(), nested.size());
+        REQUIRE(decoder.next().status == mqtt_sn::format::StreamDecoder::Status::Error);
+
+        // Header by header, the decoder gives up on the second one instead of buffering them all.
+        decoder.reset();
+        auto status = mqtt_sn::format::StreamDecoder::Status::NeedMore;
+        size_t fed = 0;
+        while (status == mqtt_sn::format::StreamDecoder::Status::NeedMore && fed < nested.size()) {
+            decoder.feed(nested.data() + fed, 3);
+            fed += 3;
+            status = decoder.next().status;
+        }
+        REQUIRE(status == mqtt_sn::format::StreamDecoder::Status::Error);
+        REQUIRE(fed == 6);
+    }
+}
+
+TEST_CASE("parse into Arena", "[format][arena]") {
+    mqtt_sn::PublishMessage publish_message;
+    publish_message.topic_id = 1;
+    publish_message.message_id = 2;
+    publish_message.payload = std::vector<uint8_t> {1, 2, 3};
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish_message, buffer);
+
+    mqtt_sn::format::Arena arena;
+    for (int tick = 0; tick < 2; ++tick) {
+        auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+        auto msg = mqtt_sn::format::parse(reader, arena);
+
+        REQUIRE(msg.has_value());
+        REQUIRE(std::holds_alternative<mqtt_sn::pmr::PublishMessage>(msg.value()));
+
+        auto& publish = std::get<mqtt_sn::pmr::PublishMessage>(msg.value());
+        REQUIRE(publish.topic_id == 1);
+        REQUIRE(publish.message_id == 2);
+        REQUIRE(std::equal(publish.payload.begin(), publish.payload.end(), publish_message.payload.begin(), publish_message.payload.end()));
+        REQUIRE(publish.payload.get_allocator().resource() == arena.resource());
+
+        mqtt_sn::format::BufferWriter encoded;
+        mqtt_sn::format::encode(msg.value(), encoded);
+        REQUIRE(encoded == buffer);
+        REQUIRE(mqtt_sn::format::encoded_size(msg.value()) == buffer.size());
+
+        arena.reset();
+    }
+}
+
+TEST_CASE("parse Subscribe into Arena", "[format][arena]") {
+    mqtt_sn::Subscribe subscribe;
+    subscribe.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Normal);
+    subscribe.message_id = 1;
+    subscribe.topic = "foo";
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(subscribe, buffer);
+
+    mqtt_sn::format::Arena arena;
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto msg = mqtt_sn::format::parse(reader, arena);
+
+    REQUIRE(msg.has_value());
+    auto& sub = std::get<mqtt_sn::pmr::Subscribe>(msg.value());
+    REQUIRE(std::get<std::pmr::string>(sub.topic) == "foo");
+}
+
+TEST_CASE("parse rejects truncated frames", "[format]") {
+    const uint8_t advertise[] = {2, 0x00};
+    auto reader = mqtt_sn::format::BufferReader(advertise, sizeof(advertise));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+
+    const uint8_t publish_ack[] = {5, 0x0D, 0, 1, 0};
+    reader = mqtt_sn::format::BufferReader(publish_ack, sizeof(publish_ack));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+
+    const uint8_t subscribe_topic_id[] = {5, 0x12, 0x40, 0, 1}; // predefined topic id missing
+    reader = mqtt_sn::format::BufferReader(subscribe_topic_id, sizeof(subscribe_topic_id));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+
+    const uint8_t long_length[] = {1, 0};
+    reader = mqtt_sn::format::BufferReader(long_length, sizeof(long_length));
+    REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+
+    const uint8_t publish[] = {10, 0x0C, 0, 1, 0, 2, 0, 'a', 'b', 'c'};
+    for (size_t size = 0; size < sizeof(publish); ++size) {
+        reader = mqtt_sn::format::BufferReader(publish, size);
+        REQUIRE_FALSE(mqtt_sn::format::parse(reader).has_value());
+    }
 }
\ No newline at end of file
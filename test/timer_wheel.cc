@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <iterator>
+#include <map>
+#include <random>
+#include <vector>
+
+#include <mqtt-sn/timer_wheel.h>
+
+TEST_CASE("TimerWheel fires at deadlines", "[timer_wheel]") {
+    mqtt_sn::TimerWheel wheel(100);
+    auto a = wheel.add(105, 1);
+    auto b = wheel.add(100 + 300, 2);
+    wheel.add(100 + 70000, 3);
+    wheel.add(50, 4); // past deadlines fire on the next tick
+    REQUIRE(wheel.size() == 4);
+
+    std::vector<uint64_t> fired;
+    const auto record = [&](mqtt_sn::TimerWheel::TimerId, uint64_t data) {
+        fired.push_back(data);
+    };
+
+    REQUIRE(wheel.advance(104, record) == 1);
+    REQUIRE(fired == std::vector<uint64_t> {4});
+    REQUIRE(wheel.advance(105, record) == 1);
+    REQUIRE_FALSE(wheel.armed(a));
+    REQUIRE(wheel.armed(b));
+
+    REQUIRE(wheel.advance(399, record) == 0);
+    REQUIRE(wheel.advance(400, record) == 1);
+    REQUIRE(wheel.advance(100 + 69999, record) == 0);
+    REQUIRE(wheel.advance(100 + 70000, record) == 1);
+    REQUIRE(fired == std::vector<uint64_t> {4, 1, 2, 3});
+    REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("TimerWheel cancel and rearm", "[timer_wheel]") {
+    mqtt_sn::TimerWheel wheel;
+    auto a = wheel.add(10);
+    auto b = wheel.add(20);
+
+    REQUIRE(wheel.cancel(a));
+    REQUIRE_FALSE(wheel.cancel(a));
+    wheel.rearm(b, 1000);
+    REQUIRE(wheel.advance(999, [](auto, auto) {}) == 0);
+
+    // The callback may keep the firing timer.
+    size_t fired = 0;
+    wheel.advance(1000, [&](mqtt_sn::TimerWheel::TimerId timer, uint64_t) {
+        ++fired;
+        wheel.rearm(timer, 1500);
+    });
+    REQUIRE(fired == 1);
+    REQUIRE(wheel.armed(b));
+    REQUIRE(wheel.deadline(b) == 1500);
+
+    REQUIRE(wheel.advance(2000, [](auto, auto) {}) == 1);
+    REQUIRE(wheel.size() == 0);
+}
+
+TEST_CASE("TimerWheel matches a reference", "[timer_wheel]") {
+    const uint32_t start = 0xFFFF0000; // crosses the 32-bit wrap-around
+    mqtt_sn::TimerWheel wheel(start);
+    std::mt19937 random(42);
+    std::multimap<uint32_t, mqtt_sn::TimerWheel::TimerId> expected;
+
+    for (int i = 0; i < 5000; ++i) {
+        uint32_t delay = random() % (i % 10 == 0 ? 20000000 : 100000);
+        auto timer = wheel.add(start + delay, delay);
+        expected.emplace(delay, timer);
+    }
+
+    uint32_t now = start;
+    size_t total = 0;
+    for (uint32_t step : {1u, 255u, 256u, 4000u, 65536u, 100000u, 20000000u}) {
+        now += step;
+        total += wheel.advance(now, [&](mqtt_sn::TimerWheel::TimerId, uint64_t delay) {
+            REQUIRE(static_cast<uint32_t>(start + delay) == wheel.now() - 1); // fired at its own tick
+        });
+        REQUIRE(total == size_t(std::distance(expected.begin(), expected.upper_bound(now - start))));
+    }
+    REQUIRE(total == 5000);
+    REQUIRE(wheel.size() == 0);
+}
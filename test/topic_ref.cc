@@ -0,0 +1,65 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <unordered_set>
+
+#include <mqtt-sn/topic_ref.h>
+
+TEST_CASE("TopicRef", "[topic_ref]") {
+    constexpr auto registered = mqtt_sn::TopicRef::registered(0x0102);
+    constexpr auto predefined = mqtt_sn::TopicRef::predefined(0x0102);
+    static_assert(registered.type() == mqtt_sn::TopicIdType::Normal);
+    static_assert(registered.value() == 0x0102);
+    static_assert(registered != predefined);
+
+    auto short_name = mqtt_sn::TopicRef::from_short_name("ab");
+    REQUIRE(short_name.has_value());
+    REQUIRE(short_name->type() == mqtt_sn::TopicIdType::Short);
+    REQUIRE(short_name->value() == ('a' << 8 | 'b'));
+    REQUIRE(short_name->short_name() == std::array<char, 2> {'a', 'b'});
+    REQUIRE_FALSE(mqtt_sn::TopicRef::from_short_name("abc").has_value());
+
+    std::unordered_set<mqtt_sn::TopicRef> topics {registered, predefined, short_name.value()};
+    REQUIRE(topics.size() == 3);
+    REQUIRE(topics.count(mqtt_sn::TopicRef::registered(0x0102)) == 1);
+}
+
+TEST_CASE("topic_ref of messages", "[topic_ref]") {
+    mqtt_sn::PublishMessage publish {};
+    publish.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Short);
+    publish.topic_id = mqtt_sn::TopicRef::from_short_name("ab")->value();
+
+    mqtt_sn::format::BufferWriter buffer;
+    mqtt_sn::format::encode(publish, buffer);
+    auto reader = mqtt_sn::format::BufferReader(buffer.data(), buffer.size());
+    auto message = mqtt_sn::format::parse_view(reader);
+    REQUIRE(message.has_value());
+    auto topic = mqtt_sn::topic_ref(std::get<mqtt_sn::PublishMessageView>(message.value()));
+    REQUIRE(topic == mqtt_sn::TopicRef::from_short_name("ab"));
+
+    mqtt_sn::Subscribe subscribe {};
+    subscribe.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::PreDefined);
+    subscribe.topic = uint16_t(7);
+    REQUIRE(mqtt_sn::topic_ref(subscribe) == mqtt_sn::TopicRef::predefined(7));
+
+    subscribe.flags.topic_id_type = static_cast<uint8_t>(mqtt_sn::TopicIdType::Normal);
+    subscribe.topic = std::string("sensors/#");
+    REQUIRE_FALSE(mqtt_sn::topic_ref(subscribe).has_value());
+}
+
+TEST_CASE("PredefinedTopics", "[topic_ref]") {
+    const mqtt_sn::PredefinedTopics topics {
+        {10, "sensors/temperature"},
+        {2, "sensors/humidity"},
+        {10, "ignored"},
+        {3, "sensors/humidity"},
+    };
+
+    REQUIRE(topics.size() == 2);
+    REQUIRE(topics.name(10) == "sensors/temperature");
+    REQUIRE(topics.name(2) == "sensors/humidity");
+    REQUIRE_FALSE(topics.name(3).has_value());
+    REQUIRE(topics.name(mqtt_sn::TopicRef::predefined(2)) == "sensors/humidity");
+    REQUIRE_FALSE(topics.name(mqtt_sn::TopicRef::registered(2)).has_value());
+    REQUIRE(topics.find("sensors/temperature") == mqtt_sn::TopicRef::predefined(10));
+    REQUIRE_FALSE(topics.find("ignored").has_value());
+}
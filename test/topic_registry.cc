@@ -0,0 +1,129 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <atomic>
+#include <string>
+#include <thread>
+
+#include <mqtt-sn/topic_registry.h>
+
+TEST_CASE("TopicRegistry register and lookup", "[topic_registry]") {
+    mqtt_sn::TopicRegistry registry;
+
+    auto temperature = registry.register_topic("sensors/temperature");
+    auto humidity = registry.register_topic("sensors/humidity");
+    REQUIRE(temperature == 1);
+    REQUIRE(humidity == 2);
+    REQUIRE(registry.register_topic("sensors/temperature") == temperature);
+    REQUIRE(registry.size() == 2);
+
+    REQUIRE(registry.name(1) == "sensors/temperature");
+    REQUIRE(registry.find("sensors/humidity") == humidity);
+    REQUIRE_FALSE(registry.find("sensors/pressure").has_value());
+    REQUIRE_FALSE(registry.name(3).has_value());
+    REQUIRE_FALSE(registry.name(0x1234).has_value());
+    REQUIRE_FALSE(registry.register_topic("").has_value());
+}
+
+TEST_CASE("TopicRegistry reuses released ids", "[topic_registry]") {
+    mqtt_sn::TopicRegistry registry;
+    registry.register_topic("a");
+    registry.register_topic("b");
+    auto name = registry.name(1);
+
+    REQUIRE(registry.unregister(1));
+    REQUIRE_FALSE(registry.unregister(1));
+    REQUIRE_FALSE(registry.name(1).has_value());
+    REQUIRE_FALSE(registry.find("a").has_value());
+    REQUIRE(name == "a"); // interned names outlive their id
+
+    REQUIRE(registry.register_topic("c") == 1);
+    REQUIRE(registry.register_topic("a") == 3);
+    REQUIRE(registry.size() == 3);
+}
+
+TEST_CASE("TopicRegistry assign", "[topic_registry]") {
+    mqtt_sn::TopicRegistry registry;
+
+    REQUIRE(registry.assign(5, "a"));
+    REQUIRE(registry.name(5) == "a");
+    REQUIRE(registry.find("a") == 5);
+
+    REQUIRE(registry.assign(7, "a"));
+    REQUIRE_FALSE(registry.name(5).has_value());
+    REQUIRE(registry.find("a") == 7);
+
+    REQUIRE(registry.assign(7, "b"));
+    REQUIRE_FALSE(registry.find("a").has_value());
+    REQUIRE(registry.size() == 1);
+
+    REQUIRE_FALSE(registry.assign(0, "c"));
+    REQUIRE_FALSE(registry.assign(0xFFFF, "c"));
+
+    // Allocation skips ids assigned by the peer.
+    for (uint16_t id = 1; id < 7; ++id) {
+        REQUIRE(registry.register_topic("topic/" + std::to_string(id)) != 7);
+    }
+    REQUIRE(registry.register_topic("next") == 8);
+}
+
+TEST_CASE("TopicRegistry grows", "[topic_registry]") {
+    mqtt_sn::TopicRegistry registry;
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(registry.register_topic("topic/" + std::to_string(i)) == i + 1);
+    }
+    for (int i = 0; i < 1000; ++i) {
+        REQUIRE(registry.find("topic/" + std::to_string(i)) == i + 1);
+        REQUIRE(registry.name(static_cast<uint16_t>(i + 1)) == "topic/" + std::to_string(i));
+    }
+}
+
+TEST_CASE("TopicRegistry compact", "[topic_registry]") {
+    mqtt_sn::TopicRegistry registry;
+    for (int i = 0; i < 200; ++i) {
+        registry.register_topic("topic/" + std::to_string(i));
+    }
+    for (uint16_t id = 2; id <= 200; ++id) {
+        REQUIRE(registry.unregister(id));
+    }
+    REQUIRE(registry.interned() == 200);
+
+    registry.compact();
+    REQUIRE(registry.interned() == 1);
+    REQUIRE(registry.size() == 1);
+    REQUIRE(registry.name(1) == "topic/0");
+    REQUIRE(registry.find("topic/0") == 1);
+    REQUIRE_FALSE(registry.find("topic/1").has_value());
+
+    REQUIRE(registry.register_topic("topic/1") == 200);
+    REQUIRE(registry.find("topic/1") == 200);
+    REQUIRE(registry.interned() == 2);
+}
+
+TEST_CASE("TopicRegistry concurrent reads", "[topic_registry]") {
+    mqtt_sn::TopicRegistry registry;
+    registry.register_topic("topic/0");
+
+    std::atomic<bool> done {false};
+    std::atomic<bool> consistent {true};
+    std::thread reader([&] {
+        while (!done.load()) {
+            auto name = registry.name(1);
+            if (!name || name.value() != "topic/0") {
+                consistent = false;
+            }
+            auto id = registry.find("topic/0");
+            if (id && id.value() != 1) {
+                consistent = false;
+            }
+        }
+    });
+
+    for (int i = 1; i < 2000; ++i) {
+        registry.register_topic("topic/" + std::to_string(i));
+    }
+    done = true;
+    reader.join();
+
+    REQUIRE(consistent.load());
+    REQUIRE(registry.size() == 2000);
+}
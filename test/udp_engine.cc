@@ -0,0 +1,186 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <netinet/in.h>
+
+#include <mqtt-sn/udp_engine.h>
+
+namespace {
+
+using mqtt_sn::net::Endpoint;
+using mqtt_sn::net::UdpEngine;
+
+mqtt_sn::PublishMessage make_publish(uint16_t message_id) {
+    mqtt_sn::PublishMessage message {};
+    message.topic_id = 7;
+    message.message_id = message_id;
+    message.payload.assign(16, static_cast<uint8_t>(message_id));
+    return message;
+}
+
+/***
+ * Sends 64 PUBLISHes from one engine to another over loopback and checks they arrive intact.
+ */
+void exchange(UdpEngine::Backend backend) {
+    UdpEngine::Config config;
+    config.backend = backend;
+    UdpEngine sender(config);
+    UdpEngine receiver(config);
+    REQUIRE(sender.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+    REQUIRE(receiver.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+
+    auto to = receiver.local_endpoint();
+    for (uint16_t i = 1; i <= 64; ++i) {
+        REQUIRE(sender.send(make_publish(i), to));
+    }
+    REQUIRE(sender.pending() == 64);
+    REQUIRE(sender.flush() == 64);
+    REQUIRE(sender.pending() == 0);
+    REQUIRE(sender.stats().sent == 64);
+
+    std::vector<uint16_t> message_ids;
+    mqtt_sn::format::ParsedBatch batch;
+    while (message_ids.size() < 64) {
+        auto count = receiver.receive();
+        REQUIRE(count > 0);
+        REQUIRE(mqtt_sn::format::parse_batch(receiver.datagrams(), receiver.received(), batch) == receiver.received());
+        for (size_t i = 0; i < receiver.received(); ++i) {
+            REQUIRE(batch.types[i] == mqtt_sn::MessageType::Publish);
+            REQUIRE(batch.topic_ids[i] == 7);
+            REQUIRE(batch.payloads[i].size() == 16);
+            message_ids.push_back(batch.message_ids[i]);
+
+            auto from = receiver.source(i);
+            auto local = sender.local_endpoint();
+            REQUIRE(reinterpret_cast<const sockaddr_in&>(from.address).sin_port == reinterpret_cast<const sockaddr_in&>(local.address).sin_port);
+        }
+    }
+    REQUIRE(receiver.stats().received == 64);
+    for (uint16_t i = 0; i < 64; ++i) {
+        REQUIRE(message_ids[i] == i + 1);
+    }
+
+    // With everything queued before the first call, a batch of 64 costs one syscall each way.
+    REQUIRE(sender.stats().syscalls == 1);
+    REQUIRE(receiver.stats().syscalls == 1);
+
+    REQUIRE(receiver.receive(false) == 0);
+}
+
+/***
+ * A datagram longer than the receive buffers is dropped rather than handed out cut short.
+ */
+void drop_truncated(UdpEngine::Backend backend) {
+    UdpEngine::Config config;
+    config.backend = backend;
+    config.buffer_size = 32;
+    config.receive_timeout_ms = 1000;
+    UdpEngine receiver(config);
+    UdpEngine sender({});
+    REQUIRE(receiver.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+    REQUIRE(sender.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+
+    auto long_publish = make_publish(1);
+    long_publish.payload.assign(64, 0xAB);
+    REQUIRE(sender.send(long_publish, receiver.local_endpoint()));
+    REQUIRE(sender.send(make_publish(2), receiver.local_endpoint()));
+    REQUIRE(sender.flush() == 2);
+
+    for (int attempt = 0; attempt < 10 && receiver.received() == 0; ++attempt) {
+        REQUIRE(receiver.receive() >= 0);
+    }
+    REQUIRE(receiver.received() == 1);
+    REQUIRE(receiver.stats().truncated == 1);
+    REQUIRE(receiver.stats().received == 1);
+
+    mqtt_sn::format::ParsedBatch batch;
+    REQUIRE(mqtt_sn::format::parse_batch(receiver.datagrams(), 1, batch) == 1);
+    REQUIRE(batch.message_ids[0] == 2);
+}
+
+}
+
+/***
+ * A datagram the kernel refuses (broadcast without SO_BROADCAST) does not hold back the rest of
+ * the batch.
+ */
+void skip_refused(UdpEngine::Backend backend) {
+    UdpEngine::Config config;
+    config.backend = backend;
+    config.receive_timeout_ms = 1000;
+    UdpEngine sender(config);
+    UdpEngine receiver(config);
+    REQUIRE(sender.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+    REQUIRE(receiver.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+
+    REQUIRE(sender.send(make_publish(1), receiver.local_endpoint()));
+    REQUIRE(sender.send(make_publish(2), Endpoint::ipv4(INADDR_BROADCAST, 9)));
+    REQUIRE(sender.send(make_publish(3), receiver.local_endpoint()));
+    REQUIRE(sender.flush() == 2);
+    REQUIRE(sender.stats().send_errors == 1);
+    REQUIRE(sender.stats().sent == 2);
+
+    std::vector<uint16_t> message_ids;
+    mqtt_sn::format::ParsedBatch batch;
+    for (int attempt = 0; attempt < 10 && message_ids.size() < 2; ++attempt) {
+        auto count = receiver.receive();
+        REQUIRE(count >= 0);
+        REQUIRE(mqtt_sn::format::parse_batch(receiver.datagrams(), receiver.received(), batch) == receiver.received());
+        message_ids.insert(message_ids.end(), batch.message_ids.begin(), batch.message_ids.begin() + receiver.received());
+    }
+    REQUIRE(message_ids == std::vector<uint16_t> {1, 3});
+}
+
+TEST_CASE("UdpEngine exchanges batches with recvmmsg/sendmmsg", "[udp_engine]") {
+    exchange(UdpEngine::Backend::Mmsg);
+}
+
+TEST_CASE("UdpEngine exchanges batches with io_uring", "[udp_engine]") {
+    exchange(UdpEngine::Backend::IoUring);
+}
+
+TEST_CASE("UdpEngine drops truncated datagrams with recvmmsg", "[udp_engine]") {
+    drop_truncated(UdpEngine::Backend::Mmsg);
+}
+
+TEST_CASE("UdpEngine drops truncated datagrams with io_uring", "[udp_engine]") {
+    drop_truncated(UdpEngine::Backend::IoUring);
+}
+
+TEST_CASE("UdpEngine skips datagrams refused for their destination with sendmmsg", "[udp_engine]") {
+    skip_refused(UdpEngine::Backend::Mmsg);
+}
+
+TEST_CASE("UdpEngine skips datagrams refused for their destination with io_uring", "[udp_engine]") {
+    skip_refused(UdpEngine::Backend::IoUring);
+}
+
+TEST_CASE("UdpEngine replies to the source of a datagram", "[udp_engine]") {
+    UdpEngine client({});
+    UdpEngine gateway({});
+    REQUIRE(client.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+    REQUIRE(gateway.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+
+    mqtt_sn::format::BufferWriter frame;
+    mqtt_sn::format::encode(mqtt_sn::PingRequest {}, frame);
+    REQUIRE(client.send(mqtt_sn::ByteView(frame.data(), frame.size()), gateway.local_endpoint()));
+    REQUIRE(client.flush() == 1);
+
+    REQUIRE(gateway.receive() == 1);
+    REQUIRE(gateway.send(mqtt_sn::PingResponse {}, gateway.source(0)));
+    REQUIRE(gateway.flush() == 1);
+
+    REQUIRE(client.receive() == 1);
+    auto reader = mqtt_sn::format::BufferReader(client.datagrams()[0].data, client.datagrams()[0].size);
+    auto message = mqtt_sn::format::parse(reader);
+    REQUIRE(message.has_value());
+    REQUIRE(std::holds_alternative<mqtt_sn::PingResponse>(message.value()));
+}
+
+TEST_CASE("UdpEngine rejects datagrams larger than its buffers", "[udp_engine]") {
+    UdpEngine::Config config;
+    config.buffer_size = 8;
+    UdpEngine engine(config);
+    REQUIRE(engine.open(Endpoint::ipv4(INADDR_LOOPBACK, 0)));
+    REQUIRE_FALSE(engine.send(make_publish(1), engine.local_endpoint()));
+    REQUIRE(engine.pending() == 0);
+}